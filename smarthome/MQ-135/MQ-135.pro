@@ -16,13 +16,21 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    iiobuffer.cpp \
     main.cpp \
-    mq135.cpp
+    mq135.cpp \
+    samplefilter.cpp
 
 HEADERS += \
-    mq135.h
+    iiobuffer.h \
+    mq135.h \
+    samplefilter.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
+
+include(../metrics/metrics.pri)
+include(../sysfs/sysfs.pri)
+include(../log/log.pri)
@@ -0,0 +1,204 @@
+/**
+ * @file iiobuffer.cpp
+ * @brief IIO触发缓冲区读取类的实现文件
+ */
+#include "iiobuffer.h"
+#include "../sysfs/sysfspath.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QRegularExpression>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* 没有指定触发器时通过configfs创建的hrtimer触发器名称 */
+static const char DefaultTrigger[] = "smarthome-adc";
+
+/**
+ * @brief 写入一个sysfs属性文件
+ */
+static bool writeAttribute(const QString &path, const QByteArray &value)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    return file.write(value) == value.size();
+}
+
+/**
+ * @brief 读取一个sysfs属性文件，去掉末尾换行
+ */
+static QByteArray readAttribute(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll().trimmed();
+}
+
+/**
+ * @brief IioBuffer类构造函数
+ */
+IioBuffer::IioBuffer()
+    : fd(-1), bigEndian(false), isSigned(false), realBits(16), storageBytes(2), shift(0)
+{
+}
+
+/**
+ * @brief IioBuffer类析构函数
+ */
+IioBuffer::~IioBuffer()
+{
+    close();
+}
+
+/**
+ * @brief 配置并打开触发缓冲区
+ * @details 配置缓冲区前必须先关闭缓冲区；除指定通道外的扫描元素(包括时间戳)全部关闭
+ */
+bool IioBuffer::open(const QString &device, const QString &channel, int samplingHz, int length)
+{
+    close();
+
+    QString node = sysfsPath("/dev/" + device);
+    devicePath = sysfsPath("/sys/bus/iio/devices/" + device);
+    channelName = channel;
+    if (!QFile::exists(node) || !QFile::exists(devicePath + "/buffer/enable"))
+        return false;
+
+    writeAttribute(devicePath + "/buffer/enable", "0");
+    if (!parseType(QString::fromLatin1(readAttribute(devicePath + "/scan_elements/" + channel + "_type"))))
+        return false;
+
+    QDir scan(devicePath + "/scan_elements", "*_en");
+    for (const QString &name : scan.entryList(QDir::Files)) {
+        bool ours = name == channel + "_en";
+        if (!writeAttribute(scan.filePath(name), ours ? "1" : "0") && ours)
+            return false;
+    }
+
+    if (!setupTrigger(devicePath, samplingHz))
+        return false;
+
+    if (!writeAttribute(devicePath + "/buffer/length", QByteArray::number(length)) ||
+        !writeAttribute(devicePath + "/buffer/enable", "1")) {
+        qDebug()<<"无法使能IIO缓冲区"<<devicePath;
+        return false;
+    }
+
+    fd = ::open(QFile::encodeName(node).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        qDebug()<<"无法打开"<<node<<strerror(errno);
+        writeAttribute(devicePath + "/buffer/enable", "0");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 关闭缓冲区
+ */
+void IioBuffer::close()
+{
+    if (fd < 0)
+        return;
+    ::close(fd);
+    fd = -1;
+    writeAttribute(devicePath + "/buffer/enable", "0");
+}
+
+/**
+ * @brief 缓冲区是否已打开
+ */
+bool IioBuffer::isOpen() const
+{
+    return fd >= 0;
+}
+
+/**
+ * @brief 用一次read()取出缓冲区中已有的采样
+ * @details 按scan_elements中的格式解码：字节序、存储宽度、右移位数、有效位数和符号
+ */
+int IioBuffer::read(float *raw, int max)
+{
+    if (fd < 0)
+        return -1;
+
+    unsigned char buffer[1024];
+    int want = qMin(max, (int)sizeof(buffer) / storageBytes);
+    ssize_t n = ::read(fd, buffer, want * storageBytes);
+    if (n < 0)
+        return errno == EAGAIN ? 0 : -1;
+
+    int count = (int)n / storageBytes;
+    quint32 mask = realBits < 32 ? (1u << realBits) - 1 : 0xffffffffu;
+    for (int i = 0; i < count; i++) {
+        const unsigned char *p = buffer + i * storageBytes;
+        quint32 value = 0;
+        for (int b = 0; b < storageBytes; b++)
+            value |= (quint32)p[bigEndian ? b : storageBytes - 1 - b] << (8 * (storageBytes - 1 - b));
+        value = (value >> shift) & mask;
+
+        if (isSigned && realBits < 32 && (value & (1u << (realBits - 1))))
+            raw[i] = (float)((qint64)value - ((qint64)1 << realBits));
+        else
+            raw[i] = (float)value;
+    }
+    return count;
+}
+
+/**
+ * @brief 设置触发器和采样频率
+ * @details 触发器设备在/sys/bus/iio/devices/triggerN下，按name属性查找
+ */
+bool IioBuffer::setupTrigger(const QString &devicePath, int samplingHz)
+{
+    QByteArray trigger = qgetenv("SMARTHOME_IIO_TRIGGER");
+    if (trigger.isEmpty()) {
+        /* 已存在时mkdir失败，直接使用已有的触发器 */
+        trigger = DefaultTrigger;
+        QDir().mkdir(sysfsPath(QString("/sys/kernel/config/iio/triggers/hrtimer/") + DefaultTrigger));
+    }
+
+    QDir devices(sysfsPath("/sys/bus/iio/devices"), "trigger*");
+    bool found = false;
+    for (const QString &name : devices.entryList(QDir::Dirs)) {
+        QString path = devices.filePath(name);
+        if (readAttribute(path + "/name") == trigger) {
+            writeAttribute(path + "/sampling_frequency", QByteArray::number(samplingHz));
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        qDebug()<<"找不到IIO触发器"<<trigger;
+        return false;
+    }
+
+    return writeAttribute(devicePath + "/trigger/current_trigger", trigger);
+}
+
+/**
+ * @brief 解析in_voltageX_type
+ * @param type 格式为 [be|le]:[s|u]<有效位数>/<存储位数>[X<重复次数>]>><右移位数>，例如"le:u16/16>>0"
+ */
+bool IioBuffer::parseType(const QString &type)
+{
+    static const QRegularExpression pattern("^(be|le):([su])(\\d+)/(\\d+)(?:X\\d+)?>>(\\d+)$");
+    QRegularExpressionMatch match = pattern.match(type);
+    if (!match.hasMatch())
+        return false;
+
+    int storageBits = match.captured(4).toInt();
+    if (storageBits != 16 && storageBits != 32)
+        return false;
+
+    bigEndian = match.captured(1) == "be";
+    isSigned = match.captured(2) == "s";
+    realBits = match.captured(3).toInt();
+    storageBytes = storageBits / 8;
+    shift = match.captured(5).toInt();
+    return realBits > 0 && realBits <= storageBits;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file iiobuffer.h
+ * @brief IIO触发缓冲区读取类的头文件
+ * @details 通过/dev/iio:deviceX的触发缓冲区一次读取一批ADC采样，代替逐个读取sysfs的in_voltageX_raw
+ */
+#ifndef IIOBUFFER_H
+#define IIOBUFFER_H
+
+#include <QString>
+
+/**
+ * @class IioBuffer
+ * @brief IIO触发缓冲区读取类
+ * @details open()依次完成：使能通道的scan_elements、解析采样格式、设置触发器和采样频率、
+ *          设置缓冲区长度并使能缓冲区，然后以非阻塞方式打开字符设备。
+ *          触发器默认通过configfs创建hrtimer软件触发器，
+ *          也可以用环境变量SMARTHOME_IIO_TRIGGER指定已有的触发器(例如STM32定时器触发器"tim6_trgo")。
+ *          缓冲区使能期间sysfs的in_voltageX_raw不可读(EBUSY)，close()时关闭缓冲区。
+ *          只使能一个通道、不使能时间戳，每个扫描就是一个采样
+ */
+class IioBuffer
+{
+public:
+    /**
+     * @brief 构造函数
+     */
+    IioBuffer();
+
+    /**
+     * @brief 析构函数，关闭缓冲区
+     */
+    ~IioBuffer();
+
+    /**
+     * @brief 配置并打开触发缓冲区
+     * @param device IIO设备名，例如"iio:device0"
+     * @param channel 通道名，例如"in_voltage10"
+     * @param samplingHz 采样频率，单位Hz
+     * @param length 缓冲区可以保存的采样数，应大于两次读取之间产生的采样数
+     * @return 成功返回true；驱动或内核不支持时返回false，调用方应改用sysfs逐个读取
+     */
+    bool open(const QString &device, const QString &channel, int samplingHz, int length);
+
+    /**
+     * @brief 关闭缓冲区，恢复sysfs逐个读取
+     */
+    void close();
+
+    /**
+     * @brief 缓冲区是否已打开
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief 用一次read()取出缓冲区中已有的采样
+     * @param raw 输出的ADC原始值
+     * @param max 最多读取的采样数
+     * @return 读到的采样数，缓冲区为空时返回0，出错返回-1
+     */
+    int read(float *raw, int max);
+
+private:
+    Q_DISABLE_COPY(IioBuffer)
+
+    bool setupTrigger(const QString &devicePath, int samplingHz);   ///< 设置触发器和采样频率
+    bool parseType(const QString &type);                            ///< 解析in_voltageX_type
+
+    int fd;                 ///< 字符设备描述符
+    QString devicePath;     ///< sysfs中的设备目录
+    QString channelName;    ///< 通道名
+    bool bigEndian;         ///< 采样是否为大端
+    bool isSigned;          ///< 采样是否有符号
+    int realBits;           ///< 有效位数
+    int storageBytes;       ///< 每个采样占用的字节数(2或4)
+    int shift;              ///< 有效位的右移位数
+};
+
+#endif // IIOBUFFER_H
@@ -3,21 +3,112 @@
  * @brief MQ-135气体传感器驱动类的实现文件
  */
 #include "mq135.h"
+#include "../metrics/metrics.h"
+#include <QDateTime>
 #include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
 #include <cmath>
+#include <string.h>
+
+/*
+ * 快速对数/指数近似，用于批量换算。
+ * log2: 尾数规约到[sqrt(0.5), sqrt(2))后用atanh级数展开到s^7，绝对误差约6e-7；
+ * exp2: 就近取整后对[-0.5, 0.5]的小数部分用6阶泰勒展开，相对误差约9e-7；
+ * 代入ppm = A * 2^(B*log2(Rs/R0))后相对误差约2e-6。
+ * 全部用整数位运算和乘加实现，没有分支和库函数调用，便于编译器向量化
+ */
+static inline float fastLog2(float x)
+{
+    qint32 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    qint32 e = ((bits + 0x004afb0d) >> 23) - 127;   // 0x004afb0d = 2.0的位模式 - sqrt(2)的位模式
+    bits -= (qint32)((quint32)e << 23);     // e可能为负，负数左移是未定义行为
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+
+    /* log2(m) = 2/ln2 * (s + s^3/3 + s^5/5 + s^7/7), s = (m-1)/(m+1) */
+    float s = (m - 1.0f) / (m + 1.0f);
+    float s2 = s * s;
+    float p = s * (2.8853900818f + s2 * (0.9617966939f + s2 * (0.5770780164f + s2 * 0.4121985831f)));
+    return (float)e + p;
+}
+
+static inline float fastExp2(float y)
+{
+    /* 参数范围由调用方保证在(-126, 126)内 */
+    qint32 i = (qint32)(y + 127.5f) - 127;
+    float x = (y - (float)i) * 0.6931471806f;
+    float p = 1.0f + x * (1.0f + x * (0.5f + x * (1.0f / 6 + x * (1.0f / 24 + x * (1.0f / 120 + x * (1.0f / 720))))));
+    qint32 bits;
+    memcpy(&bits, &p, sizeof(bits));
+    bits += (qint32)((quint32)i << 23);
+    memcpy(&p, &bits, sizeof(p));
+    return p;
+}
+
+/*
+ * 把正浮点数限制在[lo, hi]内。正浮点数的位模式与数值同序，按整数比较可以向量化；
+ * 负数、无穷大和NaN也会被限制到边界
+ */
+static inline float clampRatio(float x, qint32 lo, qint32 hi)
+{
+    qint32 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = bits < lo ? lo : bits;
+    bits = bits > hi ? hi : bits;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+static qint32 floatBits(float x)
+{
+    qint32 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+/* Rs/R0的有效范围，对应浓度约3.6e7到4.6e-7 ppm，超出时(ADC为0或满量程)取边界值 */
+static const float MinRatio = 1e-3f;
+static const float MaxRatio = 1e3f;
+/*
+ * 滤波参数：触发缓冲区10Hz采样时9点中值加EMA，时间常数约1秒；
+ * sysfs每秒读取一次时只做3点中值，不做EMA，浓度突升后约2秒反映到输出，不拖慢报警
+ */
+static const int BufferedMedianLength = 9;
+static const float BufferedAlpha = 0.1f;
+static const int PolledMedianLength = 3;
+static const float PolledAlpha = 1.0f;
+/* 触发缓冲区连续多少次读不到采样时认为触发器没有工作，改用sysfs逐个读取 */
+static const int MaxEmptyBursts = 3;
+/* 每天的毫秒数 */
+static const qint64 DayMs = 24 * 3600 * 1000LL;
 
 /**
  * @brief MQ-135类构造函数
  * @param parent 父对象指针
- * @details 初始化MQ-135传感器设备文件路径
+ * @details 初始化ADC通道，读取一次缩放系数等元数据
  */
 mq135::mq135(QObject *parent)
+    : mq135("iio:device0", "voltage10", parent)
+{
+}
+
+/**
+ * @brief MQ-135类构造函数
+ * @param device IIO设备名
+ * @param channel ADC通道名
+ * @param parent 父对象指针
+ * @details 传感器接在其它ADC通道上时使用
+ */
+mq135::mq135(const QString &device, const QString &channel, QObject *parent)
+    : adcdevice(device), adcchannel(channel), adc(device, channel)
 {
     this->setParent(parent);
-    // 设置原始数据文件路径
-    rawdatafile.setFileName("/sys/bus/iio/devices/iio:device0/in_voltage10_raw");
-    // 设置数据缩放系数文件路径
-    scalefile.setFileName("/sys/bus/iio/devices/iio:device0/in_voltage_scale");
 }
 
 /**
@@ -27,6 +118,32 @@ mq135::~mq135()
 {
 }
 
+/**
+ * @brief 读取ADC原始值和缩放系数
+ * @param raw 输出的ADC原始值(已加上偏移量)
+ * @param scale 输出的缩放系数，单位mV
+ * @return 读取成功且元数据有效返回true
+ * @details 读取耗时和失败次数记录到运行指标
+ */
+bool mq135::readraw(float &raw, float &scale)
+{
+    static MetricHistogram *latency = Metrics::histogram("mq135.read_us");
+    static MetricCounter *errors = Metrics::counter("mq135.read_errors");
+    MetricTimer timer(latency);
+
+    /* 常驻描述符上的一次pread，缩放系数和偏移量使用缓存的元数据 */
+    int value;
+    if (!adc.readRaw(value) || !adc.info().valid) {
+        errors->add();
+        raw = 0;
+        scale = 0;
+        return false;
+    }
+    raw = (float)(value + adc.info().offset);
+    scale = (float)adc.info().scale;
+    return true;
+}
+
 /**
  * @brief 读取MQ-135的原始输出电压
  * @return 返回传感器的输出电压值，单位为V
@@ -34,45 +151,124 @@ mq135::~mq135()
  */
 float mq135::readmq135value()
 {
-    float rawdata = 0;    // ADC原始值
-    float scale = 0;      // ADC缩放系数
-    float vout;           // 输出电压
+    float rawdata;    // ADC原始值
+    float scale;      // ADC缩放系数
+    readraw(rawdata, scale);
 
-    QString dht11_value = NULL;
-    // 检查文件是否存在
-    if (!(rawdatafile.exists() && scalefile.exists()))
-        return 0;
+    /* 计算模拟电压: 原始值 * 缩放系数 / 1000(转换为V) */
+    return (rawdata * scale) / 1000;
+}
+
+/**
+ * @brief 读取一批ADC原始值和缩放系数
+ * @param raw 输出的ADC原始值，至少BurstLength个
+ * @param scale 输出的缩放系数，单位mV
+ * @return 读到的采样数，没有新采样或读取失败返回0
+ * @details 第一次调用时尝试打开触发缓冲区，一次read()取出缓冲区中的全部采样；
+ *          缓冲区读取出错或连续MaxEmptyBursts次没有采样时关闭缓冲区，之后每次从sysfs读取一个采样
+ */
+int mq135::readburst(float *raw, float &scale)
+{
+    static MetricCounter *buffered = Metrics::counter("mq135.buffer_samples");
 
-    /* 读取原始值和精度 */
-    if(rawdatafile.open(QIODevice::ReadOnly)) {
-        rawdata = QString(rawdatafile.readAll()).toFloat();
-    } else {
-        qDebug()<<"error open file:"<<rawdatafile.errorString();
+    if (!buffertried) {
+        buffertried = true;
+        if (buffer.open(adcdevice, "in_" + adcchannel, SamplingHz, SamplingHz * 4)) {
+            filter.setMedianLength(BufferedMedianLength);
+            filter.setAlpha(BufferedAlpha);
+            qDebug()<<"MQ-135使用IIO触发缓冲区，采样频率"<<SamplingHz<<"Hz";
+        } else {
+            filter.setMedianLength(PolledMedianLength);
+            filter.setAlpha(PolledAlpha);
+        }
     }
-    rawdatafile.close();
-    
-    if(scalefile.open(QIODevice::ReadOnly)) {
-        scale = QString(scalefile.readAll()).toFloat();
-    } else {
-        qDebug()<<"error open file:"<<scalefile.errorString();
+
+    if (buffer.isOpen()) {
+        int n = buffer.read(raw, BurstLength);
+        if (n > 0) {
+            emptybursts = 0;
+            buffered->add(n);
+            const IioChannelInfo &info = adc.info();
+            scale = (float)info.scale;
+            for (int i = 0; info.offset != 0 && i < n; i++)
+                raw[i] += (float)info.offset;
+            return info.valid ? n : 0;
+        }
+        if (n == 0 && ++emptybursts < MaxEmptyBursts)
+            return 0;
+
+        qDebug()<<"IIO触发缓冲区没有采样，改用sysfs逐个读取";
+        buffer.close();
+        filter.setMedianLength(PolledMedianLength);
+        filter.setAlpha(PolledAlpha);
     }
-    scalefile.close();
 
-    /* 计算模拟电压: 原始值 * 缩放系数 / 1000(转换为V) */
-    vout = (rawdata * scale) / 1000;
-    return vout;
+    return readraw(raw[0], scale) && raw[0] > 0 ? 1 : 0;
+}
+
+/**
+ * @brief 采样进入校准窗口
+ * @details 窗口满后尝试更新自动基线
+ */
+void mq135::addCalibrationSample(float raw, float scale)
+{
+    if (scale != windowscale) {
+        rscount = 0;
+        windowscale = scale;
+    }
+    rswindow[rscount++] = raw;
+    if (rscount == CalibrationWindow) {
+        float rs = calibrateR0(rswindow, rscount, scale);
+        if (rs > 0)
+            updateBaseline(rs, QDateTime::currentMSecsSinceEpoch() / DayMs);
+        rscount = 0;
+    }
 }
 
 /**
  * @brief 计算空气中CO2等污染物的浓度
+ * @return 返回滤波后的PPM浓度值，保留一位小数(四舍五入)
+ * @details 一批采样先用批量换算的快速路径计算浓度，再逐个进入滤波器；
+ *          这一批的中值进入校准窗口，使校准窗口的时间跨度与采样频率无关；当前R0记录到运行指标
+ */
+float mq135::calculateppm(float *peak, bool *fresh)
+{
+    static MetricGauge *r0gauge = Metrics::gauge("mq135.r0_ohm");
+    r0gauge->set((qint64)(R0 * 1000));
+
+    float raw[BurstLength];
+    float ppm[BurstLength];
+    float scale;
+    int n = readburst(raw, scale);
+    if (n > 0) {
+        convertppm(raw, ppm, n, scale);
+        float highest = ppm[0];
+        for (int i = 0; i < n; i++) {
+            filter.push(ppm[i]);
+            highest = qMax(highest, ppm[i]);
+        }
+        if (peak)
+            *peak = (float)(int)(highest * 10 + 0.5f) / 10;
+
+        std::nth_element(raw, raw + n / 2, raw + n);
+        addCalibrationSample(raw[n / 2], scale);
+    }
+    if (fresh)
+        *fresh = n > 0;
+    float value = (float)(int)(filter.value() * 10 + 0.5f) / 10;
+    if (peak && n <= 0)
+        *peak = value;
+    return value;
+}
+
+/**
+ * @brief 由传感器输出电压换算污染物浓度
+ * @param vrl 传感器输出电压，单位为V
  * @return 返回计算得到的PPM浓度值，保留一位小数
- * @details 通过传感器电阻值和公式计算空气中污染物的浓度
- *          公式: ppm = A * (Rs/R0)^B, 其中Rs为当前传感器电阻，R0为洁净空气中电阻
+ * @details 公式: ppm = A * (Rs/R0)^B, 其中Rs为当前传感器电阻，R0为洁净空气中电阻
  */
-float mq135::calculateppm()
+float mq135::ppmFromVoltage(float vrl) const
 {
-    // 读取电压值
-    float vrl = readmq135value();
     // 计算传感器电阻值: Rs = (Vc-Vrl)*RL/Vrl
     float rs = (VC - vrl) * RL / vrl;
     // 计算电阻比: Rs/R0
@@ -87,3 +283,165 @@ float mq135::calculateppm()
     return ppm;
 }
 
+/**
+ * @brief 把一个窗口的ADC原始值批量换算为污染物浓度
+ * @details ppm = A * (Rs/R0)^B = A * 2^(B * log2(Rs/R0))；
+ *          参数先复制到局部变量，避免输出数组与成员变量可能重叠而阻止向量化
+ */
+void mq135::convertppm(const float *raw, float *ppm, int count, float scale) const
+{
+    const float k = scale / 1000;
+    const float vc = VC;
+    const float rl = RL / R0;
+    const float a = A;
+    const float b = B;
+    const qint32 lo = floatBits(MinRatio);
+    const qint32 hi = floatBits(MaxRatio);
+
+    for (int i = 0; i < count; i++) {
+        float vrl = raw[i] * k;
+        float ratio = clampRatio((vc - vrl) * rl / vrl, lo, hi);
+        ppm[i] = a * fastExp2(b * fastLog2(ratio));
+    }
+}
+
+/**
+ * @brief 由洁净空气中的一个采样窗口计算R0
+ * @details 取Rs的10%、50%、90%分位数，分位数之间相差过大说明空气或传感器在变化(例如刚上电预热)，
+ *          不用于校准
+ */
+float mq135::calibrateR0(const float *raw, int count, float scale) const
+{
+    if (count < CalibrationWindow / 10 || count > CalibrationWindow || scale <= 0)
+        return 0;
+
+    float rs[CalibrationWindow];
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        float vrl = raw[i] * scale / 1000;
+        if (vrl > 0 && vrl < VC)
+            rs[n++] = (VC - vrl) * RL / vrl;
+    }
+    if (n < count * 9 / 10)
+        return 0;
+
+    std::nth_element(rs, rs + n / 10, rs + n);
+    float low = rs[n / 10];
+    std::nth_element(rs, rs + n * 9 / 10, rs + n);
+    float high = rs[n * 9 / 10];
+    std::nth_element(rs, rs + n / 2, rs + n);
+    float median = rs[n / 2];
+
+    if (high - low > median * 0.05f)
+        return 0;
+    return median;
+}
+
+/**
+ * @brief 用一个稳定窗口的Rs更新自动基线
+ * @param rs 窗口的Rs中位数
+ * @param day 自1970-01-01起的天数
+ * @details 污染物使Rs下降，一天内最大的Rs最接近洁净空气；R0取最近7天的最大值，
+ *          变化超过0.5%或开始新的一天时写回校准文件
+ */
+void mq135::updateBaseline(float rs, qint64 day)
+{
+    BaselineSlot &slot = baseline[day % BaselineDays];
+    bool changed = slot.day != day;
+    if (changed) {
+        slot.day = day;
+        slot.rs = rs;
+    } else if (rs > slot.rs) {
+        slot.rs = rs;
+    }
+
+    float r0 = 0;
+    for (const BaselineSlot &s : baseline) {
+        if (s.day > day - BaselineDays && s.rs > r0)
+            r0 = s.rs;
+    }
+    if (r0 > 0 && qAbs(r0 - R0) > R0 * 0.005f) {
+        qDebug()<<"MQ-135基线更新: R0"<<R0<<"->"<<r0;
+        R0 = r0;
+        changed = true;
+    }
+    if (changed)
+        saveCalibration();
+}
+
+/**
+ * @brief 当前使用的R0
+ */
+float mq135::r0() const
+{
+    return R0;
+}
+
+/**
+ * @brief 手动设置R0
+ * @details 清除自动基线，之后的稳定窗口从新的R0开始重新积累
+ */
+void mq135::setR0(float r0)
+{
+    if (r0 <= 0)
+        return;
+    R0 = r0;
+    for (BaselineSlot &slot : baseline)
+        slot = BaselineSlot();
+    saveCalibration();
+}
+
+/**
+ * @brief 读取校准文件
+ * @details 文件格式为 {"r0":<R0>,"baseline":[[天数,Rs],...]}
+ */
+bool mq135::loadCalibration(const QString &path)
+{
+    calibrationpath = path;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+
+    float r0 = (float)json.value("r0").toDouble();
+    if (r0 <= 0)
+        return false;
+    R0 = r0;
+
+    QJsonArray entries = json.value("baseline").toArray();
+    for (const QJsonValue &value : entries) {
+        QJsonArray entry = value.toArray();
+        qint64 day = (qint64)entry.at(0).toDouble(-1);
+        if (day < 0)
+            continue;
+        BaselineSlot &slot = baseline[day % BaselineDays];
+        slot.day = day;
+        slot.rs = (float)entry.at(1).toDouble();
+    }
+    return true;
+}
+
+/**
+ * @brief 保存校准文件
+ * @details 先写临时文件再替换，掉电时不会留下写了一半的文件
+ */
+void mq135::saveCalibration() const
+{
+    if (calibrationpath.isEmpty())
+        return;
+
+    QJsonArray entries;
+    for (const BaselineSlot &slot : baseline) {
+        if (slot.day >= 0)
+            entries.append(QJsonArray{ slot.day, slot.rs });
+    }
+    QJsonObject json;
+    json.insert("r0", R0);
+    json.insert("baseline", entries);
+
+    QSaveFile file(calibrationpath);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(QJsonDocument(json).toJson(QJsonDocument::Compact)) < 0 || !file.commit())
+        qDebug()<<"无法保存MQ-135校准文件"<<calibrationpath;
+}
@@ -7,26 +7,66 @@
 #define MQ135_H
 
 #include <QObject>
-#include <QFile>
+#include "iiobuffer.h"
+#include "../sysfs/iiochannel.h"
+#include "samplefilter.h"
 
 /**
  * @class mq135
  * @brief MQ-135气体传感器驱动类
- * @details 负责与MQ-135气体传感器通信，获取传感器的数据并计算空气质量指标
+ * @details 负责与MQ-135气体传感器通信，获取传感器的数据并计算空气质量指标。
+ *          R0(洁净空气中的电阻)由自动基线校准得到：每个校准窗口的采样稳定时取Rs中位数，
+ *          按天保留最大值，最近7天中的最大值作为R0，即认为一周内至少有一段时间是洁净空气。
+ *          校准结果保存在校准文件中，重启后继续使用。
+ *          支持IIO触发缓冲区时以SamplingHz采样，每次调用一次read()取出上次调用以来的全部采样；
+ *          不支持时退回到sysfs逐个读取。采样换算为浓度后经过中值+EMA滤波再输出
  */
 class mq135 : public QObject
 {
     Q_OBJECT
 
+public:
+    enum {
+        CalibrationWindow = 300,    ///< 校准窗口的采样数，每秒采样一次时为5分钟
+        BaselineDays = 7,           ///< 自动基线保留的天数
+        SamplingHz = 10,            ///< 触发缓冲区的采样频率
+        BurstLength = 64            ///< 一次最多读取的采样数
+    };
+
 private:
     float RL = 1.0;          ///< 负载电阻值，单位为KΩ
-    float R0 = 34.0;         ///< 传感器在洁净空气中的电阻值，单位为KΩ
+    float R0 = 34.0;         ///< 传感器在洁净空气中的电阻值，单位为KΩ，校准前使用典型值
     float VC = 5.0;          ///< 供电电压，单位为V
     float A = 4.103;         ///< 浓度计算公式参数A
     float B = -2.317;        ///< 浓度计算公式参数B
 
-    QFile rawdatafile;       ///< 文件对象，用于访问传感器原始数据文件
-    QFile scalefile;         ///< 文件对象，用于访问传感器数据缩放系数文件
+    QString adcdevice;       ///< IIO设备名
+    QString adcchannel;      ///< ADC通道名
+    IioChannel adc;          ///< ADC通道，缩放系数只读取一次，原始值通过常驻描述符读取
+
+    /**
+     * @brief 自动基线中一天的记录
+     */
+    struct BaselineSlot {
+        qint64 day = -1;     ///< 自1970-01-01起的天数，-1表示空
+        float rs = 0;        ///< 当天稳定窗口Rs中位数的最大值，单位为KΩ
+    };
+    BaselineSlot baseline[BaselineDays];    ///< 按天数取模存放的自动基线
+    float rswindow[CalibrationWindow];      ///< 当前校准窗口的原始值
+    int rscount = 0;                        ///< 当前校准窗口已有的采样数
+    float windowscale = 0;                  ///< 当前校准窗口的缩放系数
+    QString calibrationpath;                ///< 校准文件路径，为空时不保存
+
+    IioBuffer buffer;                       ///< IIO触发缓冲区
+    bool buffertried = false;               ///< 是否已尝试打开触发缓冲区
+    int emptybursts = 0;                    ///< 触发缓冲区连续读不到采样的次数
+    SampleFilter filter;                    ///< 浓度的中值+EMA滤波器
+
+    bool readraw(float &raw, float &scale);     ///< 读取ADC原始值和缩放系数
+    int readburst(float *raw, float &scale);    ///< 读取一批ADC原始值(最多BurstLength个)和缩放系数
+    void addCalibrationSample(float raw, float scale);  ///< 采样进入校准窗口
+    void updateBaseline(float rs, qint64 day);  ///< 用一个稳定窗口的Rs更新自动基线
+    void saveCalibration() const;               ///< 保存校准文件
 
 public:
     /**
@@ -34,7 +74,15 @@ public:
      * @param parent 父对象指针
      */
     mq135(QObject *parent = nullptr);
-    
+
+    /**
+     * @brief 构造函数
+     * @param device IIO设备名，例如"iio:device0"
+     * @param channel ADC通道名(不含in_前缀)，例如"voltage10"
+     * @param parent 父对象指针
+     */
+    mq135(const QString &device, const QString &channel, QObject *parent = nullptr);
+
     /**
      * @brief 析构函数
      */
@@ -45,12 +93,60 @@ public:
      * @return 返回传感器的输出电压值，单位为V
      */
     float readmq135value();
-    
+
     /**
      * @brief 计算空气中CO2等污染物的浓度
+     * @param peak 输出本次读到的采样中未经滤波的最大浓度，没有新采样时等于返回值；可以为空
+     * @param fresh 输出本次是否读到了新采样，为false时返回值是上一次的滤波值(或0)，不代表当前浓度；可以为空
+     * @return 返回滤波后的PPM浓度值，还没有读到过采样时返回0
+     * @details 读取上次调用以来的全部采样，批量换算后经过中值+EMA滤波；
+     *          每次调用取一个采样(一批的中值)进入自动基线校准窗口
+     */
+    float calculateppm(float *peak = nullptr, bool *fresh = nullptr);
+
+    /**
+     * @brief 由传感器输出电压换算污染物浓度，不读取文件
+     * @param vrl 传感器输出电压，单位为V
      * @return 返回计算得到的PPM浓度值
-     * @details 通过传感器电阻值和公式计算空气中污染物的浓度
      */
-    float calculateppm();
+    float ppmFromVoltage(float vrl) const;
+
+    /**
+     * @brief 把一个窗口的ADC原始值批量换算为污染物浓度
+     * @param raw ADC原始值
+     * @param ppm 输出的PPM浓度值，可以与raw指向同一块内存
+     * @param count 采样数
+     * @param scale ADC缩放系数(in_voltage_scale，单位mV)
+     * @details 使用快速对数/指数近似代替pow()，与双精度pow()相比相对误差小于1e-5；
+     *          循环中没有函数调用和浮点分支，编译器可以自动向量化
+     */
+    void convertppm(const float *raw, float *ppm, int count, float scale) const;
+
+    /**
+     * @brief 由洁净空气中的一个采样窗口计算R0
+     * @param raw ADC原始值
+     * @param count 采样数，在CalibrationWindow/10到CalibrationWindow之间
+     * @param scale ADC缩放系数(in_voltage_scale，单位mV)
+     * @return 窗口稳定(Rs的10%~90%分位数相差不超过中位数的5%)时返回Rs中位数，否则返回0
+     */
+    float calibrateR0(const float *raw, int count, float scale) const;
+
+    /**
+     * @brief 当前使用的R0，单位为KΩ
+     */
+    float r0() const;
+
+    /**
+     * @brief 手动设置R0(例如在洁净空气中用calibrateR0()得到)
+     * @param r0 洁净空气中的电阻值，单位为KΩ
+     */
+    void setR0(float r0);
+
+    /**
+     * @brief 读取校准文件，之后自动基线更新时写回该文件
+     * @param path 校准文件路径
+     * @return 文件存在且有效返回true
+     */
+    bool loadCalibration(const QString &path);
 };
 #endif // MQ135_H
@@ -1,5 +1,12 @@
 SOURCES += \
-    ../MQ-135/mq135.cpp
+    ../MQ-135/iiobuffer.cpp \
+    ../MQ-135/mq135.cpp \
+    ../MQ-135/samplefilter.cpp
 
 HEADERS += \
-    ../MQ-135/mq135.h
+    ../MQ-135/iiobuffer.h \
+    ../MQ-135/mq135.h \
+    ../MQ-135/samplefilter.h
+
+# 批量浓度换算的循环依赖编译器自动向量化，GCC在-O3以下默认不开启
+QMAKE_CXXFLAGS_RELEASE += -ftree-vectorize
@@ -0,0 +1,104 @@
+/**
+ * @file samplefilter.cpp
+ * @brief 中值+指数滑动平均滤波器的实现文件
+ */
+#include "samplefilter.h"
+
+/**
+ * @brief SampleFilter类构造函数
+ * @param alpha EMA系数
+ */
+SampleFilter::SampleFilter(float alpha)
+    : alpha(alpha > 0 && alpha <= 1 ? alpha : 1), length(MaxMedianLength)
+{
+    reset();
+}
+
+/**
+ * @brief 修改EMA系数
+ */
+void SampleFilter::setAlpha(float alpha)
+{
+    if (alpha > 0 && alpha <= 1)
+        this->alpha = alpha;
+}
+
+/**
+ * @brief 修改中值窗口长度
+ */
+void SampleFilter::setMedianLength(int length)
+{
+    if (length < 1 || length > MaxMedianLength || length == this->length)
+        return;
+    this->length = length;
+    reset();
+}
+
+/**
+ * @brief 加入一个采样
+ * @details 窗口满时先从有序数组中删除最旧的采样，再按插入排序放入新采样
+ */
+float SampleFilter::push(float sample)
+{
+    int n = count;
+    if (count == length) {
+        /* 删除最旧的采样 */
+        float old = ring[oldest];
+        int i = 0;
+        while (i < n - 1 && sorted[i] != old)
+            i++;
+        for (; i < n - 1; i++)
+            sorted[i] = sorted[i + 1];
+        n--;
+
+        ring[oldest] = sample;
+        oldest = (oldest + 1) % length;
+    } else {
+        ring[count++] = sample;
+    }
+
+    /* 插入新采样 */
+    int i = n;
+    while (i > 0 && sorted[i - 1] > sample) {
+        sorted[i] = sorted[i - 1];
+        i--;
+    }
+    sorted[i] = sample;
+
+    float median = (count & 1) ? sorted[count / 2]
+                               : (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+    if (!started) {
+        ema = median;
+        started = true;
+    } else {
+        ema += alpha * (median - ema);
+    }
+    return ema;
+}
+
+/**
+ * @brief 当前滤波后的值
+ */
+float SampleFilter::value() const
+{
+    return started ? ema : 0;
+}
+
+/**
+ * @brief 已加入的采样数是否足以填满中值窗口
+ */
+bool SampleFilter::settled() const
+{
+    return count == length;
+}
+
+/**
+ * @brief 清空窗口和EMA状态
+ */
+void SampleFilter::reset()
+{
+    count = 0;
+    oldest = 0;
+    ema = 0;
+    started = false;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file samplefilter.h
+ * @brief 中值+指数滑动平均滤波器的头文件
+ * @details 用于ADC采样：中值滤除单点毛刺，指数滑动平均抑制随机噪声
+ */
+#ifndef SAMPLEFILTER_H
+#define SAMPLEFILTER_H
+
+/**
+ * @class SampleFilter
+ * @brief 增量中值+指数滑动平均(EMA)滤波器
+ * @details 每个新采样先进入长度为length的滑动窗口(默认MaxMedianLength)取中值，中值再进入EMA：
+ *          ema += alpha * (median - ema)。
+ *          滑动窗口同时按时间顺序(环形)和数值顺序保存，新采样替换最旧的采样后
+ *          只需在有序数组中移动一次，每个采样O(length)，不分配内存。
+ *          采样频率低时应缩短窗口：窗口长度为n时，阶跃变化要n/2个采样之后才能反映到输出
+ */
+class SampleFilter
+{
+public:
+    enum {
+        MaxMedianLength = 9 ///< 中值滤波窗口的最大长度
+    };
+
+    /**
+     * @brief 构造函数
+     * @param alpha EMA系数(0, 1]，越小越平滑，1表示只做中值滤波
+     */
+    explicit SampleFilter(float alpha = 0.1f);
+
+    /**
+     * @brief 修改EMA系数，不清空已有状态
+     * @param alpha EMA系数(0, 1]
+     */
+    void setAlpha(float alpha);
+
+    /**
+     * @brief 修改中值窗口长度，长度变化时清空窗口和EMA状态
+     * @param length 窗口长度[1, MaxMedianLength]，1表示不做中值滤波
+     */
+    void setMedianLength(int length);
+
+    /**
+     * @brief 加入一个采样
+     * @param sample 采样值
+     * @return 滤波后的值
+     * @details 窗口未满时对已有的采样取中值，第一个采样直接作为EMA初值
+     */
+    float push(float sample);
+
+    /**
+     * @brief 当前滤波后的值，还没有采样时返回0
+     */
+    float value() const;
+
+    /**
+     * @brief 已加入的采样数是否足以填满中值窗口
+     */
+    bool settled() const;
+
+    /**
+     * @brief 清空窗口和EMA状态
+     */
+    void reset();
+
+private:
+    float alpha;                    ///< EMA系数
+    int length;                     ///< 中值窗口长度
+    float ring[MaxMedianLength];    ///< 按时间顺序保存的采样
+    float sorted[MaxMedianLength];  ///< 按数值顺序保存的采样
+    int count;                      ///< 窗口中的采样数
+    int oldest;                     ///< 最旧采样在ring中的位置
+    float ema;                      ///< EMA当前值
+    bool started;                   ///< EMA是否已初始化
+};
+
+#endif // SAMPLEFILTER_H
@@ -3,7 +3,9 @@
  * @brief 蜂鸣器控制类的实现文件
  */
 #include "beep.h"
-#include <QDebug>
+#include "../metrics/metrics.h"
+#include "../log/log.h"
+#include "../sysfs/sysfspath.h"
 
 /**
  * @brief 蜂鸣器类构造函数
@@ -14,7 +16,7 @@ beep::beep(QObject *parent)
 {
     this->setParent(parent);
     // 设置蜂鸣器控制接口文件路径
-    file.setFileName("/sys/devices/platform/leds/leds/beep/brightness");
+    output.setPath(sysfsPath("/sys/devices/platform/leds/leds/beep/brightness"));
 }
 
 /**
@@ -27,28 +29,19 @@ beep::~beep()
 /**
  * @brief 设置蜂鸣器的状态
  * @param flag 蜂鸣器状态，true表示打开，false表示关闭
- * @details 通过向系统文件写入0或1控制蜂鸣器的开关
+ * @details 通过向系统文件写入0或1控制蜂鸣器的开关，
+ *          报警逻辑每个周期都会调用本函数，状态未改变时不产生写入
  */
 void beep::setBeepState(bool flag)
 {
-    qDebug()<<flag<<endl;
+    static MetricHistogram *latency = Metrics::histogram("beep.write_us");
+    static MetricCounter *errors = Metrics::counter("beep.write_errors");
+    MetricTimer timer(latency);
 
-    /* 如果文件不存在，则返回 */
-    if (!file.exists())
-        return;
-
-    if(!file.open(QIODevice::ReadWrite))
-        qDebug()<<file.errorString();
-
-    QByteArray buf[2] = {"0", "1"};
+    LOG_DEBUG() << "蜂鸣器状态:" << flag;
 
     // 写入1表示开启蜂鸣器，0表示关闭蜂鸣器
-    if (flag)
-        file.write(buf[1]);
-    else
-        file.write(buf[0]);
-
-    /* 关闭文件 */
-    file.close();
+    if (!output.setState(flag))
+        errors->add();
 }
 
@@ -7,7 +7,7 @@
 #define BEEP_H
 
 #include <QObject>
-#include <QFile>
+#include "../sysfs/sysfsoutput.h"
 
 /**
  * @class beep
@@ -20,10 +20,10 @@ class beep : public QObject
 
 private:
     /**
-     * @brief 文件对象
-     * @details 用于访问蜂鸣器设备控制文件
+     * @brief sysfs输出对象
+     * @details 常驻打开蜂鸣器的brightness文件，状态未变化时不写入
      */
-    QFile file;
+    SysfsOutput output;
 
 public:
     /**
@@ -26,3 +26,7 @@ HEADERS += \
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
+
+include(../sysfs/sysfs.pri)
+include(../metrics/metrics.pri)
+include(../log/log.pri)
@@ -0,0 +1,37 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+# 基准测试默认按release构建，debug构建的结果没有对比意义
+CONFIG -= debug
+CONFIG += release
+
+# The following define makes your compiler emit warnings if you use
+# any Qt feature that has been marked deprecated (the exact warnings
+# depend on your compiler). Please consult the documentation of the
+# deprecated API in order to know how to port your code away from it.
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    ../esp8266/atparser.cpp \
+    ../esp8266/payloadencoder.cpp \
+    main.cpp
+
+HEADERS += \
+    ../esp8266/atparser.h \
+    ../esp8266/outbox.h \
+    ../esp8266/payloadencoder.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
+
+include(../led/led.pri)
+include(../relay/relay.pri)
+include(../MQ-135/mq135.pri)
+include(../sysfs/sysfs.pri)
+include(../metrics/metrics.pri)
+include(../log/log.pri)
@@ -0,0 +1,348 @@
+/**
+ * @file main.cpp
+ * @brief 性能基准测试入口
+ * @details 覆盖AT响应解析、上传数据编码、MQ-135浓度换算和LED/继电器写入，
+ *          每项结果输出为一行JSON(JSON Lines)，便于不同版本之间对比：
+ *          @code
+ *          ./benchmark > result.jsonl
+ *          ./benchmark --filter at_parser --scale 0.1
+ *          @endcode
+ *          设备写入在模拟sysfs目录树上进行，默认建在/dev/shm(tmpfs)下的临时目录中
+ */
+#include "../esp8266/atparser.h"
+#include "../esp8266/payloadencoder.h"
+#include "../MQ-135/mq135.h"
+#include "../led/led.h"
+#include "../relay/relay.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QVector>
+#include <algorithm>
+#include <stdio.h>
+
+/* 防止被测代码的结果被编译器优化掉 */
+static volatile qint64 sink;
+
+/**
+ * @class Bench
+ * @brief 基准测试运行器
+ * @details 每项测试先预热，再计时运行指定次数；
+ *          吞吐类测试整体计时，时延类测试逐次计时并给出分位数
+ */
+class Bench
+{
+public:
+    Bench(const QString &filter, double scale) : filter(filter), scale(scale) {}
+
+    /**
+     * @brief 输出运行环境信息，作为结果文件的第一行
+     */
+    void printMeta(const QString &sysfsRoot) const
+    {
+        QJsonObject meta;
+        meta.insert("meta", true);
+        meta.insert("time", QDateTime::currentDateTime().toString(Qt::ISODate));
+        meta.insert("qt", QString(qVersion()));
+        meta.insert("cpu", QSysInfo::currentCpuArchitecture());
+        meta.insert("kernel", QSysInfo::kernelVersion());
+#ifdef QT_NO_DEBUG
+        meta.insert("build", QString("release"));
+#else
+        meta.insert("build", QString("debug"));
+#endif
+#ifdef __VERSION__
+        meta.insert("compiler", QString(__VERSION__));
+#endif
+        meta.insert("sysfs_root", sysfsRoot);
+        meta.insert("scale", scale);
+        emitLine(meta);
+    }
+
+    /**
+     * @brief 吞吐测试：整体计时运行iterations次
+     * @param name 测试名
+     * @param iterations 基准次数(乘以scale)
+     * @param bytesPerOp 每次处理的字节数，0表示不统计
+     * @param itemsPerOp 每次处理的条目数(响应、记录等)，0表示不统计
+     * @param body 被测代码，返回值计入sink
+     */
+    template <typename F>
+    void throughput(const char *name, qint64 iterations, qint64 bytesPerOp, qint64 itemsPerOp, F body)
+    {
+        if (!selected(name))
+            return;
+        iterations = scaled(iterations);
+
+        qint64 total = 0;
+        for (qint64 i = 0; i < iterations / 10 + 1; i++)
+            total += body();
+
+        QElapsedTimer timer;
+        timer.start();
+        for (qint64 i = 0; i < iterations; i++)
+            total += body();
+        qint64 ns = qMax<qint64>(timer.nsecsElapsed(), 1);
+        sink = total;
+
+        QJsonObject result = header(name, iterations, ns);
+        double seconds = ns / 1e9;
+        if (bytesPerOp > 0) {
+            result.insert("bytes_per_op", bytesPerOp);
+            result.insert("bytes_per_s", bytesPerOp * iterations / seconds);
+        }
+        if (itemsPerOp > 0) {
+            result.insert("items_per_op", itemsPerOp);
+            result.insert("items_per_s", itemsPerOp * iterations / seconds);
+        }
+        emitLine(result);
+    }
+
+    /**
+     * @brief 时延测试：逐次计时运行iterations次，输出中位数、p99和最大值
+     */
+    template <typename F>
+    void latency(const char *name, qint64 iterations, F body)
+    {
+        if (!selected(name))
+            return;
+        iterations = scaled(iterations);
+
+        qint64 total = 0;
+        for (qint64 i = 0; i < iterations / 10 + 1; i++)
+            total += body();
+
+        QVector<qint64> samples;
+        samples.reserve((int)iterations);
+        QElapsedTimer timer;
+        qint64 sum = 0;
+        for (qint64 i = 0; i < iterations; i++) {
+            timer.start();
+            total += body();
+            qint64 ns = timer.nsecsElapsed();
+            samples.append(ns);
+            sum += ns;
+        }
+        sink = total;
+
+        std::sort(samples.begin(), samples.end());
+        QJsonObject result = header(name, iterations, qMax<qint64>(sum, 1));
+        result.insert("p50_ns", samples[samples.size() / 2]);
+        result.insert("p99_ns", samples[(int)(samples.size() * 0.99)]);
+        result.insert("max_ns", samples.last());
+        emitLine(result);
+    }
+
+private:
+    bool selected(const char *name) const
+    {
+        return filter.isEmpty() || QString(name).contains(filter);
+    }
+
+    qint64 scaled(qint64 iterations) const
+    {
+        return qMax<qint64>(1, (qint64)(iterations * scale));
+    }
+
+    static QJsonObject header(const char *name, qint64 iterations, qint64 ns)
+    {
+        QJsonObject result;
+        result.insert("bench", QString(name));
+        result.insert("iterations", iterations);
+        result.insert("ns_per_op", (double)ns / iterations);
+        result.insert("ops_per_s", iterations / (ns / 1e9));
+        return result;
+    }
+
+    static void emitLine(const QJsonObject &object)
+    {
+        QByteArray line = QJsonDocument(object).toJson(QJsonDocument::Compact);
+        line += '\n';
+        fputs(line.constData(), stdout);
+        fflush(stdout);
+    }
+
+    QString filter;     ///< 只运行名字包含该字符串的测试
+    double scale;       ///< 运行次数缩放系数
+};
+
+/**
+ * @brief 构造模拟的ESP8266串口数据流
+ * @param subRecvOnly true时只包含控制命令帧
+ * @details 默认按实际运行中的比例混合回显、OK、发布结果、提示符和控制命令帧
+ */
+static QByteArray syntheticStream(bool subRecvOnly)
+{
+    const QByteArray subRecv =
+        "+MQTTSUBRECV:0,\"/k25r9vo1EmV/esp8266/user/get\",36,{\"relay\":\"open\",\"livingroomlight\":1}\r\n";
+    const QByteArray mixed =
+        "AT+MQTTPUBRAW=0,\"/k25r9vo1EmV/esp8266/user/update\",96,0,0\r\n\r\nOK\r\n\r\n>"
+        "\r\n+MQTTPUB:OK\r\n"
+        "AT+MQTTPUB=0,\"/k25r9vo1EmV/esp8266/user/update\",\"{\\\"ts\\\":1700000000000\\,\\\"humidity\\\":55}\",0,0\r\n"
+        "\r\nOK\r\n"
+        "WIFI GOT IP\r\n"
+        "+MQTTCONNECTED:0,1,\"iot-as-mqtt.cn-shanghai.aliyuncs.com\",\"1883\",\"\",1\r\n" + subRecv;
+
+    QByteArray stream;
+    const QByteArray &unit = subRecvOnly ? subRecv : mixed;
+    while (stream.size() < 64 * 1024)
+        stream += unit;
+    return stream;
+}
+
+/**
+ * @brief 按串口每次读到的块大小把数据流送入解析器
+ * @return 解析出的响应条数
+ */
+static qint64 parseStream(AtParser &parser, const QByteArray &stream, int chunk)
+{
+    qint64 responses = 0;
+    AtResponse response;
+    for (int pos = 0; pos < stream.size(); pos += chunk) {
+        parser.feed(stream.constData() + pos, qMin(chunk, stream.size() - pos));
+        while (parser.next(response))
+            responses++;
+    }
+    return responses;
+}
+
+/**
+ * @brief 一条典型的待上传数据
+ */
+static OutboxRecord sampleRecord(int i)
+{
+    OutboxRecord record;
+    record.timestamp = 1700000000000LL + i * 10000LL;
+    record.hasDht11 = true;
+    record.humidity = 40 + i % 20;
+    record.temperature = 20 + i % 10;
+    record.hasPpm = true;
+    record.ppm = 3.5f + (i % 7) * 0.1f;
+    record.ppmMax = record.ppm + 0.4f;
+    return record;
+}
+
+/**
+ * @brief 写入一个模拟的sysfs文件
+ */
+static bool writeFile(const QString &root, const char *path, const QByteArray &content)
+{
+    QString name = root + path;
+    QDir().mkpath(name.left(name.lastIndexOf('/')));
+    QFile file(name);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(content) == content.size();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser options;
+    options.setApplicationDescription("智能家居性能基准测试，结果以JSON Lines输出到标准输出");
+    options.addHelpOption();
+    QCommandLineOption filterOption("filter", "只运行名字包含该字符串的测试", "name");
+    QCommandLineOption scaleOption("scale", "运行次数缩放系数", "factor", "1");
+    QCommandLineOption rootOption("sysfs-root", "模拟sysfs目录树的位置，默认在/dev/shm下创建临时目录", "dir");
+    options.addOptions({ filterOption, scaleOption, rootOption });
+    options.process(app);
+
+    /* 模拟sysfs目录树必须在设备对象第一次解析路径之前准备好 */
+    QTemporaryDir tempDir(QDir("/dev/shm").exists() ? "/dev/shm/smarthome-bench-XXXXXX"
+                                                      : QDir::tempPath() + "/smarthome-bench-XXXXXX");
+    QString root = options.isSet(rootOption) ? options.value(rootOption) : tempDir.path();
+    bool ok = writeFile(root, "/sys/class/leds/sys-led/trigger", "none\n") &&
+              writeFile(root, "/sys/devices/platform/leds/leds/sys-led/brightness", "0\n") &&
+              writeFile(root, "/sys/class/leds/relay/brightness", "0\n") &&
+              writeFile(root, "/sys/bus/iio/devices/iio:device0/in_voltage10_raw", "3000\n") &&
+              writeFile(root, "/sys/bus/iio/devices/iio:device0/in_voltage_scale", "0.050354003\n");
+    if (!ok) {
+        fprintf(stderr, "无法创建模拟sysfs目录树: %s\n", qPrintable(root));
+        return 1;
+    }
+    qputenv("SMARTHOME_SYSFS_ROOT", QFile::encodeName(root));
+
+    Bench bench(options.value(filterOption), options.value(scaleOption).toDouble());
+    bench.printMeta(root);
+
+    /* AT响应解析：与serialPortReadyRead()相同的feed/next循环，64字节为一次串口读取 */
+    AtParser parser;
+    const QByteArray mixed = syntheticStream(false);
+    const qint64 mixedResponses = parseStream(parser, mixed, 64);
+    bench.throughput("at_parser.mixed", 200, mixed.size(), mixedResponses, [&]() {
+        return parseStream(parser, mixed, 64);
+    });
+    const QByteArray subRecv = syntheticStream(true);
+    const qint64 subRecvResponses = parseStream(parser, subRecv, 64);
+    bench.throughput("at_parser.subrecv", 200, subRecv.size(), subRecvResponses, [&]() {
+        return parseStream(parser, subRecv, 64);
+    });
+    bench.throughput("at_parser.mixed_1byte", 20, mixed.size(), mixedResponses, [&]() {
+        return parseStream(parser, mixed, 1);
+    });
+
+    /* 上传数据编码：v1每次一条(AT+MQTTPUB转义JSON)，v2每次一批20条 */
+    const OutboxRecord record = sampleRecord(0);
+    bench.throughput("encoder.v1_record", 100000, encodeRecord(record).toUtf8().size(), 1, [&]() {
+        return (qint64)encodeRecord(record).size();
+    });
+    QVector<OutboxRecord> batch;
+    for (int i = 0; i < 20; i++)
+        batch.append(sampleRecord(i));
+    bench.throughput("encoder.v2_batch20", 20000, encodeBatch(batch).size(), batch.size(), [&]() {
+        return (qint64)encodeBatch(batch).size();
+    });
+
+    /* MQ-135浓度换算：逐个pow()计算、批量快速换算、基线校准，以及读取ADC文件后换算 */
+    mq135 gas;
+    float vrl = 0.1f;
+    bench.throughput("mq135.ppm_from_voltage", 1000000, 0, 1, [&]() {
+        vrl = vrl < 4.9f ? vrl + 0.001f : 0.1f;
+        return (qint64)gas.ppmFromVoltage(vrl);
+    });
+    QVector<float> window(mq135::CalibrationWindow), converted(mq135::CalibrationWindow);
+    for (int i = 0; i < window.size(); i++)
+        window[i] = 2500 + (i * 37) % 1500;
+    bench.throughput("mq135.convertppm_window", 5000, 0, window.size(), [&]() {
+        gas.convertppm(window.constData(), converted.data(), window.size(), 0.050354003f);
+        return (qint64)converted[0];
+    });
+    bench.throughput("mq135.calibrate_window", 5000, 0, window.size(), [&]() {
+        return (qint64)gas.calibrateR0(window.constData(), window.size(), 0.050354003f);
+    });
+    bench.latency("mq135.calculateppm", 20000, [&]() {
+        return (qint64)gas.calculateppm();
+    });
+
+    /* LED/继电器写入：交替开关使每次都真正写入，以及状态不变时被缓存跳过 */
+    Led led;
+    bool ledOn = false;
+    bench.latency("led.write_toggle", 20000, [&]() {
+        ledOn = !ledOn;
+        led.setLedState(ledOn);
+        return (qint64)ledOn;
+    });
+    bench.latency("led.write_unchanged", 20000, [&]() {
+        led.setLedState(ledOn);
+        return (qint64)ledOn;
+    });
+    Relay relay;
+    bool relayOn = false;
+    bench.latency("relay.write_toggle", 20000, [&]() {
+        relayOn = !relayOn;
+        relay.setRelayState(relayOn);
+        return (qint64)relayOn;
+    });
+    bench.latency("relay.write_unchanged", 20000, [&]() {
+        relay.setRelayState(relayOn);
+        return (qint64)relayOn;
+    });
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file curtaindevice.cpp
+ * @brief 窗帘设备类的实现文件
+ */
+#include "curtaindevice.h"
+#include "../log/log.h"
+
+/**
+ * @brief CurtainDevice类构造函数
+ */
+CurtainDevice::CurtainDevice(const QString &id, const QJsonObject &config, QObject *parent)
+    : Device(id, config, parent)
+{
+    gear = new SteeringGear(this);
+    gear->setChannel(sysfsOption(config, "pwmchip", "/sys/class/pwm/pwmchip4"),
+                     config.value("channel").toInt(2));
+    if (config.contains("travelMs"))
+        gear->setTravelTime(config.value("travelMs").toInt());
+
+    connect(gear, &SteeringGear::motionFinished, this, [this](int percent) {
+        emit stateChanged(this->id(), percent);
+    });
+}
+
+/**
+ * @brief 执行控制命令
+ * @details 数值为目标位置，例如{"curtain":40}打开到40%
+ */
+bool CurtainDevice::command(const QJsonValue &value)
+{
+    if (value.isDouble()) {
+        gear->moveTo(qRound(value.toDouble()));
+        LOG_INFO() << name() << "移动到" << gear->targetPosition() << "%";
+        return true;
+    }
+
+    QString action = value.toString();
+    if (action == "open") {
+        gear->SGturnClockwise();    // 窗帘顺时针转动(打开)
+        LOG_INFO() << name() << "打开";
+    } else if (action == "close") {
+        gear->SGcounterclockwise(); // 窗帘逆时针转动(关闭)
+        LOG_INFO() << name() << "关闭";
+    } else if (action == "stop") {
+        gear->SGstop();             // 窗帘停止转动
+        LOG_INFO() << name() << "停止";
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 估计的位置
+ */
+QJsonValue CurtainDevice::state() const
+{
+    return gear->position();
+}
+
+/**
+ * @brief 舵机控制对象
+ */
+SteeringGear *CurtainDevice::steeringGear() const
+{
+    return gear;
+}
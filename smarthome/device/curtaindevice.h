@@ -0,0 +1,54 @@
+/**
+ * @file curtaindevice.h
+ * @brief 窗帘设备类的头文件
+ */
+#ifndef CURTAINDEVICE_H
+#define CURTAINDEVICE_H
+
+#include "device.h"
+#include "../steeringgear/steeringgear.h"
+
+/**
+ * @class CurtainDevice
+ * @brief 窗帘设备类
+ * @details 由舵机带动的窗帘。配置项：
+ *          - "pwmchip"：PWM控制器目录，默认/sys/class/pwm/pwmchip4
+ *          - "channel"：PWM通道号，默认2
+ *          - "travelMs"：全速走完全程的时间
+ *
+ *          状态为估计的位置(0~100)，每次运动结束时更新
+ */
+class CurtainDevice : public Device
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param id 设备标识
+     * @param config 设备配置
+     * @param parent 父对象指针
+     */
+    CurtainDevice(const QString &id, const QJsonObject &config, QObject *parent = nullptr);
+
+    /**
+     * @brief 执行控制命令
+     * @param value 目标位置(数值)，或"open"/"close"/"stop"
+     */
+    bool command(const QJsonValue &value) override;
+
+    /**
+     * @brief 估计的位置
+     */
+    QJsonValue state() const override;
+
+    /**
+     * @brief 舵机控制对象
+     */
+    SteeringGear *steeringGear() const;
+
+private:
+    SteeringGear *gear;     ///< 舵机控制对象
+};
+
+#endif // CURTAINDEVICE_H
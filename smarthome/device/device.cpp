@@ -0,0 +1,128 @@
+/**
+ * @file device.cpp
+ * @brief 设备公共接口的实现文件
+ */
+#include "device.h"
+#include "../sysfs/sysfspath.h"
+
+/**
+ * @brief Device类构造函数
+ * @param id 设备标识
+ * @param config 设备配置
+ * @param parent 父对象指针
+ */
+Device::Device(const QString &id, const QJsonObject &config, QObject *parent)
+    : QObject(parent),
+      deviceId(id),
+      deviceType(config.value("type").toString()),
+      deviceRoom(config.value("room").toString()),
+      deviceName(config.value("name").toString(id)),
+      remote(config.value("remote").toBool(true))
+{
+}
+
+/**
+ * @brief 设备标识
+ */
+QString Device::id() const
+{
+    return deviceId;
+}
+
+/**
+ * @brief 设备类型
+ */
+QString Device::type() const
+{
+    return deviceType;
+}
+
+/**
+ * @brief 所在房间
+ */
+QString Device::room() const
+{
+    return deviceRoom;
+}
+
+/**
+ * @brief 显示名称
+ */
+QString Device::name() const
+{
+    return deviceName;
+}
+
+/**
+ * @brief 是否接受云端控制命令
+ */
+bool Device::isRemote() const
+{
+    return remote;
+}
+
+/**
+ * @brief 执行控制命令
+ * @details 默认不可控制
+ */
+bool Device::command(const QJsonValue &value)
+{
+    Q_UNUSED(value)
+    return false;
+}
+
+/**
+ * @brief 读取配置中的sysfs路径
+ * @details 配置和默认值都没有时返回空，不映射到模拟根目录
+ */
+QString Device::sysfsOption(const QJsonObject &config, const char *key, const QString &defaultPath)
+{
+    QString path = config.value(QLatin1String(key)).toString(defaultPath);
+    return path.isEmpty() ? path : sysfsPath(path);
+}
+
+/**
+ * @brief SensorDevice类构造函数
+ */
+SensorDevice::SensorDevice(const QString &id, const QJsonObject &config, int periodMs, int timeoutMs,
+                           QObject *parent)
+    : Device(id, config, parent),
+      period(qMax(100, config.value("periodMs").toInt(periodMs))),
+      timeout(qMax(10, config.value("timeoutMs").toInt(timeoutMs)))
+{
+}
+
+/**
+ * @brief 采样周期
+ */
+int SensorDevice::periodMs() const
+{
+    return period;
+}
+
+/**
+ * @brief 读取超时时间
+ */
+int SensorDevice::timeoutMs() const
+{
+    return timeout;
+}
+
+/**
+ * @brief 用采样结果更新状态缓存
+ */
+void SensorDevice::update(const SensorSample &sample)
+{
+    bool changed = sample.valid != last.valid || (sample.valid && !sameData(sample, last));
+    last = sample;
+    if (changed)
+        emit stateChanged(id(), state());
+}
+
+/**
+ * @brief 最近一次采样结果
+ */
+const SensorSample &SensorDevice::lastSample() const
+{
+    return last;
+}
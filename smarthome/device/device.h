@@ -0,0 +1,169 @@
+/**
+ * @file device.h
+ * @brief 设备公共接口的头文件
+ * @details 执行器和传感器共用的设备接口，由DeviceRegistry按配置创建
+ */
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QJsonValue>
+#include "sensorsample.h"
+
+/**
+ * @class Device
+ * @brief 设备公共接口
+ * @details 每个设备有配置中给出的唯一标识(同时是云端控制命令JSON中的键)、类型、房间和显示名称。
+ *          执行器通过command()接收控制命令，state()返回缓存的设备状态，不访问硬件
+ */
+class Device : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param id 设备标识
+     * @param config 设备配置
+     * @param parent 父对象指针
+     */
+    Device(const QString &id, const QJsonObject &config, QObject *parent = nullptr);
+
+    /**
+     * @brief 设备标识，例如"livingroomlump"
+     */
+    QString id() const;
+
+    /**
+     * @brief 设备类型，例如"led"
+     */
+    QString type() const;
+
+    /**
+     * @brief 所在房间，配置中没有时为空
+     */
+    QString room() const;
+
+    /**
+     * @brief 显示名称，配置中没有时与标识相同
+     */
+    QString name() const;
+
+    /**
+     * @brief 是否接受云端控制命令
+     * @details 配置项"remote"，默认true；蜂鸣器等只由本地逻辑控制的设备设为false
+     */
+    bool isRemote() const;
+
+    /**
+     * @brief 执行控制命令
+     * @param value 控制命令JSON中该设备键对应的值
+     * @return 命令被识别并执行成功返回true；无法识别、写入失败或设备不可控制时返回false
+     */
+    virtual bool command(const QJsonValue &value);
+
+    /**
+     * @brief 缓存的设备状态
+     * @return 开关量为true/false，窗帘为位置，传感器为最近一次采样；状态未知时为null
+     */
+    virtual QJsonValue state() const = 0;
+
+signals:
+    /**
+     * @brief 设备状态变化
+     * @param id 设备标识
+     * @param state 新的状态
+     */
+    void stateChanged(const QString &id, const QJsonValue &state);
+
+protected:
+    /**
+     * @brief 读取配置中的sysfs路径，经sysfsPath()映射
+     * @param config 设备配置
+     * @param key 配置项
+     * @param defaultPath 配置中没有该项时使用的板上路径
+     */
+    static QString sysfsOption(const QJsonObject &config, const char *key, const QString &defaultPath);
+
+private:
+    QString deviceId;       ///< 设备标识
+    QString deviceType;     ///< 设备类型
+    QString deviceRoom;     ///< 所在房间
+    QString deviceName;     ///< 显示名称
+    bool remote;            ///< 是否接受云端控制命令
+};
+
+/**
+ * @class SensorDevice
+ * @brief 传感器设备公共接口
+ * @details read()在SensorSampler为该传感器创建的I/O线程中调用，只能访问ioObject()和不变的配置；
+ *          采样结果回到主线程后通过update()进入状态缓存
+ */
+class SensorDevice : public Device
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param id 设备标识
+     * @param config 设备配置，"periodMs"和"timeoutMs"覆盖默认的采样周期和读取超时时间
+     * @param periodMs 默认采样周期，单位ms
+     * @param timeoutMs 默认读取超时时间，单位ms
+     * @param parent 父对象指针
+     */
+    SensorDevice(const QString &id, const QJsonObject &config, int periodMs, int timeoutMs,
+                 QObject *parent = nullptr);
+
+    /**
+     * @brief 采样结果中的传感器类型
+     */
+    virtual SensorSample::Sensor sensor() const = 0;
+
+    /**
+     * @brief 采样周期，单位ms
+     */
+    int periodMs() const;
+
+    /**
+     * @brief 读取超时时间，单位ms
+     */
+    int timeoutMs() const;
+
+    /**
+     * @brief 在I/O线程中读取的底层传感器对象，交给SensorSampler移动到I/O线程并由其释放
+     */
+    virtual QObject *ioObject() const = 0;
+
+    /**
+     * @brief 读取一次传感器(在I/O线程中执行，可能阻塞)
+     * @param sample 填充数据字段和valid标志
+     */
+    virtual void read(SensorSample &sample) = 0;
+
+    /**
+     * @brief 用采样结果更新状态缓存(在主线程中调用)
+     * @param sample 采样结果
+     * @details 数据与缓存不同时发出stateChanged
+     */
+    void update(const SensorSample &sample);
+
+    /**
+     * @brief 最近一次采样结果
+     */
+    const SensorSample &lastSample() const;
+
+protected:
+    /**
+     * @brief 两次采样的数据是否相同
+     */
+    virtual bool sameData(const SensorSample &a, const SensorSample &b) const = 0;
+
+private:
+    int period;             ///< 采样周期
+    int timeout;            ///< 读取超时时间
+    SensorSample last;      ///< 最近一次采样结果
+};
+
+#endif // DEVICE_H
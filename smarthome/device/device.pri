@@ -0,0 +1,18 @@
+SOURCES += \
+    ../device/curtaindevice.cpp \
+    ../device/device.cpp \
+    ../device/deviceregistry.cpp \
+    ../device/deviceshadow.cpp \
+    ../device/dht11device.cpp \
+    ../device/mq135device.cpp \
+    ../device/switchdevice.cpp
+
+HEADERS += \
+    ../device/curtaindevice.h \
+    ../device/device.h \
+    ../device/deviceregistry.h \
+    ../device/deviceshadow.h \
+    ../device/dht11device.h \
+    ../device/mq135device.h \
+    ../device/sensorsample.h \
+    ../device/switchdevice.h
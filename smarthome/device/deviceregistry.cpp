@@ -0,0 +1,219 @@
+/**
+ * @file deviceregistry.cpp
+ * @brief 设备注册表类的实现文件
+ */
+#include "deviceregistry.h"
+#include "../log/log.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+/*
+ * 内置配置，与开发板的接线一致：客厅灯为板载LED，蜂鸣器只由气体浓度报警控制，
+ * 窗帘舵机接TIM1CH3(pwmchip4通道2)，MQ-135接ADC通道10
+ */
+static const char DefaultConfig[] = R"({
+    "devices": [
+        {"id": "livingroomlump", "type": "led", "room": "客厅", "name": "客厅灯",
+         "path": "/sys/devices/platform/leds/leds/sys-led/brightness",
+         "trigger": "/sys/class/leds/sys-led/trigger"},
+        {"id": "relay", "type": "relay", "name": "继电器",
+         "path": "/sys/class/leds/relay/brightness"},
+        {"id": "beep", "type": "beep", "name": "蜂鸣器", "remote": false,
+         "path": "/sys/devices/platform/leds/leds/beep/brightness"},
+        {"id": "curtain", "type": "curtain", "room": "客厅", "name": "窗帘",
+         "pwmchip": "/sys/class/pwm/pwmchip4", "channel": 2},
+        {"id": "dht11", "type": "dht11", "name": "温湿度",
+         "path": "/sys/class/misc/dht11/value", "periodMs": 5000, "timeoutMs": 3000},
+        {"id": "mq135", "type": "mq135", "name": "空气质量",
+         "device": "iio:device0", "channel": "voltage10", "periodMs": 1000, "timeoutMs": 500}
+    ]
+})";
+
+/**
+ * @brief 设备类型到工厂函数的表，第一次使用时注册内置类型
+ */
+static QHash<QString, DeviceRegistry::Factory> &factories()
+{
+    static QHash<QString, DeviceRegistry::Factory> table;
+    if (table.isEmpty()) {
+        DeviceRegistry::Factory switchFactory = [](const QString &id, const QJsonObject &config) -> Device * {
+            return new SwitchDevice(id, config);
+        };
+        table.insert("led", switchFactory);
+        table.insert("relay", switchFactory);
+        table.insert("beep", switchFactory);
+        table.insert("curtain", [](const QString &id, const QJsonObject &config) -> Device * {
+            return new CurtainDevice(id, config);
+        });
+        table.insert("dht11", [](const QString &id, const QJsonObject &config) -> Device * {
+            return new Dht11Device(id, config);
+        });
+        table.insert("mq135", [](const QString &id, const QJsonObject &config) -> Device * {
+            return new Mq135Device(id, config);
+        });
+    }
+    return table;
+}
+
+/**
+ * @brief DeviceRegistry类构造函数
+ * @param parent 父对象指针
+ */
+DeviceRegistry::DeviceRegistry(QObject *parent)
+    : QObject(parent)
+{
+}
+
+/**
+ * @brief DeviceRegistry类析构函数
+ */
+DeviceRegistry::~DeviceRegistry()
+{
+    clear();
+}
+
+/**
+ * @brief 默认配置文件路径
+ */
+QString DeviceRegistry::defaultConfigPath()
+{
+    QString path = QString::fromLocal8Bit(qgetenv("SMARTHOME_DEVICES"));
+    return path.isEmpty() ? QStringLiteral("/etc/smarthome/devices.json") : path;
+}
+
+/**
+ * @brief 注册设备类型
+ */
+void DeviceRegistry::registerType(const QString &type, Factory factory)
+{
+    factories().insert(type, factory);
+}
+
+/**
+ * @brief 加载配置文件并创建设备
+ */
+bool DeviceRegistry::load(const QString &path)
+{
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        QString error;
+        if (loadJson(file.readAll(), &error)) {
+            LOG_INFO() << "设备配置" << path << "加载了" << list.size() << "个设备";
+            return true;
+        }
+        LOG_WARN() << "设备配置" << path << "无效:" << error << "，使用内置配置";
+    }
+
+    loadJson(QByteArray(DefaultConfig));
+    return false;
+}
+
+/**
+ * @brief 按JSON配置创建设备
+ * @details 缺少id、id重复或类型未知的设备记录警告后跳过，其余设备照常创建
+ */
+bool DeviceRegistry::loadJson(const QByteArray &json, QString *error)
+{
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !document.object().value("devices").isArray()) {
+        if (error)
+            *error = parseError.error != QJsonParseError::NoError ? parseError.errorString()
+                                                                   : QStringLiteral("缺少devices数组");
+        return false;
+    }
+
+    clear();
+    const QJsonArray array = document.object().value("devices").toArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject config = value.toObject();
+        QString id = config.value("id").toString();
+        QString type = config.value("type").toString();
+        auto factory = factories().constFind(type);
+        if (id.isEmpty() || byId.contains(id) || factory == factories().constEnd()) {
+            LOG_WARN() << "跳过无效的设备配置:" << QJsonDocument(config).toJson(QJsonDocument::Compact);
+            continue;
+        }
+
+        Device *device = factory.value()(id, config);
+        device->setParent(this);
+        list.append(device);
+        byId.insert(id, device);
+    }
+    return true;
+}
+
+/**
+ * @brief 按标识查找设备
+ */
+Device *DeviceRegistry::device(const QString &id) const
+{
+    return byId.value(id);
+}
+
+/**
+ * @brief 按配置顺序返回所有设备
+ */
+QList<Device *> DeviceRegistry::devices() const
+{
+    return list;
+}
+
+/**
+ * @brief 指定类型的所有设备
+ */
+QList<Device *> DeviceRegistry::devicesOfType(const QString &type) const
+{
+    QList<Device *> result;
+    for (Device *device : list) {
+        if (device->type() == type)
+            result.append(device);
+    }
+    return result;
+}
+
+/**
+ * @brief 指定房间的所有设备
+ */
+QList<Device *> DeviceRegistry::devicesInRoom(const QString &room) const
+{
+    QList<Device *> result;
+    for (Device *device : list) {
+        if (device->room() == room)
+            result.append(device);
+    }
+    return result;
+}
+
+/**
+ * @brief 所有传感器设备
+ */
+QList<SensorDevice *> DeviceRegistry::sensors() const
+{
+    QList<SensorDevice *> result;
+    for (Device *device : list) {
+        if (SensorDevice *sensor = qobject_cast<SensorDevice *>(device))
+            result.append(sensor);
+    }
+    return result;
+}
+
+/**
+ * @brief 对一个设备执行控制命令
+ */
+bool DeviceRegistry::command(const QString &id, const QJsonValue &value)
+{
+    Device *device = byId.value(id);
+    return device && device->command(value);
+}
+
+/**
+ * @brief 释放所有设备
+ */
+void DeviceRegistry::clear()
+{
+    qDeleteAll(list);
+    list.clear();
+    byId.clear();
+}
@@ -0,0 +1,140 @@
+/**
+ * @file deviceregistry.h
+ * @brief 设备注册表类的头文件
+ * @details 按JSON配置创建所有执行器和传感器，增加房间和设备只需修改配置，不需要重新编译
+ */
+#ifndef DEVICEREGISTRY_H
+#define DEVICEREGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <functional>
+#include "device.h"
+#include "switchdevice.h"
+#include "curtaindevice.h"
+#include "dht11device.h"
+#include "mq135device.h"
+
+/**
+ * @class DeviceRegistry
+ * @brief 设备注册表类
+ * @details 配置文件格式：
+ * @code
+ * {
+ *     "devices": [
+ *         {"id": "livingroomlump", "type": "led", "room": "客厅", "name": "客厅灯",
+ *          "path": "/sys/devices/platform/leds/leds/sys-led/brightness"},
+ *         {"id": "relay", "type": "relay", "path": "/sys/class/leds/relay/brightness", "activeLow": false},
+ *         {"id": "curtain", "type": "curtain", "pwmchip": "/sys/class/pwm/pwmchip4", "channel": 2},
+ *         {"id": "dht11", "type": "dht11", "periodMs": 5000}
+ *     ]
+ * }
+ * @endcode
+ *          id同时是云端控制命令JSON中的键；各类型的配置项见对应设备类。
+ *          内置类型有led、relay、beep(开关量)、curtain、dht11、mq135，registerType()可以增加新类型。
+ *          配置文件不存在时使用与开发板出厂接线一致的内置配置
+ */
+class DeviceRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 设备工厂函数，返回的设备由注册表接管
+     */
+    typedef std::function<Device *(const QString &id, const QJsonObject &config)> Factory;
+
+    /**
+     * @brief 构造函数
+     * @param parent 父对象指针
+     */
+    DeviceRegistry(QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，释放所有设备
+     */
+    ~DeviceRegistry();
+
+    /**
+     * @brief 默认配置文件路径
+     * @return 环境变量SMARTHOME_DEVICES非空时为其值，否则为/etc/smarthome/devices.json
+     */
+    static QString defaultConfigPath();
+
+    /**
+     * @brief 注册设备类型
+     * @param type 配置中的"type"
+     * @param factory 工厂函数
+     */
+    static void registerType(const QString &type, Factory factory);
+
+    /**
+     * @brief 加载配置文件并创建设备
+     * @param path 配置文件路径
+     * @return 配置文件有效返回true；文件不存在或格式错误时使用内置配置并返回false
+     */
+    bool load(const QString &path);
+
+    /**
+     * @brief 按JSON配置创建设备，原有设备全部释放
+     * @param json 配置内容
+     * @param error 格式错误时输出错误描述，可以为空
+     * @return 格式正确返回true；单个设备配置错误时跳过该设备
+     */
+    bool loadJson(const QByteArray &json, QString *error = nullptr);
+
+    /**
+     * @brief 按标识查找设备
+     * @return 没有该设备时返回nullptr
+     */
+    Device *device(const QString &id) const;
+
+    /**
+     * @brief 按标识查找指定类的设备
+     * @return 没有该设备或类不符时返回nullptr
+     */
+    template <class T>
+    T *device(const QString &id) const
+    {
+        return qobject_cast<T *>(device(id));
+    }
+
+    /**
+     * @brief 按配置顺序返回所有设备
+     */
+    QList<Device *> devices() const;
+
+    /**
+     * @brief 指定类型的所有设备
+     * @param type 设备类型，例如"beep"
+     */
+    QList<Device *> devicesOfType(const QString &type) const;
+
+    /**
+     * @brief 指定房间的所有设备
+     * @param room 房间名
+     */
+    QList<Device *> devicesInRoom(const QString &room) const;
+
+    /**
+     * @brief 所有传感器设备
+     */
+    QList<SensorDevice *> sensors() const;
+
+    /**
+     * @brief 对一个设备执行控制命令
+     * @param id 设备标识
+     * @param value 命令值
+     * @return 设备存在且命令被识别返回true
+     */
+    bool command(const QString &id, const QJsonValue &value);
+
+private:
+    void clear();                           ///< 释放所有设备
+
+    QList<Device *> list;                   ///< 按配置顺序排列的设备
+    QHash<QString, Device *> byId;          ///< 标识到设备的索引
+};
+
+#endif // DEVICEREGISTRY_H
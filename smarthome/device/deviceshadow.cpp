@@ -0,0 +1,136 @@
+/**
+ * @file deviceshadow.cpp
+ * @brief 设备影子类的实现文件
+ */
+#include "deviceshadow.h"
+#include <QDateTime>
+#include <QJsonDocument>
+
+/**
+ * @brief DeviceShadow类构造函数
+ * @details 记录执行器的初始状态(尚未写入过的为null)并开始监听状态变化
+ */
+DeviceShadow::DeviceShadow(DeviceRegistry *devices, QObject *parent)
+    : QObject(parent), ver(0), epoch(QDateTime::currentMSecsSinceEpoch())
+{
+    coalesce.setSingleShot(true);
+    connect(&coalesce, &QTimer::timeout, this, &DeviceShadow::deltaReady);
+
+    for (Device *device : devices->devices()) {
+        if (qobject_cast<SensorDevice *>(device))
+            continue;
+        current.insert(device->id(), device->state());
+        connect(device, &Device::stateChanged, this, &DeviceShadow::deviceChanged);
+    }
+}
+
+/**
+ * @brief 当前版本号
+ */
+quint32 DeviceShadow::version() const
+{
+    return ver;
+}
+
+/**
+ * @brief 所有执行器的当前状态
+ */
+QJsonObject DeviceShadow::state() const
+{
+    return current;
+}
+
+/**
+ * @brief 是否有尚未取出的增量
+ */
+bool DeviceShadow::hasDelta() const
+{
+    return !pending.isEmpty() || !acks.isEmpty();
+}
+
+/**
+ * @brief 取出增量
+ */
+QByteArray DeviceShadow::takeDelta()
+{
+    if (!hasDelta())
+        return QByteArray();
+
+    ver++;
+    QByteArray message = encode(pending, false);
+    pending = QJsonObject();
+    taken = acks;
+    acks = QJsonArray();
+    return message;
+}
+
+/**
+ * @brief 生成全量快照
+ */
+QByteArray DeviceShadow::snapshot()
+{
+    ver++;
+    QByteArray message = encode(current, true);
+    pending = QJsonObject();
+    taken = acks;
+    acks = QJsonArray();
+    return message;
+}
+
+/**
+ * @brief 把最近一次取出的命令确认放回
+ */
+void DeviceShadow::requeueAcks()
+{
+    for (const QJsonValue &ack : acks)
+        taken.append(ack);
+    acks = taken;
+    taken = QJsonArray();
+}
+
+/**
+ * @brief 确认一条控制命令已执行
+ */
+void DeviceShadow::acknowledge(const QJsonValue &id, const QJsonValue &ts, bool ok)
+{
+    QJsonObject ack;
+    ack.insert("id", id);
+    if (!ts.isUndefined())
+        ack.insert("ts", ts);
+    ack.insert("ok", ok);
+    acks.append(ack);
+
+    coalesce.stop();
+    emit deltaReady();
+}
+
+/**
+ * @brief 设备状态变化处理
+ * @details 值未变化时忽略；同一设备在合并窗口内多次变化只保留最后的值
+ */
+void DeviceShadow::deviceChanged(const QString &id, const QJsonValue &value)
+{
+    if (current.value(id) == value)
+        return;
+
+    current.insert(id, value);
+    pending.insert(id, value);
+    if (!coalesce.isActive())
+        coalesce.start(CoalesceMs);
+}
+
+/**
+ * @brief 编码消息
+ */
+QByteArray DeviceShadow::encode(const QJsonObject &fields, bool full) const
+{
+    QJsonObject message;
+    message.insert("shadow", (qint64)ver);
+    message.insert("epoch", epoch);
+    if (full)
+        message.insert("full", true);
+    message.insert("state", fields);
+    if (!acks.isEmpty())
+        message.insert("acks", acks);
+    return QJsonDocument(message).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,114 @@
+/**
+ * @file deviceshadow.h
+ * @brief 设备影子类的头文件
+ * @details 板上维护的执行器状态副本，带版本号，只把变化的字段同步给面板和云端
+ */
+#ifndef DEVICESHADOW_H
+#define DEVICESHADOW_H
+
+#include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTimer>
+#include "deviceregistry.h"
+
+/**
+ * @class DeviceShadow
+ * @brief 设备影子类
+ * @details 监听注册表中所有执行器的stateChanged，状态变化在CoalesceMs内合并为一个增量：
+ * @code
+ * {"shadow":12,"epoch":1737095727187,"state":{"livingroomlump":true,"curtain":40}}
+ * @endcode
+ *          shadow为版本号，每个增量加1；epoch为本次启动的时间，程序重启后版本号从头开始，
+ *          接收方发现epoch变化时丢弃旧版本号。全量快照多一个"full":true，包含所有执行器的状态，
+ *          在连接建立后和接收方发现版本号不连续时发送。
+ *          带id的控制命令执行后，确认随下一个增量发布：
+ * @code
+ * {"shadow":13,"epoch":1737095727187,"state":{"relay":true},"acks":[{"id":7,"ts":1737095730012,"ok":true}]}
+ * @endcode
+ *          ts原样返回命令中的时间戳，发送方据此计算从点击到执行完成的延迟
+ */
+class DeviceShadow : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum {
+        CoalesceMs = 50     ///< 增量合并窗口，一条控制命令同时改变多个设备时只产生一个增量
+    };
+
+    /**
+     * @brief 构造函数
+     * @param devices 设备注册表，只跟踪执行器，传感器数据通过上传数据同步
+     * @param parent 父对象指针
+     */
+    DeviceShadow(DeviceRegistry *devices, QObject *parent = nullptr);
+
+    /**
+     * @brief 当前版本号
+     */
+    quint32 version() const;
+
+    /**
+     * @brief 所有执行器的当前状态
+     */
+    QJsonObject state() const;
+
+    /**
+     * @brief 是否有尚未取出的增量
+     */
+    bool hasDelta() const;
+
+    /**
+     * @brief 取出增量，版本号加1
+     * @return 增量消息，没有变化时为空
+     */
+    QByteArray takeDelta();
+
+    /**
+     * @brief 生成全量快照，尚未取出的增量并入快照，版本号加1
+     * @return 全量快照消息
+     */
+    QByteArray snapshot();
+
+    /**
+     * @brief 确认一条控制命令已执行，立即结束合并窗口
+     * @param id 命令中的id
+     * @param ts 命令中的时间戳，原样返回
+     * @param ok 命令中的所有设备是否都执行成功
+     * @details 命令引起的状态变化已在执行时记录，确认和这些变化在同一个增量中发布
+     */
+    void acknowledge(const QJsonValue &id, const QJsonValue &ts, bool ok);
+
+    /**
+     * @brief 把最近一次取出的命令确认放回，随下一条增量或快照再发布一次
+     * @details 增量只发布到了局域网、云端要等到下一条消息时调用，
+     *          只能经云端到达的面板也能收到确认；重复的确认由面板忽略
+     */
+    void requeueAcks();
+
+signals:
+    /**
+     * @brief 合并窗口结束，有增量可以发布
+     */
+    void deltaReady();
+
+private slots:
+    /**
+     * @brief 设备状态变化处理
+     */
+    void deviceChanged(const QString &id, const QJsonValue &value);
+
+private:
+    QByteArray encode(const QJsonObject &fields, bool full) const;  ///< 编码消息
+
+    QJsonObject current;    ///< 所有执行器的当前状态
+    QJsonObject pending;    ///< 尚未取出的变化字段
+    QJsonArray acks;        ///< 尚未发布的命令确认
+    QJsonArray taken;       ///< 最近一次取出的命令确认
+    quint32 ver;            ///< 版本号
+    qint64 epoch;           ///< 本次启动的时间
+    QTimer coalesce;        ///< 增量合并定时器
+};
+
+#endif // DEVICESHADOW_H
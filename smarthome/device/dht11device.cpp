@@ -0,0 +1,71 @@
+/**
+ * @file dht11device.cpp
+ * @brief DHT11温湿度传感器设备类的实现文件
+ */
+#include "dht11device.h"
+
+/**
+ * @brief Dht11Device类构造函数
+ * @details 读取对象没有父对象，由SensorSampler移动到I/O线程并释放
+ */
+Dht11Device::Dht11Device(const QString &id, const QJsonObject &config, QObject *parent)
+    : SensorDevice(id, config, 5000, 3000, parent),
+      maxAgeMs(config.value("maxAgeMs").toInt(15000))
+{
+    driver = new dht11();
+    driver->setPath(sysfsOption(config, "path", "/sys/class/misc/dht11/value"));
+}
+
+/**
+ * @brief 采样结果中的传感器类型
+ */
+SensorSample::Sensor Dht11Device::sensor() const
+{
+    return SensorSample::Dht11;
+}
+
+/**
+ * @brief 在I/O线程中读取的对象
+ */
+QObject *Dht11Device::ioObject() const
+{
+    return driver;
+}
+
+/**
+ * @brief 读取一次温湿度
+ * @details 新数据不足时使用不超过maxAgeMs的缓存数据，缓存数据使用其真实的读取时间
+ */
+void Dht11Device::read(SensorSample &sample)
+{
+    Dht11Reading reading = driver->read(maxAgeMs);
+    sample.valid = reading.valid;
+    sample.cached = reading.cached;
+    sample.humidity = reading.humidity;
+    sample.temperature = reading.temperature;
+    if (reading.valid)
+        sample.timestamp = reading.timestamp;
+}
+
+/**
+ * @brief 最近一次采样的温湿度
+ */
+QJsonValue Dht11Device::state() const
+{
+    const SensorSample &sample = lastSample();
+    if (!sample.valid)
+        return QJsonValue();
+
+    QJsonObject object;
+    object.insert("temperature", sample.temperature);
+    object.insert("humidity", sample.humidity);
+    return object;
+}
+
+/**
+ * @brief 两次采样的温湿度是否相同
+ */
+bool Dht11Device::sameData(const SensorSample &a, const SensorSample &b) const
+{
+    return a.temperature == b.temperature && a.humidity == b.humidity;
+}
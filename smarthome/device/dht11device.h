@@ -0,0 +1,50 @@
+/**
+ * @file dht11device.h
+ * @brief DHT11温湿度传感器设备类的头文件
+ */
+#ifndef DHT11DEVICE_H
+#define DHT11DEVICE_H
+
+#include "device.h"
+#include "../dht11/dht11.h"
+
+/**
+ * @class Dht11Device
+ * @brief DHT11温湿度传感器设备类
+ * @details 配置项：
+ *          - "path"：驱动的设备文件，默认/sys/class/misc/dht11/value
+ *          - "periodMs"/"timeoutMs"：默认5000/3000。温湿度变化慢且DHT11两次读取至少间隔1~2秒；
+ *            驱动读取一次需要几十毫秒，重试时更长，超过超时时间视为驱动挂死
+ *          - "maxAgeMs"：本次读取失败时允许代替的缓存数据的最大年龄，默认15000(约3个采样周期)
+ */
+class Dht11Device : public SensorDevice
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param id 设备标识
+     * @param config 设备配置
+     * @param parent 父对象指针
+     */
+    Dht11Device(const QString &id, const QJsonObject &config, QObject *parent = nullptr);
+
+    SensorSample::Sensor sensor() const override;
+    QObject *ioObject() const override;
+    void read(SensorSample &sample) override;
+
+    /**
+     * @brief 最近一次采样的温湿度，如{"temperature":25,"humidity":50}，无效时为null
+     */
+    QJsonValue state() const override;
+
+protected:
+    bool sameData(const SensorSample &a, const SensorSample &b) const override;
+
+private:
+    dht11 *driver;          ///< DHT11读取对象，运行在I/O线程中
+    qint64 maxAgeMs;        ///< 允许使用的缓存数据的最大年龄
+};
+
+#endif // DHT11DEVICE_H
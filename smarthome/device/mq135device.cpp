@@ -0,0 +1,72 @@
+/**
+ * @file mq135device.cpp
+ * @brief MQ-135气体传感器设备类的实现文件
+ */
+#include "mq135device.h"
+
+/**
+ * @brief Mq135Device类构造函数
+ * @details 读取对象没有父对象，由SensorSampler移动到I/O线程并释放
+ */
+Mq135Device::Mq135Device(const QString &id, const QJsonObject &config, QObject *parent)
+    : SensorDevice(id, config, 1000, 500, parent),
+      calibration(config.value("calibration").toString(id + ".json"))
+{
+    driver = new mq135(config.value("device").toString("iio:device0"),
+                       config.value("channel").toString("voltage10"));
+}
+
+/**
+ * @brief 采样结果中的传感器类型
+ */
+SensorSample::Sensor Mq135Device::sensor() const
+{
+    return SensorSample::Mq135;
+}
+
+/**
+ * @brief 在I/O线程中读取的对象
+ */
+QObject *Mq135Device::ioObject() const
+{
+    return driver;
+}
+
+/**
+ * @brief 读取一次气体浓度(已滤波)和未滤波的峰值
+ * @details ADC读取失败或没有新采样(如在PC上运行)时采样无效，
+ *          旧的滤波值不作为当前浓度写入存储、上传或交给规则
+ */
+void Mq135Device::read(SensorSample &sample)
+{
+    bool fresh = false;
+    sample.ppm = driver->calculateppm(&sample.ppmPeak, &fresh);
+    sample.valid = fresh;
+}
+
+/**
+ * @brief 最近一次采样的气体浓度
+ */
+QJsonValue Mq135Device::state() const
+{
+    const SensorSample &sample = lastSample();
+    if (!sample.valid)
+        return QJsonValue();
+    return sample.ppm;
+}
+
+/**
+ * @brief 加载校准文件
+ */
+bool Mq135Device::loadCalibration(const QString &directory)
+{
+    return driver->loadCalibration(directory + "/" + calibration);
+}
+
+/**
+ * @brief 两次采样的浓度是否相同
+ */
+bool Mq135Device::sameData(const SensorSample &a, const SensorSample &b) const
+{
+    return a.ppm == b.ppm;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file mq135device.h
+ * @brief MQ-135气体传感器设备类的头文件
+ */
+#ifndef MQ135DEVICE_H
+#define MQ135DEVICE_H
+
+#include "device.h"
+#include "../MQ-135/mq135.h"
+
+/**
+ * @class Mq135Device
+ * @brief MQ-135气体传感器设备类
+ * @details 配置项：
+ *          - "device"/"channel"：ADC所在的IIO设备和通道，默认"iio:device0"/"voltage10"
+ *          - "periodMs"/"timeoutMs"：默认1000/500，每秒采样一次保证报警及时
+ *          - "calibration"：数据目录下的校准文件名，默认"<id>.json"
+ */
+class Mq135Device : public SensorDevice
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param id 设备标识
+     * @param config 设备配置
+     * @param parent 父对象指针
+     */
+    Mq135Device(const QString &id, const QJsonObject &config, QObject *parent = nullptr);
+
+    SensorSample::Sensor sensor() const override;
+    QObject *ioObject() const override;
+    void read(SensorSample &sample) override;
+
+    /**
+     * @brief 最近一次采样的气体浓度，单位ppm，无效时为null
+     */
+    QJsonValue state() const override;
+
+    /**
+     * @brief 加载校准文件，必须在读取对象移动到I/O线程之前调用
+     * @param directory 数据目录
+     */
+    bool loadCalibration(const QString &directory);
+
+protected:
+    bool sameData(const SensorSample &a, const SensorSample &b) const override;
+
+private:
+    mq135 *driver;          ///< MQ-135读取对象，运行在I/O线程中
+    QString calibration;    ///< 校准文件名
+};
+
+#endif // MQ135DEVICE_H
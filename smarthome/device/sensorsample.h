@@ -0,0 +1,39 @@
+/**
+ * @file sensorsample.h
+ * @brief 传感器采样结果的头文件
+ * @details 设备、规则和采样调度共用的采样结果类型
+ */
+#ifndef SENSORSAMPLE_H
+#define SENSORSAMPLE_H
+
+#include <QMetaType>
+#include <QString>
+
+/**
+ * @struct SensorSample
+ * @brief 一次传感器采样结果
+ */
+struct SensorSample
+{
+    /**
+     * @brief 传感器类型
+     */
+    enum Sensor {
+        Dht11,      ///< DHT11温湿度传感器
+        Mq135       ///< MQ-135气体传感器
+    };
+
+    int sensor = Dht11;         ///< 传感器类型
+    QString device;             ///< 设备标识，对应设备配置中的id
+    qint64 timestamp = 0;       ///< 采样时间，自1970-01-01起的毫秒数
+    qint64 elapsedMs = 0;       ///< 读取耗时，单位ms
+    bool valid = false;         ///< 采样是否有效
+    bool cached = false;        ///< 数据是否是传感器缓存的上一次有效读取，而不是本次新读到的
+    int humidity = 0;           ///< 湿度，单位%RH(DHT11)
+    int temperature = 0;        ///< 温度，单位℃(DHT11)
+    float ppm = 0;              ///< 滤波后的气体浓度，单位ppm(MQ-135)
+    float ppmPeak = 0;          ///< 本次读取的采样中未经滤波的最大浓度，单位ppm(MQ-135)
+};
+Q_DECLARE_METATYPE(SensorSample)
+
+#endif // SENSORSAMPLE_H
@@ -0,0 +1,89 @@
+/**
+ * @file switchdevice.cpp
+ * @brief 开关量设备类的实现文件
+ */
+#include "switchdevice.h"
+#include "../log/log.h"
+#include <QFile>
+
+/**
+ * @brief SwitchDevice类构造函数
+ * @details 配置了trigger时写入"none"，板外没有该文件时忽略；创建时打开属性文件并读回当前状态，
+ *          开机后设备影子和规则不必等第一次写入就能拿到灯、继电器、蜂鸣器的状态
+ */
+SwitchDevice::SwitchDevice(const QString &id, const QJsonObject &config, QObject *parent)
+    : Device(id, config, parent),
+      activeLow(config.value("activeLow").toBool(false))
+{
+    if (config.contains("trigger")) {
+        QFile trigger(sysfsOption(config, "trigger", QString()));
+        if (trigger.open(QIODevice::WriteOnly))
+            trigger.write("none");
+    }
+    output.setPath(sysfsOption(config, "path", QString()));
+    output.open();
+
+    QByteArray prefix = type().toLatin1();
+    latency = Metrics::histogram((prefix + ".write_us").constData());
+    errors = Metrics::counter((prefix + ".write_errors").constData());
+}
+
+/**
+ * @brief 执行控制命令
+ */
+bool SwitchDevice::command(const QJsonValue &value)
+{
+    if (value.isBool())
+        return setOn(value.toBool());
+
+    QString action = value.toString();
+    if (action == "open")
+        return setOn(true);
+    else if (action == "close")
+        return setOn(false);
+    return false;
+}
+
+/**
+ * @brief 缓存的开关状态
+ */
+QJsonValue SwitchDevice::state() const
+{
+    int on = isOn();
+    return on < 0 ? QJsonValue() : QJsonValue(on == 1);
+}
+
+/**
+ * @brief 打开或关闭设备
+ * @details 状态未改变时直接返回；写入耗时和失败次数记录到运行指标
+ */
+bool SwitchDevice::setOn(bool on)
+{
+    if (isOn() == (on ? 1 : 0))
+        return true;
+
+    bool ok;
+    {
+        MetricTimer timer(latency);
+        ok = output.setState(on != activeLow);
+    }
+    if (!ok) {
+        errors->add();
+        return false;
+    }
+
+    LOG_INFO() << name() << (on ? "打开" : "关闭");
+    emit stateChanged(id(), on);
+    return true;
+}
+
+/**
+ * @brief 缓存的开关状态
+ */
+int SwitchDevice::isOn() const
+{
+    int value = output.state();
+    if (value < 0)
+        return -1;
+    return (value != 0) != activeLow ? 1 : 0;
+}
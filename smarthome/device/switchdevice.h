@@ -0,0 +1,68 @@
+/**
+ * @file switchdevice.h
+ * @brief 开关量设备类的头文件
+ * @details LED、继电器、蜂鸣器等通过一个sysfs属性文件写0/1控制的设备
+ */
+#ifndef SWITCHDEVICE_H
+#define SWITCHDEVICE_H
+
+#include "device.h"
+#include "../sysfs/sysfsoutput.h"
+#include "../metrics/metrics.h"
+
+/**
+ * @class SwitchDevice
+ * @brief 开关量设备类
+ * @details 配置项：
+ *          - "path"：brightness等属性文件，必填
+ *          - "activeLow"：低电平有效时为true，打开时写0
+ *          - "trigger"：LED的trigger文件，创建时写入"none"关闭出厂的心跳闪烁
+ *
+ *          状态缓存即SysfsOutput缓存的输出值(创建时从属性文件读回)，状态未变化时不写入也不记录日志；
+ *          同类设备共用"<类型>.write_us"和"<类型>.write_errors"指标
+ */
+class SwitchDevice : public Device
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param id 设备标识
+     * @param config 设备配置
+     * @param parent 父对象指针
+     */
+    SwitchDevice(const QString &id, const QJsonObject &config, QObject *parent = nullptr);
+
+    /**
+     * @brief 执行控制命令
+     * @param value "open"/"close"或true/false
+     */
+    bool command(const QJsonValue &value) override;
+
+    /**
+     * @brief 缓存的开关状态，属性文件不可读且尚未写入过时为null
+     */
+    QJsonValue state() const override;
+
+    /**
+     * @brief 打开或关闭设备
+     * @param on true打开，false关闭
+     * @return 写入成功或状态未变化返回true
+     */
+    bool setOn(bool on);
+
+    /**
+     * @brief 缓存的开关状态
+     * @return 1表示打开，0表示关闭，-1表示未知
+     */
+    int isOn() const;
+
+private:
+    SysfsOutput output;         ///< 常驻打开的属性文件
+    bool activeLow;             ///< 是否低电平有效
+    MetricHistogram *latency;   ///< 写入耗时
+    MetricCounter *errors;      ///< 写入失败次数
+};
+
+#endif // SWITCHDEVICE_H
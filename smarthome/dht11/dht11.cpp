@@ -3,18 +3,24 @@
  * @brief DHT11温湿度传感器驱动类的实现文件
  */
 #include "dht11.h"
-#include <QDebug>
+#include "../metrics/metrics.h"
+#include "../sysfs/sysfspath.h"
+#include "../log/log.h"
+#include <QDateTime>
+#include <QThread>
 
 /**
  * @brief dht11类构造函数
  * @param parent 父对象指针
- * @details 初始化DHT11设备文件路径
+ * @details 初始化DHT11设备文件路径，设备文件在第一次读取时打开
  */
 dht11::dht11(QObject *parent)
+    : retrytokens(RetryBudget)
 {
     this->setParent(parent);
     // 设置DHT11传感器的设备文件路径
-    file.setFileName("/sys/class/misc/dht11/value");
+    input.setPath(sysfsPath("/sys/class/misc/dht11/value"));
+    refilltimer.start();
 }
 
 /**
@@ -25,26 +31,158 @@ dht11::~dht11()
 }
 
 /**
- * @brief 读取DHT11传感器的温湿度值
- * @return 返回温湿度值的字符串，格式为"湿度温度"，例如"3525"表示湿度35%，温度25℃
- * @details 通过读取Linux系统文件接口获取DHT11传感器数据
+ * @brief 读取温湿度
+ * @details 距离上一次访问驱动不足MinIntervalMs时直接使用缓存；
+ *          读取失败且还有重试机会时，等满最小间隔后重试一次；
+ *          仍然没有新数据时，缓存的有效数据不超过maxAgeMs则返回缓存
  */
-QString dht11::readDHT11value()
+Dht11Reading dht11::read(qint64 maxAgeMs)
 {
-    QString dht11_value = NULL;
-    
-    // 检查设备文件是否存在
-    if (!file.exists())
-        return dht11_value;
+    static MetricCounter *retries = Metrics::counter("dht11.retries");
+    static MetricCounter *cachedreads = Metrics::counter("dht11.cached");
 
-    // 打开并读取设备文件内容
-    if(file.open(QIODevice::ReadOnly)) {
-        dht11_value = QString(file.readAll());
+    Dht11Reading reading;
+    if (!lastattempt.isValid() || lastattempt.hasExpired(MinIntervalMs)) {
+        reading = readOnce();
+        if (!reading.valid && takeRetryToken()) {
+            retries->add();
+            qint64 wait = MinIntervalMs - lastattempt.elapsed();
+            if (wait > 0)
+                QThread::msleep((unsigned long)wait);
+            reading = readOnce();
+        }
+        if (reading.valid)
+            return reading;
     } else {
-        qDebug()<<"error open file:"<<file.errorString();
+        /* 间隔不够，不访问驱动 */
+        reading.status = Dht11Reading::Skipped;
     }
-    
-    // 关闭文件
-    file.close();
-    return dht11_value;
+
+    if (lastgood.valid && lastgoodtimer.elapsed() <= maxAgeMs) {
+        Dht11Reading::Status status = reading.status;
+        reading = lastGood();
+        reading.status = status;
+        reading.cached = true;
+        cachedreads->add();
+    }
+    return reading;
+}
+
+/**
+ * @brief 设置设备文件路径
+ * @param path 设备文件路径
+ */
+void dht11::setPath(const QString &path)
+{
+    input.setPath(path);
+}
+
+/**
+ * @brief 上一次有效读取
+ */
+Dht11Reading dht11::lastGood() const
+{
+    Dht11Reading reading = lastgood;
+    if (reading.valid)
+        reading.ageMs = lastgoodtimer.elapsed();
+    return reading;
+}
+
+/**
+ * @brief 访问一次驱动并校验数据
+ * @details 读取耗时、读取失败次数和校验失败次数记录到运行指标
+ */
+Dht11Reading dht11::readOnce()
+{
+    static MetricHistogram *latency = Metrics::histogram("dht11.read_us");
+    static MetricCounter *errors = Metrics::counter("dht11.read_errors");
+    static MetricCounter *invalid = Metrics::counter("dht11.invalid");
+
+    Dht11Reading reading;
+    char data[16];
+    int length;
+    {
+        MetricTimer timer(latency);
+        length = input.read(data, sizeof(data));
+    }
+    lastattempt.start();
+
+    if (length < 0) {
+        errors->add();
+        reading.status = Dht11Reading::NoDevice;
+        return reading;
+    }
+
+    parse(data, length, reading);
+    if (!reading.valid) {
+        invalid->add();
+        LOG_LIMITED(LogWarn, 60000) << "DHT11数据无效，状态" << reading.status;
+        return reading;
+    }
+
+    reading.timestamp = QDateTime::currentMSecsSinceEpoch();
+    lastgood = reading;
+    lastgoodtimer.start();
+    return reading;
+}
+
+/**
+ * @brief 取一个重试机会
+ * @details 每隔RetryRefillMs补充一次，最多RetryBudget次
+ */
+bool dht11::takeRetryToken()
+{
+    int refill = (int)(refilltimer.elapsed() / RetryRefillMs);
+    if (refill > 0) {
+        retrytokens = qMin((int)RetryBudget, retrytokens + refill);
+        refilltimer.start();
+    }
+    if (retrytokens == 0)
+        return false;
+    retrytokens--;
+    return true;
+}
+
+/**
+ * @brief 校验并解析驱动输出的数据
+ * @details 前4个字节都是数字、其后只有换行或'\0'时按"HHTT"解析；
+ *          否则按5字节原始帧解析并检查校验和(前4个字节之和的低8位)。
+ *          全0帧的校验和也正确，由量程检查排除
+ */
+void dht11::parse(const char *data, int length, Dht11Reading &reading)
+{
+    reading.valid = false;
+    const unsigned char *p = (const unsigned char *)data;
+
+    bool text = length >= 4;
+    for (int i = 0; text && i < length; i++) {
+        if (i < 4)
+            text = p[i] >= '0' && p[i] <= '9';
+        else
+            text = p[i] == '\n' || p[i] == '\0';
+    }
+
+    if (text) {
+        reading.humidity = (p[0] - '0') * 10 + (p[1] - '0');
+        reading.temperature = (p[2] - '0') * 10 + (p[3] - '0');
+    } else if (length == 5) {
+        if (((p[0] + p[1] + p[2] + p[3]) & 0xff) != p[4]) {
+            reading.status = Dht11Reading::ChecksumError;
+            return;
+        }
+        reading.humidity = p[0];
+        reading.temperature = p[2];
+    } else {
+        reading.status = Dht11Reading::Malformed;
+        return;
+    }
+
+    if (reading.humidity < MinHumidity || reading.humidity > MaxHumidity ||
+        reading.temperature < MinTemperature || reading.temperature > MaxTemperature) {
+        reading.status = Dht11Reading::OutOfRange;
+        return;
+    }
+
+    reading.status = Dht11Reading::Ok;
+    reading.valid = true;
 }
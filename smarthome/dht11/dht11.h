@@ -7,19 +7,70 @@
 #define DHT11_H
 
 #include <QObject>
-#include <QFile>
+#include <QElapsedTimer>
+#include "../sysfs/sysfsinput.h"
+
+/**
+ * @struct Dht11Reading
+ * @brief 一次DHT11读取结果
+ */
+struct Dht11Reading
+{
+    /**
+     * @brief 读取状态
+     */
+    enum Status {
+        Ok,             ///< 读取成功且数据有效
+        NoDevice,       ///< 设备文件不可用
+        Malformed,      ///< 数据长度或格式不对
+        ChecksumError,  ///< 原始帧校验和错误
+        OutOfRange,     ///< 数值超出传感器量程
+        Skipped         ///< 距离上一次读取不足最小间隔，没有访问驱动
+    };
+
+    Status status = NoDevice;   ///< 本次读取的状态(cached为true时是本次失败或跳过的原因)
+    bool valid = false;         ///< humidity和temperature是否可用
+    bool cached = false;        ///< 数据是否来自缓存的上一次有效读取
+    int humidity = 0;           ///< 湿度，单位%RH
+    int temperature = 0;        ///< 温度，单位℃
+    qint64 timestamp = 0;       ///< 数据的读取时间，自1970-01-01起的毫秒数
+    qint64 ageMs = 0;           ///< 数据的年龄(cached时大于0)，单位ms
+};
 
 /**
  * @class dht11
  * @brief DHT11温湿度传感器驱动类
- * @details 负责与DHT11温湿度传感器通信，获取传感器的温湿度数据
+ * @details 负责与DHT11温湿度传感器通信，获取传感器的温湿度数据。
+ *          设备文件常驻打开，每次读取一次pread，直接按字节解析：
+ *          驱动输出"HHTT"4位数字(湿度、温度)，或5字节原始帧(湿度整数、湿度小数、温度整数、温度小数、校验和)。
+ *          两次读取至少间隔MinIntervalMs，间隔不够时不访问驱动，返回缓存的上一次有效数据；
+ *          读取失败时最多重试一次，重试次数受令牌桶限制，传感器拔出时不会持续占用驱动
  */
 class dht11 : public QObject
 {
     Q_OBJECT
 
+public:
+    enum {
+        MinIntervalMs = 1500,       ///< 两次读取之间的最小间隔，DHT11要求1~2秒
+        RetryBudget = 3,            ///< 令牌桶容量，即连续失败时最多连续重试的次数
+        RetryRefillMs = 20000,      ///< 令牌桶每隔多久补充一次重试机会
+        MinHumidity = 5,            ///< 有效湿度下限，驱动读取失败时常返回0
+        MaxHumidity = 99,           ///< 有效湿度上限
+        MinTemperature = 0,         ///< 有效温度下限(DHT11量程0~50℃)
+        MaxTemperature = 60         ///< 有效温度上限
+    };
+
 private:
-    QFile file;    ///< 文件对象，用于访问DHT11设备文件
+    SysfsInput input;           ///< DHT11设备文件，常驻描述符
+    QElapsedTimer lastattempt;  ///< 距离上一次访问驱动的时间
+    QElapsedTimer lastgoodtimer;///< 距离上一次有效读取的时间
+    Dht11Reading lastgood;      ///< 上一次有效读取
+    int retrytokens;            ///< 剩余的重试机会
+    QElapsedTimer refilltimer;  ///< 重试机会补充计时
+
+    Dht11Reading readOnce();    ///< 访问一次驱动并校验数据
+    bool takeRetryToken();      ///< 取一个重试机会，没有时返回false
 
 public:
     /**
@@ -27,16 +78,37 @@ public:
      * @param parent 父对象指针
      */
     dht11(QObject *parent = nullptr);
-    
+
     /**
      * @brief 析构函数
      */
     ~dht11();
 
     /**
-     * @brief 读取DHT11传感器的温湿度值
-     * @return 返回温湿度值的字符串，格式为"湿度温度"，例如"3525"表示湿度35%，温度25℃
+     * @brief 读取温湿度
+     * @param maxAgeMs 本次无法得到新数据时，允许返回的缓存数据的最大年龄，0表示不使用缓存
+     * @return 读取结果；新数据cached为false，缓存数据cached为true；都没有时valid为false
+     * @details 可能阻塞：失败后重试前要等满MinIntervalMs，最长约MinIntervalMs加两次驱动读取的时间
+     */
+    Dht11Reading read(qint64 maxAgeMs = 0);
+
+    /**
+     * @brief 设置设备文件路径
+     * @param path 驱动的设备文件，默认/sys/class/misc/dht11/value
+     */
+    void setPath(const QString &path);
+
+    /**
+     * @brief 上一次有效读取，ageMs为当前年龄；还没有有效读取时valid为false
+     */
+    Dht11Reading lastGood() const;
+
+    /**
+     * @brief 校验并解析驱动输出的数据
+     * @param data 数据
+     * @param length 数据长度
+     * @param reading 输出的结果，只填写status、valid、humidity、temperature
      */
-    QString readDHT11value();
+    static void parse(const char *data, int length, Dht11Reading &reading);
 };
 #endif // DHT11_H
@@ -8,8 +8,10 @@ int main(int argc, char *argv[])
     QApplication a(argc, argv);
     dht11 w;
     while(1) {
-        qDebug() << w.readDHT11value()<<endl;
-        sleep(1);
+        Dht11Reading r = w.read(10000);
+        qDebug() << "status" << r.status << "valid" << r.valid << "cached" << r.cached
+                 << "humidity" << r.humidity << "temperature" << r.temperature << "age" << r.ageMs;
+        sleep(2);
     }
     //w.show();
     return a.exec();
@@ -3,8 +3,31 @@
  * @brief ESP8266 WiFi模块通信类的实现文件
  */
 #include "Esp8266.h"
-#include <unistd.h>
-#include <QDebug>
+#include "payloadencoder.h"
+#include "../log/log.h"
+#include <QDateTime>
+#include <QSaveFile>
+#include <QVector>
+
+/* 接收控制命令的订阅主题 */
+static const char SubscribeTopic[] = "/k25r9vo1EmV/esp8266/user/get";
+/* 上传传感器数据的发布主题 */
+static const char PublishTopic[] = "/k25r9vo1EmV/esp8266/user/update";
+/* 上传运行指标的发布主题，需要在云平台产品中添加该自定义主题 */
+static const char MetricsTopic[] = "/k25r9vo1EmV/esp8266/user/metrics";
+/* 发布执行器状态影子的主题，同样需要在云平台产品中添加并配置转发到面板 */
+static const char ShadowTopic[] = "/k25r9vo1EmV/esp8266/user/shadow";
+
+/* 命令去重保留的最近命令数，两条链路的到达时间差远小于这么多条命令的间隔 */
+static const int RecentCommandCount = 32;
+/* 发件箱补发两条数据之间的间隔，避免补发占满串口 */
+static const int DrainIntervalMs = 200;
+/* 批量格式一次发布的最多数据条数，约500字节 */
+static const int MaxBatchRecords = 20;
+/* 连续发布失败多少次后认为链路异常并复位模块 */
+static const int MaxPublishFailures = 3;
+/* 影子发布失败后多久重发全量快照，不等下一次状态变化 */
+static const int ShadowRetryMs = 1000;
 
 /**
  * @brief ESP8266类构造函数
@@ -14,16 +37,41 @@
 Esp8266::Esp8266(QWidget *parent)
 {
     Q_UNUSED(parent)
+    boottimer.start();
+
     /* 串口对象，用于与Esp8266模块通信 */
     serialPort = new QSerialPort(this);
 
-    // 初始化各个设备控制对象
-    led = new Led(this);
-    DHT11 = new dht11();
-    MQ135 = new mq135();
-    Beep = new beep();
-    sg = new SteeringGear();
-    relay = new Relay();
+    /* AT命令队列，负责命令间隔、超时和重试 */
+    commandQueue = new AtCommandQueue(serialPort, this);
+    connect(commandQueue, &AtCommandQueue::commandSucceeded, this, &Esp8266::commandSucceeded);
+    connect(commandQueue, &AtCommandQueue::commandFailed, this, &Esp8266::commandFailed);
+
+    /* 复位后长时间收不到ready时重新复位 */
+    readytimer.setSingleShot(true);
+    connect(&readytimer, &QTimer::timeout, this, &Esp8266::resetModule);
+
+    /* 按设备配置创建执行器和传感器，配置文件不存在时使用内置配置 */
+    devices = new DeviceRegistry(this);
+    devices->load(DeviceRegistry::defaultConfigPath());
+    /* 本地自动化规则(默认只有燃气报警)，规则文件不存在时使用内置规则 */
+    rules = new RuleEngine(devices, this);
+    rules->load(RuleEngine::defaultConfigPath());
+    /* 执行器状态影子，状态变化合并后以增量发布，面板不必等上传周期也不必全量刷新 */
+    shadow = new DeviceShadow(devices, this);
+    connect(shadow, &DeviceShadow::deltaReady, this, &Esp8266::publishShadow);
+    /*
+     * 局域网MQTT链路，默认连接开发板上的mosquitto，面板直接发来的命令不经过云平台和串口，
+     * 设置环境变量SMARTHOME_LAN_BROKER=主机:端口可以指定其它服务器，设为空则关闭
+     */
+    lan = new LanLink(LanLink::defaultBroker("localhost"), "k25r9vo1EmV.esp8266.lan", this);
+    lan->subscribe(LanLink::CommandTopic);
+    connect(lan, &LanLink::messageReceived, this, [this](const QByteArray &message) {
+        handleCommand(message);
+    });
+
+    /* 注册各设备的控制命令处理函数 */
+    registerCommandHandlers();
 
     // 根据平台设置不同的串口设备名
 #if __arm__
@@ -31,6 +79,10 @@ Esp8266::Esp8266(QWidget *parent)
 #else
     serialPort->setPortName("ttyUSB0");
 #endif
+    // 环境变量SMARTHOME_SERIAL_PORT可指定其它串口，例如模拟器创建的伪终端/dev/pts/3
+    QString portName = QString::fromLocal8Bit(qgetenv("SMARTHOME_SERIAL_PORT"));
+    if (!portName.isEmpty())
+        serialPort->setPortName(portName);
 
     /* 设置串口通信参数 */
     serialPort->setBaudRate(115200);       // 波特率
@@ -41,18 +93,72 @@ Esp8266::Esp8266(QWidget *parent)
     
     // 尝试打开串口
     if (!serialPort->open(QIODevice::ReadWrite))
-        qDebug()<<"串口无法打开！可能正在被使用！"<<endl;
+        LOG_ERROR() << "串口无法打开！可能正在被使用！";
     else {
-        qDebug()<<"串口打开成功！"<<endl;
+        LOG_INFO() << "串口打开成功！";
     }
 
-    /* 发送模块复位命令 */
-    sendCmdToEsp8266("AT+RST");
-    
     /* 连接串口信号与槽，接收和处理串口数据 */
     connect(serialPort, &QSerialPort::readyRead, this, &Esp8266::serialPortReadyRead);
 
-    /* 创建并启动数据上传定时器，设置10秒间隔 */
+    /* 发送模块复位命令 */
+    resetModule();
+
+    /*
+     * 每个传感器在各自的I/O线程中按配置的周期采样(默认温湿度每5秒、气体浓度每秒一次)，
+     * 读取对象移动到I/O线程之前先加载MQ-135的校准文件；
+     * 上传格式每种数据只有一个值，每种传感器只上传配置中的第一个设备
+     */
+    sampler = new SensorSampler(this);
+    for (SensorDevice *sensor : devices->sensors()) {
+        if (Mq135Device *gas = qobject_cast<Mq135Device *>(sensor))
+            gas->loadCalibration(store.directory());
+        if (!primarySensors.contains(sensor->sensor()))
+            primarySensors.insert(sensor->sensor(), sensor->id());
+        sampler->addSensor(sensor->sensor(), sensor->id(), sensor->periodMs(), sensor->timeoutMs(),
+                           [sensor](SensorSample &sample) {
+            sensor->read(sample);
+        }, sensor->ioObject());
+    }
+    /*
+     * 本地时序数据按每个传感器的采样周期保留约7天(默认温湿度每5秒、ppm每秒一个采样)；
+     * 每分钟强制同步一次到存储器，掉电最多丢失最近一分钟的数据(内核也会自行回写，通常更早落盘)
+     */
+    for (SensorDevice *sensor : devices->sensors()) {
+        int capacity = 7 * 24 * 3600 * 1000 / sensor->periodMs();
+        if (sensor->sensor() == SensorSample::Dht11) {
+            store.addMetric(seriesName(sensor->sensor(), sensor->id(), "temperature"), capacity);
+            store.addMetric(seriesName(sensor->sensor(), sensor->id(), "humidity"), capacity);
+        } else {
+            store.addMetric(seriesName(sensor->sensor(), sensor->id(), "ppm"), capacity);
+        }
+    }
+    connect(&storeflushtimer, &QTimer::timeout, this, [this]() { store.flush(); });
+    storeflushtimer.start(60000);
+
+    /*
+     * 离线发件箱保存约7天的上传数据，按补发间隔发布。
+     * 默认使用批量格式，固件不支持AT+MQTTPUBRAW时可设置环境变量SMARTHOME_PAYLOAD=json
+     * 改回每条数据一次AT+MQTTPUB的v1格式
+     */
+    batchedPayload = qgetenv("SMARTHOME_PAYLOAD") != "json";
+    outbox.open(store.directory() + "/outbox.dat", 7 * 24 * 360);
+    draintimer.setSingleShot(true);
+    connect(&draintimer, &QTimer::timeout, this, &Esp8266::drainOutbox);
+
+    /* MQTT断开后模块会自动重连，超过60秒仍未恢复则复位模块 */
+    linktimer.setSingleShot(true);
+    connect(&linktimer, &QTimer::timeout, this, &Esp8266::resetModule);
+
+    /* 每5分钟导出一次运行指标 */
+    connect(&metricstimer, &QTimer::timeout, this, &Esp8266::exportMetrics);
+    metricstimer.start(300000);
+
+    connect(sampler, &SensorSampler::sampled, this, &Esp8266::sampleReady);
+    connect(sampler, &SensorSampler::sampleTimedOut, this, &Esp8266::sampleTimedOut);
+    sampler->start();
+
+    /* 创建并启动数据上传定时器，设置10秒间隔，每个周期内的采样合并为一次发布 */
     datauploadtimer = new QTimer();
     datauploadtimer->start(10000);
     
@@ -62,205 +168,600 @@ Esp8266::Esp8266(QWidget *parent)
 
 /**
  * @brief ESP8266类析构函数
+ * @details 子对象按创建顺序释放，设备注册表先于采样调度对象创建；
+ *          先停止并释放采样调度对象，等I/O线程退出后再释放传感器设备，
+ *          避免I/O线程在读取函数中访问已释放的设备。
+ *          有I/O线程阻塞在驱动中无法退出时，设备注册表随之泄漏
  */
 Esp8266::~Esp8266()
 {
+    if (!sampler->shutdown())
+        devices->setParent(nullptr);
+    delete sampler;
+    sampler = nullptr;
+}
+
+/**
+ * @brief MQTT是否已连接并完成订阅
+ */
+bool Esp8266::isConnected() const
+{
+    return mqttConnected;
+}
+
+/**
+ * @brief 最近一次从复位到完成MQTT订阅所用的时间
+ * @return 单位ms，尚未连接成功时返回-1
+ */
+qint64 Esp8266::timeToConnected() const
+{
+    return connectedMs;
+}
+
+/**
+ * @brief 从程序启动到第一次成功发布数据所用的时间
+ * @return 单位ms，尚未发布成功时返回-1
+ */
+qint64 Esp8266::timeToFirstPublish() const
+{
+    return firstPublishMs;
+}
+
+/**
+ * @brief 传感器数据在本地时序数据存储中的名称
+ */
+QString Esp8266::seriesName(int sensor, const QString &id, const char *field) const
+{
+    if (primarySensors.value(sensor) == id)
+        return QString(field);
+    return id + "." + field;
+}
+
+/**
+ * @brief 传感器采样结果处理函数
+ * @param sample 采样结果
+ * @details 按设备标识分别合并：温湿度保留最新值；气体浓度保留滤波后的最新值和未滤波采样的周期内最大值，
+ *          每个采样都立即交给本地规则引擎求值(例如燃气报警)，不必等到上传周期；
+ *          温湿度无效(且没有足够新的缓存)时清除旧数据，不上传；
+ *          所有新读到的有效采样同时写入该设备的本地时序数据，缓存数据不重复写入
+ */
+void Esp8266::sampleReady(const SensorSample &sample)
+{
+    if (SensorDevice *sensor = devices->device<SensorDevice>(sample.device))
+        sensor->update(sample);
+    /* 每个采样立即求值本地规则，不必等到上传周期，也不依赖MQTT连接 */
+    rules->update(sample);
+
+    UploadWindow &window = windows[sample.device];
+    if (!sample.valid) {
+        if (sample.sensor == SensorSample::Dht11)
+            window.hasDht11 = false;
+        return;
+    }
+
+    switch (sample.sensor) {
+    case SensorSample::Dht11:
+        window.hasDht11 = true;
+        window.humidity = sample.humidity;
+        window.temperature = sample.temperature;
+        if (!sample.cached) {
+            store.append(seriesName(sample.sensor, sample.device, "temperature"), sample.timestamp, sample.temperature);
+            store.append(seriesName(sample.sensor, sample.device, "humidity"), sample.timestamp, sample.humidity);
+        }
+        break;
+
+    case SensorSample::Mq135:
+        window.ppm = sample.ppm;
+        if (window.ppmCount == 0 || sample.ppmPeak > window.ppmMax)
+            window.ppmMax = sample.ppmPeak;
+        window.ppmCount++;
+        store.append(seriesName(sample.sensor, sample.device, "ppm"), sample.timestamp, sample.ppm);
+        break;
+    }
+}
+
+/**
+ * @brief 传感器读取超时处理函数
+ * @param sensor 传感器类型
+ * @param id 设备标识
+ * @details 温湿度读取超时时清除该设备的旧数据，避免把过时的温湿度当作当前值上传
+ */
+void Esp8266::sampleTimedOut(int sensor, const QString &id)
+{
+    if (sensor == SensorSample::Dht11)
+        windows[id].hasDht11 = false;
 }
 
 /**
  * @brief 传感器数据定时上传函数
- * @details 读取温湿度传感器和气体传感器数据，封装为JSON格式，通过MQTT协议上传到云平台
+ * @details 把本周期合并的温湿度和气体浓度数据写入发件箱，再由发件箱按顺序发布到云平台；
+ *          无论周期内采样多少次，每个周期只产生一条数据，每种数据取自该类型上传到云端的设备。
+ *          WiFi或MQTT断开时数据留在发件箱中，连接恢复后补发
  */
 void Esp8266::uploadDate()
 {
-    /* 获取温湿度数据 */
-    QString value = DHT11->readDHT11value();
-    int humidity = value.mid(0, 2).toInt();      // 提取湿度值
-    int temperature = value.mid(2, 2).toInt();   // 提取温度值
+    /* 取出本周期的数据，开始新的周期；温湿度变化慢，最新值沿用到下一周期 */
+    UploadWindow climate = windows.value(primarySensors.value(SensorSample::Dht11));
+    UploadWindow gas = windows.value(primarySensors.value(SensorSample::Mq135));
+    for (UploadWindow &window : windows) {
+        window.ppmCount = 0;
+        window.ppmMax = 0;
+    }
+    if (!climate.hasDht11 && gas.ppmCount == 0)
+        return;
 
-    /* 获取空气质量数据(ppm) */
-    float ppm = MQ135->calculateppm();
-    
-    // 当气体浓度超过阈值时触发报警
-    if(ppm >= 10) {
-        Beep->setBeepState(1);  // 打开蜂鸣器
-    } else {
-        Beep->setBeepState(0);  // 关闭蜂鸣器
+    OutboxRecord record;
+    record.timestamp = QDateTime::currentMSecsSinceEpoch();
+    record.hasDht11 = climate.hasDht11;
+    record.humidity = climate.humidity;
+    record.temperature = climate.temperature;
+    record.hasPpm = gas.ppmCount > 0;
+    record.ppm = gas.ppm;
+    record.ppmMax = gas.ppmMax;
+    outbox.push(record);
+
+    drainOutbox();
+}
+
+/**
+ * @brief 从发件箱取出最旧的数据发布
+ * @details 连接未完成或已有发布在等待响应时不发送；
+ *          掉电时写了一半的记录无法读出，直接删除。
+ *          批量模式下一次发布发件箱中所有待发的数据(最多MaxBatchRecords条)：
+ *          在线时每个上传周期的数据写入后立即单独发布，面板显示不滞后；
+ *          断线恢复后积压的数据才合并发布。
+ *          数据通过AT+MQTTPUBRAW在'>'提示符后原样写入，不需要转义
+ */
+void Esp8266::drainOutbox()
+{
+    if (!mqttConnected || publishCount > 0 || outbox.size() == 0)
+        return;
+
+    OutboxRecord record;
+    while (!outbox.peek(0, record)) {
+        outbox.pop(1);
+        if (outbox.size() == 0)
+            return;
+    }
+
+    publishFirstSeq = outbox.firstSeq();
+    if (!batchedPayload) {
+        /* 通过MQTT协议发布传感器数据到指定主题 */
+        publishCount = 1;
+        sendCmdToEsp8266(
+            QString("AT+MQTTPUB=0,\"%1\",\"%2\",0,0").arg(PublishTopic).arg(encodeRecord(record)),
+            3000, 0
+        );
+        return;
     }
 
-    /* 创建JSON对象并添加传感器数据 */
-    QJsonObject jsonObj;
-    jsonObj.insert("humidity", humidity);
-    jsonObj.insert("temperature", temperature);
-    jsonObj.insert("ppm", ppm);
-
-    /* 将JSON对象转换为紧凑格式的JSON字符串 */
-    QJsonDocument jsonDoc(jsonObj);
-    QByteArray jsonData = jsonDoc.toJson(QJsonDocument::Compact);
-
-    /* 将JSON字符串中的特殊字符进行转义处理 */
-    QString escapedjson(jsonData);
-    escapedjson.replace(",", "\\,");
-    escapedjson.replace("\"", "\\\"");
-
-    /* 通过MQTT协议发布传感器数据到指定主题 */
-    sendCmdToEsp8266(
-        QString("AT+MQTTPUB=0,\"/k25r9vo1EmV/esp8266/user/update\",\"%1\",0,0")
-            .arg(escapedjson)
+    /* 取出连续的有效数据，遇到损坏的记录时截断，留到下一次发布时删除 */
+    QVector<OutboxRecord> records;
+    records.append(record);
+    int count = qMin(outbox.size(), (int)MaxBatchRecords);
+    for (int i = 1; i < count && outbox.peek(i, record); i++)
+        records.append(record);
+
+    QByteArray payload = encodeBatch(records);
+    publishCount = records.size();
+    commandQueue->enqueueData(
+        QString("AT+MQTTPUBRAW=0,\"%1\",%2,0,0").arg(PublishTopic).arg(payload.size()).toUtf8(),
+        payload, 5000, 0
     );
 }
 
+/**
+ * @brief 发布设备影子
+ * @details 局域网链路已连接时立即发布，不等待云端；云端连接未完成时只发布到局域网，
+ *          云端订阅成功后再发布全量快照。云端上一条影子发布尚未返回时，本版本云端不再单独补发，
+ *          返回后改发全量快照，期间的命令确认保留到快照中；云端发布失败时同样改发全量快照，面板据此纠正丢失的增量
+ */
+void Esp8266::publishShadow()
+{
+    bool cloudReady = mqttConnected && !shadowInFlight;
+    if (!cloudReady && !lan->isConnected())
+        return;
+
+    QByteArray payload;
+    if (shadowResync) {
+        payload = shadow->snapshot();
+        shadowResync = false;
+    } else if (shadow->hasDelta()) {
+        payload = shadow->takeDelta();
+    } else {
+        return;
+    }
+
+    lan->publish(LanLink::ShadowTopic, payload);
+    if (!cloudReady) {
+        /* 云端稍后补发全量快照，本次的命令确认随快照一起经云端发布 */
+        if (mqttConnected) {
+            shadowResync = true;
+            shadow->requeueAcks();
+        }
+        return;
+    }
+
+    shadowInFlight = true;
+    if (batchedPayload) {
+        commandQueue->enqueueData(
+            QString("AT+MQTTPUBRAW=0,\"%1\",%2,0,0").arg(ShadowTopic).arg(payload.size()).toUtf8(),
+            payload, 3000, 0
+        );
+    } else {
+        sendCmdToEsp8266(
+            QString("AT+MQTTPUB=0,\"%1\",\"%2\",0,0").arg(ShadowTopic).arg(escapeAtString(payload)),
+            3000, 0
+        );
+    }
+}
+
 /**
  * @brief 发送AT命令到ESP8266模块
  * @param cmd 要发送的AT命令字符串
- * @details 在命令末尾添加回车换行符，并通过串口发送到ESP8266模块
+ * @param timeoutMs 等待响应的超时时间，单位ms
+ * @param retries 失败后的重试次数
+ * @param delayMs 与上一条命令之间的间隔，单位ms
+ * @details 命令放入异步队列，由队列在末尾添加回车换行符并通过串口发送到ESP8266模块
+ */
+void Esp8266::sendCmdToEsp8266(QString cmd, int timeoutMs, int retries, int delayMs)
+{
+    commandQueue->enqueue(cmd.toUtf8(), timeoutMs, retries, delayMs);
+}
+
+/**
+ * @brief 复位ESP8266模块并重新开始连接流程
+ * @details 清空命令队列后发送AT+RST，等待模块输出ready；
+ *          超过10秒没有收到ready则再次复位
+ */
+void Esp8266::resetModule()
+{
+    static MetricCounter *resets = Metrics::counter("esp8266.resets");
+    resets->add();
+
+    mqttConnected = false;
+    publishCount = 0;
+    publishFailures = 0;
+    shadowInFlight = false;
+    shadowResync = true;
+    linktimer.stop();
+    commandQueue->clear();
+    parser.reset();
+
+    connecttimer.start();
+    sendCmdToEsp8266("AT+RST");
+    readytimer.start(10000);
+}
+
+/**
+ * @brief 模块复位完成后，依次把连接WiFi和MQTT的命令放入队列
+ * @details 每条命令等到上一条命令返回OK后再发送，命令之间的间隔由定时器完成，
+ *          连接WiFi和MQTT服务器耗时较长，超时时间相应放宽
  */
-void Esp8266::sendCmdToEsp8266(QString cmd)
+void Esp8266::startBringUp()
 {
-    // 在命令末尾添加回车换行符
-    cmd = cmd + "\r\n";
-    qDebug() << cmd << endl;
+    const int pace = 100;
 
-    // 将命令转换为UTF-8编码并发送
-    QByteArray data = cmd.toUtf8();
-    serialPort->write(data);
+    commandQueue->clear();
+
+    // 设置为Station模式(STA)
+    sendCmdToEsp8266("AT+CWMODE=1", 2000, 2, pace);
+    // 连接到指定的WiFi网络
+    sendCmdToEsp8266("AT+CWJAP=\"Preference\",\"9624641314\"", 20000, 1, pace);
+    // 设置时区和SNTP服务器
+    sendCmdToEsp8266("AT+CIPSNTPCFG=1,8,\"ntp1.aliyun.com\"", 2000, 2, pace);
+    // 配置MQTT用户属性
+    sendCmdToEsp8266("AT+MQTTUSERCFG=0,1,\"NULL\",\"esp8266&k25r9vo1EmV\",\"ec9b0ed647b36cd271dc34fdac6171f1b559ed2cfa053a8520dab8df5aaa0ed1\",0,0,\"\"", 2000, 2, pace);
+    // 设置MQTT客户端ID
+    sendCmdToEsp8266("AT+MQTTCLIENTID=0,\"k25r9vo1EmV.esp8266|securemode=2\\,signmethod=hmacsha256\\,timestamp=1735386764701|\"", 2000, 2, pace);
+    // 连接MQTT Broker
+    sendCmdToEsp8266("AT+MQTTCONN=0,\"iot-06z00jdbr4qssk5.mqtt.iothub.aliyuncs.com\",1883,1", 10000, 2, pace);
+    // 订阅MQTT主题
+    sendCmdToEsp8266(QString("AT+MQTTSUB=0,\"%1\",0").arg(SubscribeTopic), 5000, 2, pace);
 }
 
 /**
  * @brief 串口数据接收处理函数
- * @details 读取ESP8266模块返回的数据，并根据不同的返回内容执行相应的操作：
- *          - 处理模块复位响应
- *          - 配置WiFi模式
- *          - 连接WiFi网络
- *          - 配置SNTP服务器
- *          - 配置MQTT客户端
- *          - 连接MQTT服务器
- *          - 订阅MQTT主题
- *          - 处理接收到的MQTT消息并控制相应设备
+ * @details 按块读取串口数据送入流式解析器，解析器每识别出一条完整响应就处理一次；
+ *          不再把数据累积到字符串中反复查找，已处理的数据不会被再次扫描
  */
 void Esp8266::serialPortReadyRead()
 {
-    /* 从接收缓冲区读取数据 */
-    QByteArray buf = serialPort->readAll();
-
-    // 将接收到的数据转换为字符串并追加到缓存中
-    QString temp = QString(buf);
-    readData.append(temp);
-    qDebug()<<temp<<endl;
-
-    // 处理ESP8266模块复位成功的响应
-    if  (readData.contains("ready")) {
-        // 设置为Station模式(STA)
-        sendCmdToEsp8266("AT+CWMODE=1");
-        readData.clear();
+    char buf[256];
+    qint64 len;
+
+    /* 从接收缓冲区分块读取数据，每块都立即交给解析器处理 */
+    while ((len = serialPort->read(buf, sizeof(buf))) > 0) {
+        parser.feed(buf, (int)len);
+
+        AtResponse response;
+        while (parser.next(response))
+            handleResponse(response);
     }
+}
+
+/**
+ * @brief 处理一条完整的AT响应
+ * @param response 解析器返回的响应
+ * @details OK/ERROR交给命令队列匹配到正在等待的命令，
+ *          ready、订阅消息和MQTT断开/重连等异步上报在这里处理
+ */
+void Esp8266::handleResponse(const AtResponse &response)
+{
+    LOG_TRACE() << response.data;
+
+    if (commandQueue->handleResponse(response))
+        return;
+
+    switch (response.type) {
+    case AtResponse::Ready:
+        // 模块复位成功(包括意外重启)，重新开始连接流程
+        readytimer.stop();
+        mqttConnected = false;
+        startBringUp();
+        break;
 
-    // 处理设置WiFi模式成功的响应
-    if (readData.contains("OK") && readData.contains("AT+CWMODE")) {
-        qDebug()<<"设置STA模式成功"<<endl;
-        // 连接到指定的WiFi网络
-        sendCmdToEsp8266("AT+CWJAP=\"Preference\",\"9624641314\"");
-        qDebug()<<"开始连接WIFI"<<endl;
-        readData.clear();
+    case AtResponse::MqttSubRecv:
+        handleSubRecv(response);
+        break;
+
+    default:
+        if (response.startsWith("+MQTTDISCONNECTED")) {
+            // MQTT断开，数据先留在发件箱中，等待模块自动重连
+            static MetricCounter *disconnects = Metrics::counter("mqtt.disconnects");
+            disconnects->add();
+            LOG_WARN() << "MQTT连接断开，等待重连";
+            mqttConnected = false;
+            shadowResync = true;
+            linktimer.start(60000);
+        } else if (response.startsWith("+MQTTCONNECTED") && !mqttConnected &&
+                   connectedMs >= 0 && commandQueue->isIdle()) {
+            // 模块自动重连成功，重新订阅主题，订阅成功后补发积压的数据
+            sendCmdToEsp8266(QString("AT+MQTTSUB=0,\"%1\",0").arg(SubscribeTopic), 5000, 2);
+        }
+        // 命令回显和其它信息行不需要处理
+        break;
     }
+}
 
-    // 处理WiFi连接成功的响应
-    if  (readData.contains("WIFI GOT IP") && readData.contains("OK")) {
-        qDebug()<<"连接WIFI成功"<<endl;
-        sleep(1);
-        // 设置时区和SNTP服务器
-        sendCmdToEsp8266("AT+CIPSNTPCFG=1,8,\"ntp1.aliyun.com\"");
-        qDebug()<<"开始设置时区和SNTP服务器:北京时间,阿里云服务器请等待"<<endl;
-        readData.clear();
+/**
+ * @brief AT命令执行成功处理
+ * @param cmd AT命令
+ * @param elapsedMs 命令往返时间，单位ms
+ */
+void Esp8266::commandSucceeded(const QByteArray &cmd, qint64 elapsedMs)
+{
+    Q_UNUSED(elapsedMs)
+
+    // 运行指标的发布与发件箱无关，成功与否都不影响上传数据
+    if (cmd.contains(MetricsTopic))
+        return;
+    // 影子发布与发件箱无关，返回后发布期间积累的增量
+    if (cmd.contains(ShadowTopic)) {
+        shadowInFlight = false;
+        publishShadow();
+        return;
     }
 
-    // 处理设置SNTP成功的响应
-    if (readData.contains("OK") && readData.contains("AT+CIPSNTPCFG")) {
-        qDebug()<<"设置时区和SNTP服务器成功"<<endl;
-        sleep(1);
-        // 配置MQTT用户属性
-        sendCmdToEsp8266("AT+MQTTUSERCFG=0,1,\"NULL\",\"esp8266&k25r9vo1EmV\",\"ec9b0ed647b36cd271dc34fdac6171f1b559ed2cfa053a8520dab8df5aaa0ed1\",0,0,\"\"");
-        qDebug()<<"开始设置MQTT用户属性"<<endl;
-        readData.clear();
+    if (cmd.startsWith("AT+CWMODE")) {
+        LOG_INFO() << "设置STA模式成功，开始连接WIFI";
+    } else if (cmd.startsWith("AT+CWJAP")) {
+        LOG_INFO() << "连接WIFI成功，开始设置时区和SNTP服务器:北京时间,阿里云服务器";
+    } else if (cmd.startsWith("AT+CIPSNTPCFG")) {
+        LOG_INFO() << "设置时区和SNTP服务器成功，开始设置MQTT用户属性";
+    } else if (cmd.startsWith("AT+MQTTUSERCFG")) {
+        LOG_INFO() << "MQTT用户属性设置成功，开始设置MQTT客户端ID";
+    } else if (cmd.startsWith("AT+MQTTCLIENTID")) {
+        LOG_INFO() << "MQTT客户端ID设置成功，开始连接MQTT Broker";
+    } else if (cmd.startsWith("AT+MQTTCONN")) {
+        LOG_INFO() << "MQTT Broker连接成功，开始订阅主题";
+    } else if (cmd.startsWith("AT+MQTTSUB")) {
+        mqttConnected = true;
+        connectedMs = connecttimer.elapsed();
+        linktimer.stop();
+        LOG_INFO() << "主题订阅成功，连接用时" << connectedMs << "ms";
+        emit connected(connectedMs);
+        shadowResync = true;
+        publishShadow();
+        drainOutbox();
+    } else if (cmd.startsWith("AT+MQTTPUB")) {
+        if (firstPublishMs < 0) {
+            firstPublishMs = boottimer.elapsed();
+            LOG_INFO() << "首次发布成功，启动用时" << firstPublishMs << "ms";
+        }
+        // 发布已确认，从发件箱删除，按补发间隔继续发布积压的数据；
+        // 发布期间发件箱满时最旧的记录已被覆盖，按发布时的序号删除，不误删后写入的记录
+        static MetricCounter *published = Metrics::counter("mqtt.published_records");
+        published->add(publishCount);
+        outbox.popUntil(publishFirstSeq + publishCount);
+        publishCount = 0;
+        publishFailures = 0;
+        if (outbox.size() > 0)
+            draintimer.start(DrainIntervalMs);
     }
+}
 
-    // 处理设置MQTT用户属性成功的响应
-    if (readData.contains("OK") && readData.contains("AT+MQTTUSERCFG")) {
-        qDebug()<<"MQTT用户属性设置成功"<<endl;
-        sleep(1);
-        // 设置MQTT客户端ID
-        sendCmdToEsp8266("AT+MQTTCLIENTID=0,\"k25r9vo1EmV.esp8266|securemode=2\\,signmethod=hmacsha256\\,timestamp=1735386764701|\"");
-        qDebug()<<"开始设置MQTT客户端ID"<<endl;
-        readData.clear();
+/**
+ * @brief AT命令重试用尽后仍失败的处理
+ * @param cmd AT命令
+ * @details 数据发布失败时数据保留在发件箱中稍后重发，连续失败多次认为链路异常；
+ *          影子发布失败时稍后重发全量快照，执行器状态不再变化时面板也能收到正确的状态和命令确认；
+ *          连接流程中的命令失败时复位模块重新连接
+ */
+void Esp8266::commandFailed(const QByteArray &cmd)
+{
+    LOG_WARN() << "命令失败:" << cmd;
+
+    if (cmd.contains(MetricsTopic))
+        return;
+    if (cmd.contains(ShadowTopic)) {
+        shadowInFlight = false;
+        shadowResync = true;
+        shadow->requeueAcks();
+        QTimer::singleShot(ShadowRetryMs, this, &Esp8266::publishShadow);
+        return;
     }
 
-    // 处理设置MQTT客户端ID成功的响应
-    if (readData.contains("OK") && readData.contains("AT+MQTTCLIENTID")) {
-        qDebug()<<"MQTT客户端ID设置成功"<<endl;
-        sleep(1);
-        // 连接MQTT Broker
-        sendCmdToEsp8266("AT+MQTTCONN=0,\"iot-06z00jdbr4qssk5.mqtt.iothub.aliyuncs.com\",1883,1");
-        qDebug()<<"开始连接MQTT Broker"<<endl;
-        readData.clear();
+    if (cmd.startsWith("AT+MQTTPUB")) {
+        static MetricCounter *failures = Metrics::counter("mqtt.publish_failures");
+        failures->add();
+        publishCount = 0;
+        if (++publishFailures >= MaxPublishFailures)
+            resetModule();
+        else
+            draintimer.start(1000);
+        return;
     }
 
-    // 处理MQTT连接成功的响应
-    if (readData.contains("OK") && readData.contains("AT+MQTTCONN")) {
-        qDebug()<<"MQTT Broker连接成功"<<endl;
-        sleep(1);
-        // 订阅MQTT主题
-        sendCmdToEsp8266("AT+MQTTSUB=0,\"/k25r9vo1EmV/esp8266/user/get\",0");
-        qDebug()<<"订阅主题"<<endl;
-        readData.clear();
+    if (!mqttConnected)
+        resetModule();
+}
+
+/**
+ * @brief 处理订阅主题收到的消息帧
+ * @param response +MQTTSUBRECV响应，主题和数据已由解析器解码
+ */
+void Esp8266::handleSubRecv(const AtResponse &response)
+{
+    QByteArray topic = QByteArray::fromRawData(response.topic, response.topicLength);
+    if (topic != SubscribeTopic) {
+        LOG_LIMITED(LogWarn, 10000) << "忽略未订阅主题的消息:" << topic;
+        return;
     }
 
-    // 处理MQTT主题订阅成功的响应
-    if (readData.contains("OK") && readData.contains("AT+MQTTSUB")) {
-        qDebug()<<"主题订阅成功"<<endl;
-        readData.clear();
+    handleCommand(QByteArray::fromRawData(response.payload, response.payloadLength));
+}
+
+/**
+ * @brief 执行一条控制命令
+ * @param payload 控制命令JSON
+ * @details 数据只解析一次JSON，对象中的每个键通过分发表交给对应的处理函数，
+ *          例如{"livingroomlump":"open","relay":"close"}会在一次处理中同时控制客厅灯和继电器；
+ *          带"id"的命令(例如{"relay":"open","id":7,"ts":1737095730012})在所有设备写入完成后
+ *          通过设备影子立即确认，执行耗时记录到运行指标。
+ *          面板在局域网确认超时后会把同一条命令再经云端发送一次，已执行过的命令不再执行，
+ *          只按第一次的执行结果再确认一次
+ */
+void Esp8266::handleCommand(const QByteArray &payload)
+{
+    /* 解析Json数据 */
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(payload, &error);
+    if (!doc.isObject()) {
+        LOG_LIMITED(LogWarn, 10000) << "控制命令不是有效的JSON对象:" << error.errorString();
+        return;
     }
 
-    // 处理客厅灯控制的MQTT消息
-    if (readData.contains("livingroomlump") && readData.contains("MQTTSUBRECV")) {
-        if (readData.contains("open")) {
-            led->setLedState(true);  // 打开LED灯
-            qDebug()<<"客厅灯打开"<<endl;
-            readData.clear();
-        } else if (readData.contains("close")) {
-            led->setLedState(false); // 关闭LED灯
-            qDebug()<<"客厅灯关闭"<<endl;
-            readData.clear();
+    static MetricCounter *received = Metrics::counter("mqtt.commands");
+    static MetricCounter *duplicates = Metrics::counter("commands.duplicates");
+    static MetricHistogram *latency = Metrics::histogram("commands.exec_us");
+    received->add();
+
+    /* id和ts不是设备键，执行完后随影子增量原样返回 */
+    QJsonObject jsonObj = doc.object();
+    QJsonValue id = jsonObj.take("id");
+    QJsonValue ts = jsonObj.take("ts");
+
+    /* 重复到达的命令不再执行，但要按第一次的结果再确认一次：第一条链路的确认可能已经丢失 */
+    QString key;
+    if (!id.isUndefined()) {
+        key = id.toVariant().toString() + "@" + ts.toVariant().toString();
+        for (const RecentCommand &recent : recentCommands) {
+            if (recent.key == key) {
+                duplicates->add();
+                shadow->acknowledge(id, ts, recent.ok);
+                return;
+            }
         }
     }
 
-    // 处理窗帘控制的MQTT消息
-    if (readData.contains("curtain") && readData.contains("MQTTSUBRECV")) {
-        if (readData.contains("open")) {
-            sg->SGturnClockwise();   // 窗帘顺时针转动(打开)
-            qDebug()<<"窗帘打开"<<endl;
-            readData.clear();
-        } else if(readData.contains("close")) {
-            sg->SGcounterclockwise(); // 窗帘逆时针转动(关闭)
-            qDebug()<<"窗帘关闭"<<endl;
-            readData.clear();
-        } else if(readData.contains("stop")) {
-            sg->SGstop();            // 窗帘停止转动
-            qDebug()<<"窗帘停止"<<endl;
-            readData.clear();
+    bool ok = true;
+    {
+        MetricTimer timer(latency);
+        for (QJsonObject::const_iterator it = jsonObj.constBegin(); it != jsonObj.constEnd(); ++it) {
+            CommandHandler handler = commandHandlers.value(it.key());
+            if (handler) {
+                ok = handler(it.value()) && ok;
+            } else {
+                LOG_LIMITED(LogWarn, 10000) << "未知的控制命令:" << it.key();
+                ok = false;
+            }
         }
     }
 
-    // 处理继电器控制的MQTT消息
-    if (readData.contains("relay") && readData.contains("MQTTSUBRECV")) {
-        if (readData.contains("open")) {
-            relay->setRelayState(true);  // 打开继电器
-            qDebug()<<"继电器打开"<<endl;
-            readData.clear();
-        } else if (readData.contains("close")) {
-            relay->setRelayState(false); // 关闭继电器
-            qDebug()<<"继电器关闭"<<endl;
-            readData.clear();
-        }
+    if (!id.isUndefined()) {
+        recentCommands.append(RecentCommand{key, ok});
+        if (recentCommands.size() > RecentCommandCount)
+            recentCommands.removeFirst();
+        shadow->acknowledge(id, ts, ok);
     }
 }
 
+/**
+ * @brief 注册控制命令处理函数
+ * @param key 控制命令JSON中的设备键
+ * @param handler 处理函数
+ */
+void Esp8266::registerCommand(const QString &key, CommandHandler handler)
+{
+    commandHandlers.insert(key, handler);
+}
+
+/**
+ * @brief 为每个接受云端控制的设备注册控制命令处理函数
+ * @details 设备标识即命令JSON中的键，例如{"livingroomlump":"open"}、{"curtain":40}；
+ *          {"shadow":"get"}请求重新发布全量影子，面板启动或发现增量丢失时发送
+ */
+void Esp8266::registerCommandHandlers()
+{
+    registerCommand("shadow", [this](const QJsonValue &value) {
+        if (value.toString() != "get")
+            return false;
+        shadowResync = true;
+        publishShadow();
+        return true;
+    });
+
+    for (Device *device : devices->devices()) {
+        if (!device->isRemote())
+            continue;
+        registerCommand(device->id(), [device](const QJsonValue &value) {
+            if (device->command(value))
+                return true;
+            LOG_WARN() << "控制命令执行失败:" << device->id() << value.toVariant().toString();
+            return false;
+        });
+    }
+}
+
+/**
+ * @brief 导出运行指标快照
+ * @details 先更新发件箱积压、解析器丢弃等状态类指标；
+ *          完整快照(含直方图分桶)通过QSaveFile写入<数据目录>/metrics.json，写入过程中掉电不会留下半个文件；
+ *          已连接且使用批量格式时，不含分桶的精简快照通过AT+MQTTPUBRAW发布到指标主题
+ */
+void Esp8266::exportMetrics()
+{
+    Metrics::gauge("outbox.pending")->set(outbox.size());
+    Metrics::gauge("outbox.dropped")->set(outbox.droppedCount());
+    Metrics::gauge("parser.overflows")->set(parser.overflowCount());
+    Metrics::gauge("parser.dropped_bytes")->set(parser.droppedBytes());
+    Metrics::gauge("mqtt.connected")->set(mqttConnected);
+    Metrics::gauge("log.dropped")->set(Logger::droppedCount());
+
+    QSaveFile file(store.directory() + "/metrics.json");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(Metrics::snapshot(true));
+        if (!file.commit())
+            LOG_WARN() << "运行指标写入失败:" << file.errorString();
+    }
+
+    /* v1格式的AT+MQTTPUB命令行长度有限，只在批量格式下发布 */
+    if (!mqttConnected || !batchedPayload)
+        return;
+    QByteArray payload = Metrics::snapshot(false);
+    commandQueue->enqueueData(
+        QString("AT+MQTTPUBRAW=0,\"%1\",%2,0,0").arg(MetricsTopic).arg(payload.size()).toUtf8(),
+        payload, 5000, 0
+    );
+}
@@ -11,12 +11,19 @@
 #include <QTimer>
 #include <QJsonObject>
 #include <QJsonDocument>
-#include "../led/led.h"
-#include "../dht11/dht11.h"
-#include "../MQ-135/mq135.h"
-#include "../beep/beep.h"
-#include "../steeringgear/steeringgear.h"
-#include "../relay/relay.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <functional>
+#include "../device/deviceregistry.h"
+#include "../device/deviceshadow.h"
+#include "../rules/ruleengine.h"
+#include "../lan/lanlink.h"
+#include "atparser.h"
+#include "atcommandqueue.h"
+#include "sensorsampler.h"
+#include "outbox.h"
+#include "../tsstore/timeseriesstore.h"
+#include "../metrics/metrics.h"
 
 /**
  * @class Esp8266
@@ -44,23 +51,163 @@ public:
      */
     ~Esp8266();
 
+    /**
+     * @brief MQTT是否已连接并完成订阅
+     */
+    bool isConnected() const;
+
+    /**
+     * @brief 最近一次从复位到完成MQTT订阅所用的时间
+     * @return 单位ms，尚未连接成功时返回-1
+     */
+    qint64 timeToConnected() const;
+
+    /**
+     * @brief 从程序启动到第一次成功发布数据所用的时间
+     * @return 单位ms，尚未发布成功时返回-1
+     */
+    qint64 timeToFirstPublish() const;
+
+signals:
+    /**
+     * @brief MQTT连接并订阅成功
+     * @param elapsedMs 从复位到完成订阅所用的时间，单位ms
+     */
+    void connected(qint64 elapsedMs);
+
 private:
-    Led *led;                 ///< LED控制对象
     QSerialPort *serialPort;  ///< 串口通信对象，用于与ESP8266模块通信
-    dht11 *DHT11;             ///< DHT11温湿度传感器对象
-    beep *Beep;               ///< 蜂鸣器控制对象
-    mq135 *MQ135;             ///< MQ-135气体传感器对象
-    SteeringGear *sg;         ///< 舵机控制对象
-    Relay *relay;             ///< 继电器控制对象
+    DeviceRegistry *devices;  ///< 按配置创建的执行器和传感器
+    RuleEngine *rules;        ///< 本地自动化规则引擎
+    DeviceShadow *shadow;     ///< 执行器状态影子，只发布变化的字段
+    LanLink *lan;             ///< 局域网MQTT链路，面板在同一局域网时直接收发命令和影子
     QTimer *datauploadtimer;  ///< 数据上传定时器，定时上传温湿度和气体浓度数据
+    AtCommandQueue *commandQueue; ///< AT命令异步发送队列
+    SensorSampler *sampler;   ///< 传感器采样调度对象，每个传感器在独立的I/O线程中读取
+    TimeSeriesStore store;    ///< 本地时序数据存储，保存温度、湿度、ppm的历史数据
+    QTimer storeflushtimer;   ///< 时序数据同步定时器，限制掉电丢失数据的时长
+    Outbox outbox;            ///< 离线发件箱，保存尚未确认上传的数据
+    QTimer draintimer;        ///< 发件箱补发定时器，限制补发速率
+    QTimer linktimer;         ///< MQTT断开后等待模块自动重连的超时定时器
+    QTimer metricstimer;      ///< 运行指标导出定时器
+    QTimer readytimer;        ///< 复位后等待ready的超时定时器
 
     /**
      * @brief 发送AT命令到ESP8266模块
      * @param cmd 要发送的AT命令字符串
+     * @param timeoutMs 等待响应的超时时间，单位ms
+     * @param retries 失败后的重试次数
+     * @param delayMs 与上一条命令之间的间隔，单位ms
+     * @details 命令进入异步队列按顺序发送，不会阻塞事件循环
+     */
+    void sendCmdToEsp8266(QString cmd, int timeoutMs = 2000, int retries = 2, int delayMs = 0);
+
+    /**
+     * @brief 复位ESP8266模块并重新开始连接流程
+     */
+    void resetModule();
+
+    /**
+     * @brief 模块复位完成后，依次把连接WiFi和MQTT的命令放入队列
+     */
+    void startBringUp();
+
+    /**
+     * @brief 从发件箱取出最旧的数据发布
+     * @details 同一时刻只有一条发布在等待响应，发布成功后才从发件箱删除；
+     *          批量模式下一次发布多条数据
+     */
+    void drainOutbox();
+
+    /**
+     * @brief 发布设备影子
+     * @details 需要全量同步时发布快照，否则发布尚未发布的增量；
+     *          局域网链路立即发布，云端同一时刻只有一条影子发布在等待响应
+     */
+    void publishShadow();
+
+    /**
+     * @brief 处理一条完整的AT响应
+     * @param response 解析器返回的响应
+     * @details 每条响应只处理一次，根据最近发送的命令推进连接流程或执行控制命令
+     */
+    void handleResponse(const AtResponse &response);
+
+    /**
+     * @brief 处理订阅主题收到的消息帧
+     * @param response +MQTTSUBRECV响应，主题和数据已由解析器解码
+     */
+    void handleSubRecv(const AtResponse &response);
+
+    /**
+     * @brief 执行一条控制命令
+     * @param payload 控制命令JSON，来自云端订阅主题或局域网命令主题
+     * @details 同一条命令可能从两条链路各到达一次，带id的命令按id和ts去重
      */
-    void sendCmdToEsp8266(QString cmd);
+    void handleCommand(const QByteArray &payload);
 
-    QString readData = nullptr;   ///< 从ESP8266接收到的数据缓存
+    /**
+     * @brief 控制命令处理函数，参数为JSON中该设备键对应的值，返回是否执行成功
+     */
+    typedef std::function<bool(const QJsonValue &)> CommandHandler;
+
+    /**
+     * @brief 注册控制命令处理函数
+     * @param key 控制命令JSON中的设备键，例如"relay"
+     * @param handler 处理函数
+     */
+    void registerCommand(const QString &key, CommandHandler handler);
+
+    /**
+     * @brief 为每个接受云端控制的设备注册控制命令处理函数
+     */
+    void registerCommandHandlers();
+
+    QHash<QString, CommandHandler> commandHandlers;  ///< 设备键到处理函数的分发表
+    /**
+     * @brief 最近执行过的一条带id的命令
+     */
+    struct RecentCommand {
+        QString key;              ///< "id@ts"
+        bool ok;                  ///< 执行结果，重复到达时原样确认
+    };
+    QList<RecentCommand> recentCommands;  ///< 最近执行过的命令，用于去重
+
+    AtParser parser;              ///< AT响应流式解析器
+    bool mqttConnected = false;   ///< MQTT是否已连接并完成订阅
+    bool batchedPayload = true;   ///< 是否使用批量格式通过AT+MQTTPUBRAW发布
+    int publishCount = 0;         ///< 正在等待响应的发布包含的数据条数，0表示没有发布
+    quint64 publishFirstSeq = 0;  ///< 正在等待响应的发布中第一条数据在发件箱中的序号
+    int publishFailures = 0;      ///< 连续发布失败次数
+    bool shadowInFlight = false;  ///< 是否有影子发布在等待响应
+    bool shadowResync = true;     ///< 下一次影子发布是否需要全量快照
+    QElapsedTimer boottimer;      ///< 程序启动计时
+    QElapsedTimer connecttimer;   ///< 本次复位到连接成功的计时
+    qint64 connectedMs = -1;      ///< 最近一次复位到连接成功的用时
+    qint64 firstPublishMs = -1;   ///< 启动到第一次发布成功的用时
+
+    /**
+     * @brief 一个上传周期内合并的采样数据
+     */
+    struct UploadWindow {
+        bool hasDht11 = false;    ///< 是否有有效的温湿度数据
+        int humidity = 0;         ///< 最新湿度
+        int temperature = 0;      ///< 最新温度
+        int ppmCount = 0;         ///< 本周期有效的气体浓度采样数
+        float ppm = 0;            ///< 最新气体浓度
+        float ppmMax = 0;         ///< 本周期未滤波气体浓度的最大值，短时的浓度尖峰不被滤波抹平
+    };
+    QHash<QString, UploadWindow> windows; ///< 各传感器当前上传周期的合并数据，按设备标识
+    QHash<int, QString> primarySensors;   ///< 每种传感器中上传到云端的设备(配置中该类型的第一个)
+
+    /**
+     * @brief 传感器数据在本地时序数据存储中的名称
+     * @param sensor 传感器类型
+     * @param id 设备标识
+     * @param field 数据字段，如"temperature"
+     * @return 上传到云端的设备直接使用字段名(面板按此读取历史曲线)，其它设备为"<id>.<字段名>"
+     */
+    QString seriesName(int sensor, const QString &id, const char *field) const;
 
 private slots:
     /**
@@ -71,9 +218,42 @@ private slots:
     
     /**
      * @brief 传感器数据定时上传函数
-     * @details 定时读取温湿度传感器和气体传感器数据，通过MQTT上传到云端
+     * @details 把一个上传周期内合并的温湿度和气体浓度数据通过MQTT上传到云端
      */
     void uploadDate();
+
+    /**
+     * @brief 传感器采样结果处理函数
+     * @param sample 采样结果
+     * @details 在主线程中执行，把结果合并到当前上传周期，并交给本地规则引擎求值
+     */
+    void sampleReady(const SensorSample &sample);
+
+    /**
+     * @brief 传感器读取超时处理函数
+     * @param sensor 传感器类型
+     * @param id 设备标识
+     */
+    void sampleTimedOut(int sensor, const QString &id);
+
+    /**
+     * @brief AT命令执行成功处理
+     * @param cmd AT命令
+     * @param elapsedMs 命令往返时间，单位ms
+     */
+    void commandSucceeded(const QByteArray &cmd, qint64 elapsedMs);
+
+    /**
+     * @brief AT命令重试用尽后仍失败的处理
+     * @param cmd AT命令
+     */
+    void commandFailed(const QByteArray &cmd);
+
+    /**
+     * @brief 导出运行指标快照
+     * @details 完整快照写入数据目录下的metrics.json，精简快照通过MQTT发布
+     */
+    void exportMetrics();
 };
 
 #endif // ESP8266_H
@@ -17,18 +17,32 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
     Esp8266.cpp \
-    main.cpp
+    atcommandqueue.cpp \
+    atparser.cpp \
+    main.cpp \
+    outbox.cpp \
+    payloadencoder.cpp \
+    sensorsampler.cpp
 
 HEADERS += \
-    Esp8266.h
+    Esp8266.h \
+    atcommandqueue.h \
+    atparser.h \
+    outbox.h \
+    payloadencoder.h \
+    sensorsampler.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
-include(../led/led.pri)
+include(../device/device.pri)
+include(../rules/rules.pri)
+include(../lan/lan.pri)
 include(../dht11/dht11.pri)
-include(../beep/beep.pri)
 include(../MQ-135/mq135.pri)
 include(../steeringgear/steeringgear.pri)
-include(../relay/relay.pri)
+include(../sysfs/sysfs.pri)
+include(../tsstore/tsstore.pri)
+include(../metrics/metrics.pri)
+include(../log/log.pri)
@@ -0,0 +1,196 @@
+/**
+ * @file atcommandqueue.cpp
+ * @brief AT命令异步发送队列的实现文件
+ */
+#include "atcommandqueue.h"
+#include "../metrics/metrics.h"
+#include "../log/log.h"
+
+/**
+ * @brief AtCommandQueue类构造函数
+ * @param device 命令写入的设备(串口)
+ * @param parent 父对象指针
+ */
+AtCommandQueue::AtCommandQueue(QIODevice *device, QObject *parent)
+    : QObject(parent), device(device), busy(false), waiting(false), dataSent(false)
+{
+    paceTimer.setSingleShot(true);
+    timeoutTimer.setSingleShot(true);
+
+    connect(&paceTimer, &QTimer::timeout, this, &AtCommandQueue::sendCurrent);
+    connect(&timeoutTimer, &QTimer::timeout, this, &AtCommandQueue::commandTimeout);
+}
+
+/**
+ * @brief AtCommandQueue类析构函数
+ */
+AtCommandQueue::~AtCommandQueue()
+{
+}
+
+/**
+ * @brief 命令入队
+ * @details 队列空闲时立即安排发送，否则等待前面的命令完成
+ */
+void AtCommandQueue::enqueue(const QByteArray &cmd, int timeoutMs, int retries,
+                             int delayMs, AtResponse::Type expect)
+{
+    Command command = { cmd, QByteArray(), timeoutMs, retries, delayMs, expect };
+    pending.enqueue(command);
+
+    if (!busy)
+        startNext();
+}
+
+/**
+ * @brief 带原始数据的命令入队
+ * @details 数据在收到'>'提示符后才写入，和普通命令一样排队、超时和重试
+ */
+void AtCommandQueue::enqueueData(const QByteArray &cmd, const QByteArray &data, int timeoutMs,
+                                 int retries, int delayMs, AtResponse::Type expect)
+{
+    Command command = { cmd, data, timeoutMs, retries, delayMs, expect };
+    pending.enqueue(command);
+
+    if (!busy)
+        startNext();
+}
+
+/**
+ * @brief 清空队列并放弃正在等待响应的命令
+ */
+void AtCommandQueue::clear()
+{
+    pending.clear();
+    paceTimer.stop();
+    timeoutTimer.stop();
+    busy = false;
+    waiting = false;
+}
+
+/**
+ * @brief 队列是否空闲
+ */
+bool AtCommandQueue::isIdle() const
+{
+    return !busy && pending.isEmpty();
+}
+
+/**
+ * @brief 处理一条AT响应
+ * @param response 解析器返回的响应
+ * @return 响应被当前命令消费时返回true
+ * @details 只有已发送、正在等待响应的命令才会消费OK/ERROR等结果，
+ *          订阅消息等异步上报的行不会被消费；
+ *          带原始数据的命令在写入数据前收到的OK只表示命令被接受，继续等待提示符
+ */
+bool AtCommandQueue::handleResponse(const AtResponse &response)
+{
+    if (!waiting)
+        return false;
+
+    if (!current.data.isEmpty() && !dataSent) {
+        if (response.type == AtResponse::Ok)
+            return true;
+        if (response.type == AtResponse::Prompt) {
+            device->write(current.data);
+            dataSent = true;
+            return true;
+        }
+    }
+
+    if (response.type == current.expect) {
+        static MetricHistogram *publishLatency = Metrics::histogram("at.publish_rtt_us");
+        static MetricHistogram *commandLatency = Metrics::histogram("at.command_rtt_us");
+
+        timeoutTimer.stop();
+        waiting = false;
+        busy = false;
+
+        QByteArray cmd = current.cmd;
+        qint64 elapsed = roundTrip.elapsed();
+        (cmd.startsWith("AT+MQTTPUB") ? publishLatency : commandLatency)
+                ->record(roundTrip.nsecsElapsed() / 1000);
+        startNext();
+        emit commandSucceeded(cmd, elapsed);
+        return true;
+    }
+
+    if (response.type == AtResponse::Error) {
+        static MetricCounter *errors = Metrics::counter("at.errors");
+        errors->add();
+        timeoutTimer.stop();
+        LOG_WARN() << "命令执行失败:" << current.cmd;
+        retryOrFail();
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief 取出下一条命令，按间隔安排发送
+ */
+void AtCommandQueue::startNext()
+{
+    if (pending.isEmpty())
+        return;
+
+    current = pending.dequeue();
+    busy = true;
+    waiting = false;
+    paceTimer.start(current.delayMs);
+}
+
+/**
+ * @brief 发送当前命令并启动超时定时器
+ * @details 在命令末尾添加回车换行符，并通过串口发送到ESP8266模块
+ */
+void AtCommandQueue::sendCurrent()
+{
+    LOG_DEBUG() << "发送命令:" << current.cmd;
+
+    device->write(current.cmd);
+    device->write("\r\n", 2);
+
+    waiting = true;
+    dataSent = false;
+    roundTrip.start();
+    timeoutTimer.start(current.timeoutMs);
+}
+
+/**
+ * @brief 等待响应超时
+ */
+void AtCommandQueue::commandTimeout()
+{
+    static MetricCounter *timeouts = Metrics::counter("at.timeouts");
+    timeouts->add();
+    LOG_WARN() << "命令响应超时:" << current.cmd;
+    retryOrFail();
+}
+
+/**
+ * @brief 当前命令失败时重试或放弃
+ * @details 还有重试次数时间隔一段时间后重发，否则发出commandFailed并继续处理后续命令
+ */
+void AtCommandQueue::retryOrFail()
+{
+    static MetricCounter *retries = Metrics::counter("at.retries");
+    static MetricCounter *failures = Metrics::counter("at.failures");
+
+    waiting = false;
+
+    if (current.retries > 0) {
+        retries->add();
+        current.retries--;
+        paceTimer.start(qMax<int>(current.delayMs, RetryDelayMs));
+        return;
+    }
+
+    failures->add();
+    busy = false;
+    QByteArray cmd = current.cmd;
+    startNext();
+    emit commandFailed(cmd);
+}
@@ -0,0 +1,132 @@
+/**
+ * @file atcommandqueue.h
+ * @brief AT命令异步发送队列的头文件
+ * @details 用定时器实现命令间隔、超时和重试，替代在槽函数中调用sleep()阻塞事件循环
+ */
+#ifndef ATCOMMANDQUEUE_H
+#define ATCOMMANDQUEUE_H
+
+#include <QObject>
+#include <QQueue>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QIODevice>
+#include "atparser.h"
+
+/**
+ * @class AtCommandQueue
+ * @brief AT命令异步发送队列
+ * @details 命令按入队顺序逐条发送，同一时刻只有一条命令在等待响应：
+ *          - 收到期望的响应(默认OK)视为成功，按下一条命令的间隔发送下一条
+ *          - 收到ERROR/FAIL或超时则按间隔重发，超过重试次数后发出commandFailed
+ *          - 带原始数据的命令(如AT+MQTTPUBRAW)收到'>'提示符后写入数据，再等待期望的响应
+ *          所有等待都由定时器完成，不会阻塞事件循环
+ */
+class AtCommandQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param device 命令写入的设备(串口)
+     * @param parent 父对象指针
+     */
+    AtCommandQueue(QIODevice *device, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数
+     */
+    ~AtCommandQueue();
+
+    /**
+     * @brief 命令入队
+     * @param cmd AT命令(不含回车换行)
+     * @param timeoutMs 等待响应的超时时间，单位ms
+     * @param retries 失败后的重试次数
+     * @param delayMs 发送前与上一条命令之间的间隔，单位ms
+     * @param expect 视为成功的响应类型
+     */
+    void enqueue(const QByteArray &cmd, int timeoutMs = 2000, int retries = 2,
+                 int delayMs = 0, AtResponse::Type expect = AtResponse::Ok);
+
+    /**
+     * @brief 带原始数据的命令入队
+     * @param cmd AT命令(不含回车换行)
+     * @param data 收到'>'提示符后原样写入的数据，不需要转义
+     * @param timeoutMs 从发送命令到收到期望响应的超时时间，单位ms
+     * @param retries 失败后的重试次数，重试时命令和数据一起重发
+     * @param delayMs 发送前与上一条命令之间的间隔，单位ms
+     * @param expect 数据写入后视为成功的响应类型
+     */
+    void enqueueData(const QByteArray &cmd, const QByteArray &data, int timeoutMs = 5000,
+                     int retries = 2, int delayMs = 0,
+                     AtResponse::Type expect = AtResponse::MqttPubOk);
+
+    /**
+     * @brief 清空队列并放弃正在等待响应的命令
+     */
+    void clear();
+
+    /**
+     * @brief 队列是否空闲(没有等待中或待发送的命令)
+     */
+    bool isIdle() const;
+
+    /**
+     * @brief 处理一条AT响应
+     * @param response 解析器返回的响应
+     * @return 响应被当前命令消费时返回true
+     */
+    bool handleResponse(const AtResponse &response);
+
+signals:
+    /**
+     * @brief 命令执行成功
+     * @param cmd AT命令
+     * @param elapsedMs 最后一次发送到收到响应的往返时间，单位ms
+     */
+    void commandSucceeded(const QByteArray &cmd, qint64 elapsedMs);
+
+    /**
+     * @brief 命令重试用尽后仍然失败
+     * @param cmd AT命令
+     */
+    void commandFailed(const QByteArray &cmd);
+
+private slots:
+    void sendCurrent();     ///< 发送当前命令并启动超时定时器
+    void commandTimeout();  ///< 等待响应超时
+
+private:
+    /**
+     * @brief 队列中的一条命令
+     */
+    struct Command {
+        QByteArray cmd;             ///< AT命令
+        QByteArray data;            ///< 提示符后写入的原始数据，为空表示普通命令
+        int timeoutMs;              ///< 超时时间
+        int retries;                ///< 剩余重试次数
+        int delayMs;                ///< 发送前间隔
+        AtResponse::Type expect;    ///< 期望的响应类型
+    };
+
+    enum {
+        RetryDelayMs = 500  ///< 重发前的最小间隔，单位ms
+    };
+
+    void startNext();       ///< 取出下一条命令，按间隔安排发送
+    void retryOrFail();     ///< 当前命令失败时重试或放弃
+
+    QIODevice *device;          ///< 命令写入的设备
+    QQueue<Command> pending;    ///< 待发送的命令
+    Command current;            ///< 正在处理的命令
+    bool busy;                  ///< 是否有命令正在处理(等待发送或等待响应)
+    bool waiting;               ///< 当前命令是否已发送、正在等待响应
+    bool dataSent;              ///< 当前命令的原始数据是否已写入
+    QTimer paceTimer;           ///< 命令间隔定时器
+    QTimer timeoutTimer;        ///< 响应超时定时器
+    QElapsedTimer roundTrip;    ///< 命令往返计时
+};
+
+#endif // ATCOMMANDQUEUE_H
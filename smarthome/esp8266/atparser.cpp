@@ -0,0 +1,284 @@
+/**
+ * @file atparser.cpp
+ * @brief ESP8266 AT响应流式解析器的实现文件
+ */
+#include "atparser.h"
+#include <string.h>
+
+static const char SubRecvPrefix[] = "+MQTTSUBRECV:";
+static const int SubRecvPrefixLength = sizeof(SubRecvPrefix) - 1;
+static const char PubOk[] = "+MQTTPUB:OK";
+static const char PubFail[] = "+MQTTPUB:FAIL";
+
+/**
+ * @brief 判断行内容是否以指定前缀开头
+ */
+bool AtResponse::startsWith(const char *prefix) const
+{
+    int n = (int)strlen(prefix);
+    return n <= length && memcmp(data, prefix, n) == 0;
+}
+
+/**
+ * @brief 判断行内容中是否包含指定字符串
+ * @details 行缓冲区以'\0'结尾，可以直接使用strstr
+ */
+bool AtResponse::contains(const char *needle) const
+{
+    return strstr(data, needle) != nullptr;
+}
+
+/**
+ * @brief AtParser类构造函数
+ */
+AtParser::AtParser()
+    : head(0), tail(0), state(Collecting), overflows(0), dropped(0)
+{
+    clearLine();
+    line[0] = '\0';
+}
+
+/**
+ * @brief 写入串口收到的原始数据
+ * @param data 数据指针
+ * @param length 数据长度
+ * @return 实际写入的字节数
+ */
+int AtParser::feed(const char *data, int length)
+{
+    unsigned int space = RingSize - (head - tail);
+    int n = length < (int)space ? length : (int)space;
+
+    /* 分两段拷贝，处理环形缓冲区回绕 */
+    unsigned int pos = head & (RingSize - 1);
+    int first = RingSize - (int)pos;
+    if (first > n)
+        first = n;
+    memcpy(ring + pos, data, first);
+    memcpy(ring, data + first, n - first);
+    head += n;
+
+    dropped += length - n;
+    return n;
+}
+
+/**
+ * @brief 取出下一条完整的响应
+ * @param response 输出的响应
+ * @return 有完整响应时返回true
+ * @details 逐字节从环形缓冲区取出数据推进行状态机：
+ *          '\r'忽略，'\n'结束一行，空行跳过；行首的'>'提示符不等换行立即返回；
+ *          +MQTTSUBRECV帧解析到长度字段后切换到Payload状态，按长度原样收取数据；
+ *          行长度超过MaxLineLength时切换到Discarding状态，直到下一个'\n'；
+ *          数据超长时切换到PayloadDiscarding状态，按剩余长度丢弃数据后再回到Collecting
+ */
+bool AtParser::next(AtResponse &response)
+{
+    while (tail != head) {
+        char c = ring[tail & (RingSize - 1)];
+        tail++;
+
+        if (state == Payload) {
+            if (lineLength == MaxLineLength) {
+                /* 数据中可能含有换行，按长度丢弃剩余数据，不能等下一个'\n' */
+                state = PayloadDiscarding;
+                overflows++;
+            } else {
+                line[lineLength++] = c;
+                if (--payloadRemaining == 0)
+                    state = Collecting;
+                continue;
+            }
+        }
+
+        if (state == PayloadDiscarding) {
+            if (--payloadRemaining == 0) {
+                /* 帧尾的回车换行是空行，直接跳过 */
+                clearLine();
+                state = Collecting;
+            }
+            continue;
+        }
+
+        if (c == '\n') {
+            if (state == Discarding) {
+                state = Collecting;
+                clearLine();
+                continue;
+            }
+            if (lineLength == 0)
+                continue;
+
+            line[lineLength] = '\0';
+            response.type = classify(line, lineLength);
+            if (response.type == AtResponse::MqttSubRecv && payloadStart < 0)
+                response.type = AtResponse::Other;  /* 帧头不完整或已损坏 */
+            response.data = line;
+            response.length = lineLength;
+            if (response.type == AtResponse::MqttSubRecv && payloadStart >= 0) {
+                response.topic = line + topicStart;
+                response.topicLength = topicEnd - topicStart;
+                response.payload = line + payloadStart;
+                response.payloadLength = lineLength - payloadStart;
+            } else {
+                response.topic = nullptr;
+                response.topicLength = 0;
+                response.payload = nullptr;
+                response.payloadLength = 0;
+            }
+            clearLine();
+            return true;
+        }
+
+        if (c == '\r' || state == Discarding)
+            continue;
+
+        if (c == '>' && lineLength == 0) {
+            /* 提示符后模块等待写入数据，不会再输出换行 */
+            line[0] = '>';
+            line[1] = '\0';
+            response.type = AtResponse::Prompt;
+            response.data = line;
+            response.length = 1;
+            response.topic = nullptr;
+            response.topicLength = 0;
+            response.payload = nullptr;
+            response.payloadLength = 0;
+            return true;
+        }
+
+        if (lineLength == MaxLineLength) {
+            /* 超长行整行丢弃，避免缓冲区无限增长 */
+            state = Discarding;
+            overflows++;
+            continue;
+        }
+        line[lineLength++] = c;
+
+        if (lineLength == SubRecvPrefixLength) {
+            subRecv = memcmp(line, SubRecvPrefix, SubRecvPrefixLength) == 0;
+            fieldStart = lineLength;
+        } else if (subRecv && payloadStart < 0) {
+            subRecvHeaderByte(c);
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 解析+MQTTSUBRECV帧头的一个字节
+ * @param c 刚加入行缓冲区的字节
+ * @details 帧头格式为 <LinkID>,"<topic>",<length>, ，引号内的逗号不作为分隔符；
+ *          遇到第三个逗号时得到数据长度，之后的数据按长度收取；
+ *          长度超过MaxPayloadLength时认为帧头损坏，该行按普通行收集到换行为止
+ */
+void AtParser::subRecvHeaderByte(char c)
+{
+    if (c == '"') {
+        quoted = !quoted;
+        if (commas == 1) {
+            if (quoted)
+                topicStart = lineLength;
+            else
+                topicEnd = lineLength - 1;
+        }
+        return;
+    }
+
+    if (c != ',' || quoted)
+        return;
+
+    commas++;
+    if (commas == 3) {
+        int length = 0;
+        for (int i = fieldStart; i < lineLength - 1 && length <= MaxPayloadLength; i++) {
+            if (line[i] >= '0' && line[i] <= '9')
+                length = length * 10 + (line[i] - '0');
+        }
+        if (length > MaxPayloadLength) {
+            /* 长度字段损坏，不能按长度丢弃数据，否则后续的OK/ERROR都会被吞掉 */
+            subRecv = false;
+            overflows++;
+            return;
+        }
+        payloadStart = lineLength;
+        payloadRemaining = length;
+        if (payloadRemaining > 0)
+            state = Payload;
+    }
+    fieldStart = lineLength;
+}
+
+/**
+ * @brief 开始收集新的一行
+ */
+void AtParser::clearLine()
+{
+    lineLength = 0;
+    subRecv = false;
+    quoted = false;
+    commas = 0;
+    fieldStart = 0;
+    topicStart = 0;
+    topicEnd = 0;
+    payloadStart = -1;
+    payloadRemaining = 0;
+}
+
+/**
+ * @brief 清空缓冲区和解析状态
+ */
+void AtParser::reset()
+{
+    head = tail = 0;
+    state = Collecting;
+    clearLine();
+}
+
+/**
+ * @brief 因超长被丢弃的行数(含长度字段损坏的+MQTTSUBRECV帧)
+ */
+unsigned int AtParser::overflowCount() const
+{
+    return overflows;
+}
+
+/**
+ * @brief 因环形缓冲区满被丢弃的字节数
+ */
+unsigned int AtParser::droppedBytes() const
+{
+    return dropped;
+}
+
+/**
+ * @brief 识别一行的响应类型
+ * @param line 行内容
+ * @param length 行长度
+ * @return 响应类型
+ */
+AtResponse::Type AtParser::classify(const char *line, int length)
+{
+    /*
+     * 订阅消息和回显的内容来自云端或本程序，可能以任意文字结尾，
+     * 必须先识别，不能按下面"ready"等后缀规则误判为模块复位
+     */
+    if (length >= SubRecvPrefixLength && memcmp(line, SubRecvPrefix, SubRecvPrefixLength) == 0)
+        return AtResponse::MqttSubRecv;
+    if (length >= 2 && line[0] == 'A' && line[1] == 'T')
+        return AtResponse::Echo;
+    if (length == 2 && memcmp(line, "OK", 2) == 0)
+        return AtResponse::Ok;
+    if ((length == 5 && memcmp(line, "ERROR", 5) == 0) ||
+        (length == 4 && memcmp(line, "FAIL", 4) == 0) ||
+        (length == (int)sizeof(PubFail) - 1 && memcmp(line, PubFail, length) == 0))
+        return AtResponse::Error;
+    if (length == (int)sizeof(PubOk) - 1 && memcmp(line, PubOk, length) == 0)
+        return AtResponse::MqttPubOk;
+    /* 复位时模块先以74880波特率输出启动信息，"ready"前可能残留乱码 */
+    if (length >= 5 && memcmp(line + length - 5, "ready", 5) == 0)
+        return AtResponse::Ready;
+    if (length == 11 && memcmp(line, "WIFI GOT IP", 11) == 0)
+        return AtResponse::WifiGotIp;
+    return AtResponse::Other;
+}
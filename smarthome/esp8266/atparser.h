@@ -0,0 +1,149 @@
+/**
+ * @file atparser.h
+ * @brief ESP8266 AT响应流式解析器的头文件
+ * @details 以字节为单位、按行分帧解析ESP8266串口返回的数据，解析过程不分配堆内存
+ */
+#ifndef ATPARSER_H
+#define ATPARSER_H
+
+/**
+ * @struct AtResponse
+ * @brief 一条完整的AT响应
+ * @details data、topic、payload都指向解析器内部的行缓冲区，只在下一次调用AtParser::next()之前有效
+ */
+struct AtResponse
+{
+    /**
+     * @brief 响应类型
+     */
+    enum Type {
+        Ok,             ///< "OK"
+        Error,          ///< "ERROR"、"FAIL"或"+MQTTPUB:FAIL"
+        Ready,          ///< 模块复位完成"ready"
+        WifiGotIp,      ///< "WIFI GOT IP"
+        MqttSubRecv,    ///< 订阅消息"+MQTTSUBRECV:..."
+        MqttPubOk,      ///< AT+MQTTPUBRAW数据发布成功"+MQTTPUB:OK"
+        Prompt,         ///< 模块等待原始数据的提示符'>'(后面没有换行)
+        Echo,           ///< 模块回显的AT命令
+        Other           ///< 其它无法识别的行
+    };
+
+    Type type;          ///< 响应类型
+    const char *data;   ///< 行内容(不含回车换行，以'\0'结尾)
+    int length;         ///< 行内容长度
+
+    /* 以下字段只对MqttSubRecv有效，由解析器在分帧时解码 */
+    const char *topic;  ///< 主题(不含引号，不以'\0'结尾)
+    int topicLength;    ///< 主题长度
+    const char *payload;    ///< 消息内容
+    int payloadLength;      ///< 消息内容长度
+
+    /**
+     * @brief 判断行内容是否以指定前缀开头
+     * @param prefix 以'\0'结尾的前缀字符串
+     */
+    bool startsWith(const char *prefix) const;
+
+    /**
+     * @brief 判断行内容中是否包含指定字符串
+     * @param needle 以'\0'结尾的字符串
+     */
+    bool contains(const char *needle) const;
+};
+
+/**
+ * @class AtParser
+ * @brief ESP8266 AT响应流式解析器
+ * @details 串口数据先写入固定大小的环形缓冲区，再由状态机逐字节取出、按"\r\n"分行，
+ *          每识别出一条完整响应就通过next()返回一次，每个字节只被扫描一次。
+ *          超过MaxLineLength仍未遇到换行的行会被整行丢弃，缓冲区占用始终有上限。
+ *          "+MQTTSUBRECV:<LinkID>,\"<topic>\",<length>,<data>"帧按length收取数据，
+ *          数据中包含换行也不会被截断，主题和数据的位置在分帧时一并解码。
+ *          AT+MQTTPUBRAW等命令的'>'提示符后面没有换行，在行首遇到时立即作为Prompt返回。
+ *
+ *          用法：
+ *          @code
+ *          parser.feed(buf, len);
+ *          AtResponse response;
+ *          while (parser.next(response))
+ *              handle(response);
+ *          @endcode
+ */
+class AtParser
+{
+public:
+    enum {
+        RingSize = 2048,        ///< 环形缓冲区大小，必须是2的幂
+        MaxLineLength = 1024,   ///< 单行最大长度
+        MaxPayloadLength = 4 * MaxLineLength    ///< +MQTTSUBRECV数据长度上限，超过时认为帧头损坏
+    };
+
+    AtParser();
+
+    /**
+     * @brief 写入串口收到的原始数据
+     * @param data 数据指针
+     * @param length 数据长度
+     * @return 实际写入的字节数，环形缓冲区满时多余的数据被丢弃
+     */
+    int feed(const char *data, int length);
+
+    /**
+     * @brief 取出下一条完整的响应
+     * @param response 输出的响应
+     * @return 有完整响应时返回true，缓冲区中只剩不完整的行时返回false
+     */
+    bool next(AtResponse &response);
+
+    /**
+     * @brief 清空缓冲区和解析状态(例如模块复位时)
+     */
+    void reset();
+
+    /**
+     * @brief 因超长被丢弃的行数(含长度字段损坏的+MQTTSUBRECV帧)
+     */
+    unsigned int overflowCount() const;
+
+    /**
+     * @brief 因环形缓冲区满被丢弃的字节数
+     */
+    unsigned int droppedBytes() const;
+
+private:
+    /**
+     * @brief 行状态机的状态
+     */
+    enum State {
+        Collecting,         ///< 正在收集一行
+        Payload,            ///< 正在按长度收取+MQTTSUBRECV的数据
+        Discarding,         ///< 当前行超长，丢弃直到换行
+        PayloadDiscarding   ///< +MQTTSUBRECV的数据超长，按剩余长度丢弃
+    };
+
+    static AtResponse::Type classify(const char *line, int length);
+    void subRecvHeaderByte(char c);     ///< 解析+MQTTSUBRECV帧头的一个字节
+    void clearLine();                   ///< 开始收集新的一行
+
+    char ring[RingSize];        ///< 环形缓冲区
+    unsigned int head;          ///< 写入位置(自由增长，取模使用)
+    unsigned int tail;          ///< 读取位置(自由增长，取模使用)
+
+    char line[MaxLineLength + 1];   ///< 当前行缓冲区
+    int lineLength;                 ///< 当前行已收集的长度
+    State state;                    ///< 行状态机当前状态
+
+    bool subRecv;               ///< 当前行是否为+MQTTSUBRECV帧
+    bool quoted;                ///< 帧头解析是否处于引号内
+    int commas;                 ///< 帧头中引号外的逗号个数
+    int fieldStart;             ///< 当前帧头字段的起始位置
+    int topicStart;             ///< 主题起始位置
+    int topicEnd;               ///< 主题结束位置
+    int payloadStart;           ///< 数据起始位置
+    int payloadRemaining;       ///< 数据剩余待收取的字节数
+
+    unsigned int overflows;     ///< 超长行和长度损坏的帧计数
+    unsigned int dropped;       ///< 丢弃字节计数
+};
+
+#endif // ATPARSER_H
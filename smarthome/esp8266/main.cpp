@@ -1,10 +1,13 @@
 #include "Esp8266.h"
+#include "../log/log.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    /* 未迁移到日志模块的qDebug()输出也走异步日志 */
+    Logger::installQtMessageHandler();
     Esp8266 w;
     Q_UNUSED(w);
     return a.exec();
@@ -0,0 +1,259 @@
+/**
+ * @file outbox.cpp
+ * @brief 上传数据离线发件箱的实现文件
+ */
+#include "outbox.h"
+#include "../log/log.h"
+#include <QFile>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+static const quint32 OutboxMagic = 0x3158424F;     // "OBX1"
+static const quint32 OutboxVersion = 1;
+
+enum {
+    FlagDht11 = 0x01,   ///< 记录包含温湿度
+    FlagPpm = 0x02      ///< 记录包含气体浓度
+};
+
+/**
+ * @brief 文件头
+ * @details head、tail为自由增长的序号，槽位为序号对容量取模，
+ *          tail到head之间为待上传的记录
+ */
+struct Outbox::FileHeader
+{
+    quint32 magic;          ///< 文件标识
+    quint32 version;        ///< 格式版本
+    quint32 capacity;       ///< 记录槽数
+    quint32 reserved;
+    quint64 head;           ///< 下一条记录的序号
+    quint64 tail;           ///< 最旧的未确认记录的序号
+};
+
+/**
+ * @brief 记录槽，固定32字节
+ */
+struct Outbox::Slot
+{
+    quint32 seq;            ///< 记录序号的低32位加1，用于识别过期或未写完的槽
+    quint16 checksum;       ///< 记录内容的CRC16
+    quint16 flags;          ///< 记录包含的字段
+    qint64 timestamp;       ///< 上传周期结束时间，单位ms
+    qint16 humidity;        ///< 湿度
+    qint16 temperature;     ///< 温度
+    quint32 reserved;
+    float ppm;              ///< 气体浓度
+    float ppmMax;           ///< 周期内气体浓度最大值
+};
+
+/**
+ * @brief 计算记录内容的校验和(不含seq和checksum字段)
+ */
+static quint16 slotChecksum(const void *slot, size_t size)
+{
+    const size_t skip = sizeof(quint32) + sizeof(quint16);
+    return qChecksum(static_cast<const char *>(slot) + skip, (uint)(size - skip));
+}
+
+/**
+ * @brief Outbox类构造函数
+ */
+Outbox::Outbox()
+    : fd(-1), map(nullptr), mapSize(0), header(nullptr), dropped(0)
+{
+}
+
+/**
+ * @brief Outbox类析构函数
+ */
+Outbox::~Outbox()
+{
+    if (map) {
+        msync(map, mapSize, MS_SYNC);
+        munmap(map, mapSize);
+    }
+    if (fd >= 0)
+        close(fd);
+}
+
+/**
+ * @brief 打开(必要时创建)发件箱文件
+ * @details 文件头不合法时重新初始化；文件无法打开时使用匿名映射，功能相同但不能跨重启保存
+ */
+bool Outbox::open(const QString &path, int capacity)
+{
+    QByteArray name = QFile::encodeName(path);
+    fd = ::open(name.constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    FileHeader existing;
+    struct stat st;
+    bool valid = fd >= 0 && fstat(fd, &st) == 0 &&
+                 pread(fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing) &&
+                 existing.magic == OutboxMagic && existing.version == OutboxVersion &&
+                 existing.capacity > 0 && existing.tail <= existing.head &&
+                 existing.head - existing.tail <= existing.capacity &&
+                 (size_t)st.st_size == sizeof(FileHeader) + existing.capacity * sizeof(Slot);
+    if (valid)
+        capacity = existing.capacity;
+    mapSize = sizeof(FileHeader) + capacity * sizeof(Slot);
+
+    if (fd >= 0 && !valid && (ftruncate(fd, 0) != 0 || ftruncate(fd, mapSize) != 0)) {
+        close(fd);
+        fd = -1;
+    }
+
+    void *addr = MAP_FAILED;
+    if (fd >= 0)
+        addr = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        LOG_WARN() << "发件箱文件" << path << "无法打开，数据只保存在内存中:" << strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+        valid = false;
+        addr = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED)
+            return false;
+    }
+
+    map = static_cast<char *>(addr);
+    header = reinterpret_cast<FileHeader *>(map);
+    if (!valid) {
+        header->magic = OutboxMagic;
+        header->version = OutboxVersion;
+        header->capacity = capacity;
+        header->reserved = 0;
+        header->head = 0;
+        header->tail = 0;
+        sync();
+    } else if (size() > 0) {
+        LOG_INFO() << "发件箱中有" << size() << "条数据待上传";
+    }
+    return fd >= 0;
+}
+
+/**
+ * @brief 写入一条记录
+ * @details 先写记录槽，再推进head；发件箱满时先推进tail丢弃最旧的记录
+ */
+void Outbox::push(const OutboxRecord &record)
+{
+    if (!header)
+        return;
+
+    if (header->head - header->tail >= header->capacity) {
+        header->tail++;
+        dropped++;
+    }
+
+    Slot *s = slot(header->head);
+    s->seq = 0;
+    s->flags = (record.hasDht11 ? FlagDht11 : 0) | (record.hasPpm ? FlagPpm : 0);
+    s->timestamp = record.timestamp;
+    s->humidity = record.humidity;
+    s->temperature = record.temperature;
+    s->reserved = 0;
+    s->ppm = record.ppm;
+    s->ppmMax = record.ppmMax;
+    s->checksum = slotChecksum(s, sizeof(Slot));
+    s->seq = (quint32)header->head + 1;
+
+    header->head++;
+    sync();
+}
+
+/**
+ * @brief 读取第index条最旧的记录
+ */
+bool Outbox::peek(int index, OutboxRecord &record) const
+{
+    if (!header || index < 0 || index >= size())
+        return false;
+
+    quint64 seq = header->tail + index;
+    const Slot *s = slot(seq);
+    if (s->seq != (quint32)seq + 1 || s->checksum != slotChecksum(s, sizeof(Slot)))
+        return false;
+
+    record.timestamp = s->timestamp;
+    record.hasDht11 = s->flags & FlagDht11;
+    record.humidity = s->humidity;
+    record.temperature = s->temperature;
+    record.hasPpm = s->flags & FlagPpm;
+    record.ppm = s->ppm;
+    record.ppmMax = s->ppmMax;
+    return true;
+}
+
+/**
+ * @brief 确认最旧的count条记录已上传
+ */
+void Outbox::pop(int count)
+{
+    if (!header || count <= 0)
+        return;
+
+    header->tail += qMin<quint64>(count, header->head - header->tail);
+    sync();
+}
+
+/**
+ * @brief 删除序号小于seq的记录
+ * @details 这些记录已经因发件箱满被丢弃时不做任何事，seq不超过最新记录
+ */
+void Outbox::popUntil(quint64 seq)
+{
+    if (!header || seq <= header->tail)
+        return;
+
+    header->tail = qMin<quint64>(seq, header->head);
+    sync();
+}
+
+/**
+ * @brief 最旧记录的序号
+ */
+quint64 Outbox::firstSeq() const
+{
+    return header ? header->tail : 0;
+}
+
+/**
+ * @brief 待上传的记录数
+ */
+int Outbox::size() const
+{
+    return header ? (int)(header->head - header->tail) : 0;
+}
+
+/**
+ * @brief 因发件箱满被丢弃的记录数
+ */
+quint64 Outbox::droppedCount() const
+{
+    return dropped;
+}
+
+/**
+ * @brief 序号对应的记录槽
+ */
+Outbox::Slot *Outbox::slot(quint64 seq) const
+{
+    return reinterpret_cast<Slot *>(map + sizeof(FileHeader)) + seq % header->capacity;
+}
+
+/**
+ * @brief 异步同步到存储器
+ * @details 只提交写回请求，不等待完成；每个上传周期最多一两次，不会频繁写flash
+ */
+void Outbox::sync()
+{
+    if (fd >= 0)
+        msync(map, mapSize, MS_ASYNC);
+}
@@ -0,0 +1,112 @@
+/**
+ * @file outbox.h
+ * @brief 上传数据离线发件箱的头文件
+ * @details WiFi或MQTT断开时保存待上传的数据，连接恢复后按顺序补发
+ */
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <QString>
+
+/**
+ * @struct OutboxRecord
+ * @brief 一条待上传的数据
+ */
+struct OutboxRecord
+{
+    qint64 timestamp = 0;       ///< 数据所属上传周期的结束时间，自1970-01-01起的毫秒数
+    bool hasDht11 = false;      ///< 是否包含温湿度
+    int humidity = 0;           ///< 湿度，单位%RH
+    int temperature = 0;        ///< 温度，单位℃
+    bool hasPpm = false;        ///< 是否包含气体浓度
+    float ppm = 0;              ///< 气体浓度
+    float ppmMax = 0;           ///< 周期内气体浓度最大值
+};
+
+/**
+ * @class Outbox
+ * @brief 上传数据离线发件箱
+ * @details 以内存映射的环形文件保存固定条数的记录，先进先出：
+ *          push()写入新记录，发布成功(收到OK)后pop()确认；
+ *          发件箱满时覆盖最旧的记录，占用的存储空间固定。
+ *          每条记录带有序号和校验和，掉电后写了一半的记录在读取时被跳过
+ */
+class Outbox
+{
+public:
+    /**
+     * @brief 构造函数
+     */
+    Outbox();
+
+    /**
+     * @brief 析构函数
+     */
+    ~Outbox();
+
+    /**
+     * @brief 打开(必要时创建)发件箱文件
+     * @param path 文件路径
+     * @param capacity 最多保存的记录数(只在创建文件时使用)
+     * @return 打开成功返回true，失败时改用内存中的发件箱(重启后数据丢失)
+     */
+    bool open(const QString &path, int capacity);
+
+    /**
+     * @brief 写入一条记录，发件箱满时丢弃最旧的记录
+     */
+    void push(const OutboxRecord &record);
+
+    /**
+     * @brief 读取第index条最旧的记录
+     * @param index 从0开始，0为最旧的记录
+     * @param record 输出的记录
+     * @return 记录有效返回true，记录损坏(掉电时写了一半)返回false
+     */
+    bool peek(int index, OutboxRecord &record) const;
+
+    /**
+     * @brief 确认最旧的count条记录已上传，从发件箱中删除
+     */
+    void pop(int count);
+
+    /**
+     * @brief 删除序号小于seq的记录
+     * @param seq 记录序号，见firstSeq()
+     * @details 发布期间发件箱满时push()会丢弃最旧的记录，按发布时的序号确认，
+     *          不会把发布之后才写入、尚未发布的记录当作已上传删除
+     */
+    void popUntil(quint64 seq);
+
+    /**
+     * @brief 最旧记录的序号，每写入一条记录序号加1
+     */
+    quint64 firstSeq() const;
+
+    /**
+     * @brief 待上传的记录数
+     */
+    int size() const;
+
+    /**
+     * @brief 因发件箱满被丢弃的记录数
+     */
+    quint64 droppedCount() const;
+
+private:
+    Q_DISABLE_COPY(Outbox)
+
+    struct FileHeader;
+    struct Slot;
+
+    Slot *slot(quint64 seq) const;      ///< 序号对应的记录槽
+    void sync();                        ///< 异步同步到存储器
+
+    int fd;                 ///< 文件描述符
+    char *map;              ///< 文件映射地址
+    size_t mapSize;         ///< 映射长度
+    FileHeader *header;     ///< 文件头
+    quint64 dropped;        ///< 丢弃的记录数
+};
+
+#endif // OUTBOX_H
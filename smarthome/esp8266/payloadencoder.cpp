@@ -0,0 +1,107 @@
+/**
+ * @file payloadencoder.cpp
+ * @brief 上传数据编码函数的实现文件
+ */
+#include "payloadencoder.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+
+/**
+ * @brief 把一条待上传数据编码为AT+MQTTPUB可用的JSON字符串
+ * @param record 待上传数据
+ * @return 逗号和双引号已转义的JSON字符串
+ */
+QString encodeRecord(const OutboxRecord &record)
+{
+    /* 创建JSON对象并添加传感器数据 */
+    QJsonObject jsonObj;
+    jsonObj.insert("ts", record.timestamp);
+    if (record.hasDht11) {
+        jsonObj.insert("humidity", record.humidity);
+        jsonObj.insert("temperature", record.temperature);
+    }
+    if (record.hasPpm) {
+        jsonObj.insert("ppm", record.ppm);
+        jsonObj.insert("ppmmax", record.ppmMax);
+    }
+
+    /* 将JSON对象转换为紧凑格式的JSON字符串 */
+    QJsonDocument jsonDoc(jsonObj);
+    QByteArray jsonData = jsonDoc.toJson(QJsonDocument::Compact);
+
+    /* 将JSON字符串中的特殊字符进行转义处理 */
+    return escapeAtString(jsonData);
+}
+
+/**
+ * @brief 转义AT命令字符串参数中的逗号和双引号
+ * @param data 原始数据
+ * @return 可以放在AT命令双引号中的字符串
+ */
+QString escapeAtString(const QByteArray &data)
+{
+    QString escaped = QString::fromUtf8(data);
+    escaped.replace(",", "\\,");
+    escaped.replace("\"", "\\\"");
+    return escaped;
+}
+
+/**
+ * @brief 追加一个JSON整数，没有数据时写null
+ */
+static void appendNumber(QByteArray &out, bool has, int value)
+{
+    if (has)
+        out += QByteArray::number(value);
+    else
+        out += "null";
+}
+
+/**
+ * @brief 追加一个保留两位小数的JSON数值，没有数据时写null
+ */
+static void appendNumber(QByteArray &out, bool has, float value)
+{
+    if (has)
+        out += QByteArray::number(value, 'f', 2);
+    else
+        out += "null";
+}
+
+/**
+ * @brief 把多条待上传数据编码为批量格式，供AT+MQTTPUBRAW原样发送
+ * @param records 按时间顺序排列的待上传数据
+ * @return 不需要转义的JSON数据
+ * @details 格式为 {"v":2,"t0":<第一条的时间>,"d":[[dt,温度,湿度,ppm,ppm最大值],...]}，
+ *          dt为与上一条数据的时间差(ms)，第一条为0；温湿度为整数，ppm保留两位小数，没有的数据写null。
+ *          每条数据约27字节(如[5000,25,60,123.45,130.20],)，v1格式每条约80字节且需要转义
+ */
+QByteArray encodeBatch(const QVector<OutboxRecord> &records)
+{
+    QByteArray out;
+    out.reserve(32 + records.size() * 32);
+    out += "{\"v\":2,\"t0\":";
+    out += QByteArray::number(records.first().timestamp);
+    out += ",\"d\":[";
+
+    qint64 previous = records.first().timestamp;
+    for (int i = 0; i < records.size(); i++) {
+        const OutboxRecord &record = records[i];
+        if (i > 0)
+            out += ',';
+        out += '[';
+        out += QByteArray::number(record.timestamp - previous);
+        out += ',';
+        appendNumber(out, record.hasDht11, record.temperature);
+        out += ',';
+        appendNumber(out, record.hasDht11, record.humidity);
+        out += ',';
+        appendNumber(out, record.hasPpm, record.ppm);
+        out += ',';
+        appendNumber(out, record.hasPpm, record.ppmMax);
+        out += ']';
+        previous = record.timestamp;
+    }
+    out += "]}";
+    return out;
+}
@@ -0,0 +1,35 @@
+/**
+ * @file payloadencoder.h
+ * @brief 上传数据编码函数的头文件
+ * @details v1为单条数据的转义JSON(AT+MQTTPUB)，v2为多条数据的批量格式(AT+MQTTPUBRAW)
+ */
+#ifndef PAYLOADENCODER_H
+#define PAYLOADENCODER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include "outbox.h"
+
+/**
+ * @brief 把一条待上传数据编码为AT+MQTTPUB可用的JSON字符串
+ * @param record 待上传数据
+ * @return 逗号和双引号已转义的JSON字符串
+ */
+QString encodeRecord(const OutboxRecord &record);
+
+/**
+ * @brief 转义AT命令字符串参数中的逗号和双引号
+ * @param data 原始数据
+ * @return 可以放在AT命令双引号中的字符串
+ */
+QString escapeAtString(const QByteArray &data);
+
+/**
+ * @brief 把多条待上传数据编码为批量格式，供AT+MQTTPUBRAW原样发送
+ * @param records 按时间顺序排列的待上传数据，不能为空
+ * @return 不需要转义的JSON数据
+ */
+QByteArray encodeBatch(const QVector<OutboxRecord> &records);
+
+#endif // PAYLOADENCODER_H
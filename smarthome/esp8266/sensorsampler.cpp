@@ -0,0 +1,210 @@
+/**
+ * @file sensorsampler.cpp
+ * @brief 多传感器采样调度类的实现文件
+ */
+#include "sensorsampler.h"
+#include "../metrics/metrics.h"
+#include "../log/log.h"
+#include <QDateTime>
+
+/**
+ * @brief SensorWorker类构造函数
+ * @param sensor 传感器类型
+ * @param id 设备标识
+ * @param read 读取函数
+ */
+SensorWorker::SensorWorker(SensorSample::Sensor sensor, const QString &id, ReadFunction read)
+    : sensor(sensor), id(id), read(read)
+{
+}
+
+/**
+ * @brief 读取一次传感器
+ * @param seq 请求序号
+ */
+void SensorWorker::readOnce(quint32 seq)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    SensorSample result;
+    result.sensor = sensor;
+    result.device = id;
+    result.timestamp = QDateTime::currentMSecsSinceEpoch();
+    read(result);
+    result.elapsedMs = timer.elapsed();
+
+    emit finished(seq, result);
+}
+
+/**
+ * @brief SensorSampler类构造函数
+ * @param parent 父对象指针
+ */
+SensorSampler::SensorSampler(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<SensorSample>("SensorSample");
+}
+
+/**
+ * @brief SensorSampler类析构函数
+ */
+SensorSampler::~SensorSampler()
+{
+    shutdown();
+}
+
+/**
+ * @brief 停止采样并退出所有I/O线程
+ * @details sysfs读取无法设置超时，线程正常情况下在一次读取结束后很快退出；
+ *          驱动挂死导致线程阻塞在pread中无法退出时记录日志并放弃该线程：
+ *          QThread::terminate()可能在线程持有锁或正在分配内存时结束它，之后整个进程都不可靠，
+ *          程序即将退出，泄漏一个线程的代价更小
+ */
+bool SensorSampler::shutdown()
+{
+    stop();
+
+    bool clean = true;
+    for (int i = 0; i < entries.size(); i++) {
+        QThread *thread = entries[i].thread;
+        if (!thread)
+            continue;
+        entries[i].thread = nullptr;
+
+        thread->quit();
+        if (thread->wait(entries[i].timeoutMs + ShutdownGraceMs)) {
+            delete thread;
+        } else {
+            LOG_ERROR() << "传感器I/O线程阻塞在驱动中无法退出，放弃该线程:" << entries[i].id;
+            clean = false;
+        }
+    }
+    return clean;
+}
+
+/**
+ * @brief 注册一个传感器
+ * @details 为传感器创建专用的I/O线程和读取对象，读取对象和设备对象在线程结束时释放
+ */
+void SensorSampler::addSensor(SensorSample::Sensor sensor, const QString &id, int periodMs, int timeoutMs,
+                              ReadFunction read, QObject *device)
+{
+    int index = entries.size();
+
+    Entry entry;
+    entry.sensor = sensor;
+    entry.id = id;
+    entry.periodMs = periodMs;
+    entry.timeoutMs = timeoutMs;
+    entry.thread = new QThread();
+    entry.worker = new SensorWorker(sensor, id, read);
+    entry.timer = new QTimer(this);
+    entry.watchdog = new QTimer(this);
+    entry.inFlight = false;
+    entry.seq = 0;
+
+    entry.worker->moveToThread(entry.thread);
+    connect(entry.thread, &QThread::finished, entry.worker, &QObject::deleteLater);
+    if (device) {
+        device->moveToThread(entry.thread);
+        connect(entry.thread, &QThread::finished, device, &QObject::deleteLater);
+    }
+
+    /* 读取结果通过排队连接回到主线程 */
+    connect(entry.worker, &SensorWorker::finished, this,
+            [this, index](quint32 seq, const SensorSample &sample) {
+        workerFinished(index, seq, sample);
+    });
+
+    entry.watchdog->setSingleShot(true);
+    connect(entry.watchdog, &QTimer::timeout, this, [this, index]() {
+        readTimeout(index);
+    });
+    connect(entry.timer, &QTimer::timeout, this, [this, index]() {
+        request(index);
+    });
+
+    entries.append(entry);
+}
+
+/**
+ * @brief 启动所有传感器的I/O线程和采样定时器
+ * @details 启动时先对每个传感器采样一次，避免第一个上传周期没有数据
+ */
+void SensorSampler::start()
+{
+    for (int i = 0; i < entries.size(); i++) {
+        if (!entries[i].thread->isRunning())
+            entries[i].thread->start();
+        entries[i].timer->start(entries[i].periodMs);
+        request(i);
+    }
+}
+
+/**
+ * @brief 停止所有传感器的采样定时器
+ */
+void SensorSampler::stop()
+{
+    for (int i = 0; i < entries.size(); i++) {
+        entries[i].timer->stop();
+        entries[i].watchdog->stop();
+    }
+}
+
+/**
+ * @brief 对一个传感器发出读取请求
+ * @param index 传感器序号
+ * @details 上一次读取尚未返回(驱动仍阻塞在读取中)时跳过本次请求，
+ *          避免请求在I/O线程中堆积
+ */
+void SensorSampler::request(int index)
+{
+    Entry &entry = entries[index];
+    if (entry.inFlight)
+        return;
+
+    entry.inFlight = true;
+    entry.seq++;
+    entry.watchdog->start(entry.timeoutMs);
+    QMetaObject::invokeMethod(entry.worker, "readOnce", Qt::QueuedConnection,
+                              Q_ARG(quint32, entry.seq));
+}
+
+/**
+ * @brief 读取完成
+ * @param index 传感器序号
+ * @param seq 请求序号
+ * @param sample 采样结果
+ * @details 超时后才返回的结果已经过时，只清除读取中标志，不再发出
+ */
+void SensorSampler::workerFinished(int index, quint32 seq, const SensorSample &sample)
+{
+    Entry &entry = entries[index];
+    entry.inFlight = false;
+
+    if (seq != entry.seq || !entry.watchdog->isActive()) {
+        static MetricCounter *late = Metrics::counter("sensor.late_results");
+        late->add();
+        LOG_LIMITED(LogWarn, 60000) << "丢弃超时的传感器读取结果:" << entry.id << sample.elapsedMs << "ms";
+        return;
+    }
+    entry.watchdog->stop();
+
+    emit sampled(sample);
+}
+
+/**
+ * @brief 读取超时
+ * @param index 传感器序号
+ * @details I/O线程仍阻塞在读取中，读取中标志保持不变，直到驱动返回后才会发出新的请求
+ */
+void SensorSampler::readTimeout(int index)
+{
+    static MetricCounter *timeouts = Metrics::counter("sensor.timeouts");
+    timeouts->add();
+    LOG_LIMITED(LogWarn, 60000) << "传感器读取超时:" << entries[index].id;
+    emit sampleTimedOut(entries[index].sensor, entries[index].id);
+}
@@ -0,0 +1,164 @@
+/**
+ * @file sensorsampler.h
+ * @brief 多传感器采样调度类的头文件
+ * @details 每个传感器按各自的周期在独立的I/O线程中采样，结果通过排队信号交给上传逻辑
+ */
+#ifndef SENSORSAMPLER_H
+#define SENSORSAMPLER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include <functional>
+#include "../device/sensorsample.h"
+
+/**
+ * @class SensorWorker
+ * @brief 单个传感器的读取对象
+ * @details 运行在该传感器专用的I/O线程中，收到读取请求后调用读取函数并返回结果
+ */
+class SensorWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 读取函数，填充采样结果的数据字段和valid标志
+     */
+    typedef std::function<void(SensorSample &)> ReadFunction;
+
+    /**
+     * @brief 构造函数
+     * @param sensor 传感器类型
+     * @param id 设备标识，填入每个采样结果
+     * @param read 读取函数
+     */
+    SensorWorker(SensorSample::Sensor sensor, const QString &id, ReadFunction read);
+
+public slots:
+    /**
+     * @brief 读取一次传感器(在I/O线程中执行，可能阻塞)
+     * @param seq 请求序号
+     */
+    void readOnce(quint32 seq);
+
+signals:
+    /**
+     * @brief 读取完成
+     * @param seq 请求序号
+     * @param sample 采样结果
+     */
+    void finished(quint32 seq, const SensorSample &sample);
+
+private:
+    SensorSample::Sensor sensor;    ///< 传感器类型
+    QString id;                     ///< 设备标识
+    ReadFunction read;              ///< 读取函数
+};
+
+/**
+ * @class SensorSampler
+ * @brief 多传感器采样调度类
+ * @details 通过addSensor()为每个传感器注册采样周期、超时时间和读取函数。
+ *          调度对象运行在主线程，只负责定时发出读取请求；
+ *          每个传感器的读取在各自的I/O线程中进行，DHT11的慢速读取不会阻塞串口和MQTT命令处理，
+ *          也不会拖慢其它传感器。
+ *          同一传感器上一次读取尚未返回时不会再发出新的请求；
+ *          超过超时时间仍未返回则发出sampleTimedOut，之后迟到的结果被丢弃
+ */
+class SensorSampler : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef SensorWorker::ReadFunction ReadFunction;
+
+    enum {
+        ShutdownGraceMs = 1000      ///< 退出时在读取超时时间之外额外等待I/O线程的时间
+    };
+
+    /**
+     * @brief 构造函数
+     * @param parent 父对象指针
+     */
+    SensorSampler(QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，停止所有I/O线程
+     */
+    ~SensorSampler();
+
+    /**
+     * @brief 停止采样并退出所有I/O线程
+     * @return 所有线程都已退出返回true；有线程仍阻塞在驱动中时返回false，
+     *         此时该线程和其中的读取对象不会被释放，读取函数使用的对象也不能释放
+     * @details 每个线程最多等待读取超时时间再加ShutdownGraceMs，不强制结束线程；
+     *          可以重复调用
+     */
+    bool shutdown();
+
+    /**
+     * @brief 注册一个传感器，必须在start()之前调用
+     * @param sensor 传感器类型
+     * @param id 设备标识，对应设备配置中的id，同一类型可以有多个传感器
+     * @param periodMs 采样周期，单位ms
+     * @param timeoutMs 读取超时时间，单位ms
+     * @param read 读取函数，在该传感器的I/O线程中调用
+     * @param device 读取函数使用的设备对象，会被移动到I/O线程并在线程结束时释放，可以为空
+     */
+    void addSensor(SensorSample::Sensor sensor, const QString &id, int periodMs, int timeoutMs,
+                   ReadFunction read, QObject *device = nullptr);
+
+public slots:
+    /**
+     * @brief 启动所有传感器的I/O线程和采样定时器
+     */
+    void start();
+
+    /**
+     * @brief 停止所有传感器的采样定时器
+     */
+    void stop();
+
+signals:
+    /**
+     * @brief 完成一次采样
+     * @param sample 采样结果
+     */
+    void sampled(const SensorSample &sample);
+
+    /**
+     * @brief 传感器读取超时
+     * @param sensor 传感器类型
+     * @param id 设备标识
+     */
+    void sampleTimedOut(int sensor, const QString &id);
+
+private:
+    /**
+     * @brief 已注册的传感器
+     */
+    struct Entry {
+        SensorSample::Sensor sensor;    ///< 传感器类型
+        QString id;                     ///< 设备标识
+        int periodMs;                   ///< 采样周期
+        int timeoutMs;                  ///< 读取超时时间
+        QThread *thread;                ///< I/O线程
+        SensorWorker *worker;           ///< 运行在I/O线程中的读取对象
+        QTimer *timer;                  ///< 采样定时器
+        QTimer *watchdog;               ///< 读取超时定时器
+        bool inFlight;                  ///< 是否有读取请求尚未返回
+        quint32 seq;                    ///< 最近一次请求的序号
+    };
+
+    void request(int index);                                        ///< 对一个传感器发出读取请求
+    void workerFinished(int index, quint32 seq, const SensorSample &sample);   ///< 读取完成
+    void readTimeout(int index);                                    ///< 读取超时
+
+    QList<Entry> entries;               ///< 已注册的传感器
+};
+
+#endif // SENSORSAMPLER_H
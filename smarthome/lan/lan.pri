@@ -0,0 +1,7 @@
+QT += mqtt
+
+SOURCES += \
+    ../lan/lanlink.cpp
+
+HEADERS += \
+    ../lan/lanlink.h
@@ -0,0 +1,95 @@
+/**
+ * @file lanlink.cpp
+ * @brief 局域网MQTT链路类的实现文件
+ */
+#include "lanlink.h"
+
+const char LanLink::CommandTopic[] = "smarthome/k25r9vo1EmV/esp8266/command";
+const char LanLink::ShadowTopic[] = "smarthome/k25r9vo1EmV/esp8266/shadow";
+
+/**
+ * @brief LanLink类构造函数
+ * @details 地址为空时不创建连接，isConnected()始终返回false
+ */
+LanLink::LanLink(const QString &broker, const QString &clientId, QObject *parent)
+    : QObject(parent)
+{
+    client = new QMqttClient(this);
+    client->setClientId(clientId);
+
+    QString host = broker.section(':', 0, 0);
+    int port = broker.section(':', 1, 1).toInt();
+    client->setHostname(host);
+    client->setPort(port > 0 ? port : (int)DefaultPort);
+
+    connect(client, &QMqttClient::connected, this, &LanLink::clientConnected);
+    connect(client, &QMqttClient::stateChanged, this, [this](QMqttClient::ClientState state) {
+        if (state == QMqttClient::Disconnected)
+            retrytimer.start(ReconnectMs);
+    });
+    connect(client, &QMqttClient::messageReceived, this, &LanLink::messageReceived);
+
+    retrytimer.setSingleShot(true);
+    connect(&retrytimer, &QTimer::timeout, this, &LanLink::reconnect);
+
+    if (!host.isEmpty())
+        reconnect();
+}
+
+/**
+ * @brief 局域网服务器地址
+ */
+QString LanLink::defaultBroker(const QString &fallback)
+{
+    if (!qEnvironmentVariableIsSet("SMARTHOME_LAN_BROKER"))
+        return fallback;
+    return QString::fromLocal8Bit(qgetenv("SMARTHOME_LAN_BROKER"));
+}
+
+/**
+ * @brief 订阅主题
+ */
+void LanLink::subscribe(const QString &topic)
+{
+    topics.append(topic);
+    if (isConnected())
+        client->subscribe(QMqttTopicFilter(topic));
+}
+
+/**
+ * @brief 是否已连接到局域网服务器
+ */
+bool LanLink::isConnected() const
+{
+    return client->state() == QMqttClient::Connected;
+}
+
+/**
+ * @brief 发布消息
+ */
+bool LanLink::publish(const QString &topic, const QByteArray &payload)
+{
+    if (!isConnected())
+        return false;
+    return client->publish(QMqttTopicName(topic), payload) >= 0;
+}
+
+/**
+ * @brief 连接成功后订阅主题
+ */
+void LanLink::clientConnected()
+{
+    for (const QString &topic : topics)
+        client->subscribe(QMqttTopicFilter(topic));
+    emit connected();
+}
+
+/**
+ * @brief 尝试连接服务器
+ * @details 服务器不可达或连接断开时客户端回到Disconnected状态，由定时器稍后重试
+ */
+void LanLink::reconnect()
+{
+    if (client->state() == QMqttClient::Disconnected)
+        client->connectToHost();
+}
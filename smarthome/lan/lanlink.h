@@ -0,0 +1,86 @@
+/**
+ * @file lanlink.h
+ * @brief 局域网MQTT链路类的头文件
+ * @details 面板和开发板在同一局域网时，通过局域网内的MQTT服务器(例如开发板上的mosquitto)
+ *          直接交换控制命令和设备影子，不经过云平台
+ */
+#ifndef LANLINK_H
+#define LANLINK_H
+
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QtMqtt/qmqttclient.h>
+
+/**
+ * @class LanLink
+ * @brief 局域网MQTT链路类
+ * @details 连接断开或服务器不可达时每ReconnectMs重试一次，连接成功后重新订阅所有主题。
+ *          局域网消息使用QoS 0，丢失的命令由发送方的确认超时兜底，改走云端
+ */
+class LanLink : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum {
+        DefaultPort = 1883,     ///< 服务器地址没有端口时使用的端口
+        ReconnectMs = 5000      ///< 重连间隔，单位ms
+    };
+
+    static const char CommandTopic[];   ///< 面板发给开发板的控制命令主题
+    static const char ShadowTopic[];    ///< 开发板发布设备影子(含命令确认)的主题
+
+    /**
+     * @brief 构造函数
+     * @param broker 服务器地址"主机[:端口]"，为空时不连接
+     * @param clientId 客户端ID，同一服务器上不能重复
+     * @param parent 父对象指针
+     */
+    LanLink(const QString &broker, const QString &clientId, QObject *parent = nullptr);
+
+    /**
+     * @brief 局域网服务器地址
+     * @param fallback 环境变量未设置时使用的地址
+     * @return 环境变量SMARTHOME_LAN_BROKER设置时为其值(可以设为空以关闭局域网链路)，否则为fallback
+     */
+    static QString defaultBroker(const QString &fallback);
+
+    /**
+     * @brief 订阅主题，连接成功(包括重连)后生效
+     */
+    void subscribe(const QString &topic);
+
+    /**
+     * @brief 是否已连接到局域网服务器
+     */
+    bool isConnected() const;
+
+    /**
+     * @brief 发布消息
+     * @return 未连接时返回false，调用方改走云端
+     */
+    bool publish(const QString &topic, const QByteArray &payload);
+
+signals:
+    /**
+     * @brief 连接成功
+     */
+    void connected();
+
+    /**
+     * @brief 收到订阅主题的消息，参数与QMqttClient::messageReceived相同
+     */
+    void messageReceived(const QByteArray &message, const QMqttTopicName &topic);
+
+private slots:
+    void clientConnected();     ///< 连接成功后订阅主题
+    void reconnect();           ///< 尝试连接服务器
+
+private:
+    QMqttClient *client;        ///< MQTT客户端
+    QStringList topics;         ///< 订阅的主题
+    QTimer retrytimer;          ///< 重连定时器
+};
+
+#endif // LANLINK_H
@@ -3,23 +3,27 @@
  * @brief LED控制类的实现文件
  */
 #include "led.h"
-#include <QDebug>
+#include "../metrics/metrics.h"
+#include "../log/log.h"
+#include "../sysfs/sysfspath.h"
+#include <QFile>
 
 /**
  * @brief LED类构造函数
  * @param parent 父对象指针
- * @details 初始化LED设备文件路径，在ARM平台上设置LED触发方式
+ * @details 初始化LED设备文件路径并设置LED触发方式，路径可通过SMARTHOME_SYSFS_ROOT重定向
  */
 Led::Led(QObject *parent)
 {
     this->setParent(parent);
-#if __arm__
     /* 默认是出厂系统的LED心跳的触发方式,想要控制LED，
-     * 需要改变LED的触发方式，改为none，即无 */
-    system("echo none > /sys/class/leds/sys-led/trigger");
-#endif
+     * 需要改变LED的触发方式，改为none，即无；板外没有该文件时忽略 */
+    QFile trigger(sysfsPath("/sys/class/leds/sys-led/trigger"));
+    if (trigger.open(QIODevice::WriteOnly))
+        trigger.write("none");
+
     /* 开发板的LED控制接口 */
-    file.setFileName("/sys/devices/platform/leds/leds/sys-led/brightness");
+    output.setPath(sysfsPath("/sys/devices/platform/leds/leds/sys-led/brightness"));
 }
 
 /**
@@ -32,28 +36,19 @@ Led::~Led()
 /**
  * @brief 设置LED的状态
  * @param flag LED状态，true表示打开，false表示关闭
- * @details 通过向系统文件写入0或1控制LED的亮灭
+ * @details 通过向系统文件写入0或1控制LED的亮灭，状态未改变时不写入；
+ *          写入耗时和失败次数记录到运行指标
  */
 void Led::setLedState(bool flag)
 {
-    qDebug()<<flag<<endl;
-
-    /* 如果文件不存在，则返回 */
-    if (!file.exists())
-        return;
+    static MetricHistogram *latency = Metrics::histogram("led.write_us");
+    static MetricCounter *errors = Metrics::counter("led.write_errors");
+    MetricTimer timer(latency);
 
-    if(!file.open(QIODevice::ReadWrite))
-        qDebug()<<file.errorString();
-
-    QByteArray buf[2] = {"0", "1"};
+    LOG_DEBUG() << "LED状态:" << flag;
 
     /* 写0或1,1~255都可以点亮LED */
-    if (flag)
-        file.write(buf[1]);
-    else
-        file.write(buf[0]);
-
-    /* 关闭文件 */
-    file.close();
+    if (!output.setState(flag))
+        errors->add();
 }
 
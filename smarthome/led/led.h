@@ -7,7 +7,7 @@
 #define LED_H
 
 #include <QObject>
-#include <QFile>
+#include "../sysfs/sysfsoutput.h"
 
 /**
  * @class Led
@@ -38,9 +38,9 @@ public:
 
 private:
     /**
-     * @brief 文件对象
-     * @details 用于访问LED设备控制文件
+     * @brief sysfs输出对象
+     * @details 常驻打开LED的brightness文件，状态未变化时不写入
      */
-    QFile file;
+    SysfsOutput output;
 };
 #endif // LED_H
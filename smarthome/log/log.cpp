@@ -0,0 +1,395 @@
+/**
+ * @file log.cpp
+ * @brief 日志模块的实现文件
+ */
+#include "log.h"
+#include <QtGlobal>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @brief 读取时钟，单位ms
+ */
+static qint64 clockMs(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (qint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @class LogSink
+ * @brief 环形缓冲区和后台输出线程
+ * @details 第一次提交日志时创建，进程退出时写完缓冲区中剩余的日志再结束线程。
+ *          这里使用标准库线程而不是QThread，保证在QApplication析构之后的静态析构阶段仍能安全退出
+ */
+class LogSink
+{
+public:
+    enum {
+        Slots = 256,                ///< 环形缓冲区条数
+        FlushIntervalMs = 200       ///< 后台线程批量写出的间隔
+    };
+
+    LogSink();
+    ~LogSink();
+
+    void submit(LogLevel level, const char *file, const char *text, int length);
+    void flush();
+    quint64 droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    /**
+     * @brief 环形缓冲区中的一条日志
+     */
+    struct Record {
+        qint64 timeMs;                      ///< 时间，自1970-01-01起的毫秒数
+        LogLevel level;                     ///< 级别
+        const char *file;                   ///< 源文件名(字符串常量)
+        int length;                         ///< 内容长度
+        char text[LogStream::MaxLength];    ///< 内容
+    };
+
+    void run();                             ///< 后台线程
+    void write(const Record *records, int count);   ///< 格式化并写出一批日志
+
+    std::mutex mutex;
+    std::condition_variable wakeup;         ///< 唤醒后台线程
+    std::condition_variable drained;        ///< 缓冲区已写空
+    Record ring[Slots];                     ///< 环形缓冲区
+    Record batch[Slots];                    ///< 后台线程取出的一批日志
+    unsigned int head;                      ///< 写入位置(自由增长)
+    unsigned int tail;                      ///< 读取位置(自由增长)
+    bool writing;                           ///< 后台线程是否正在写出
+    bool stopping;                          ///< 是否正在退出
+    std::atomic<quint64> dropped;           ///< 丢弃的日志条数
+    int fileFd;                             ///< 日志文件，-1表示不写文件
+    std::thread thread;                     ///< 后台线程
+};
+
+LogSink::LogSink()
+    : head(0), tail(0), writing(false), stopping(false), dropped(0), fileFd(-1)
+{
+    const char *path = getenv("SMARTHOME_LOG_FILE");
+    if (path && *path)
+        fileFd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    thread = std::thread(&LogSink::run, this);
+}
+
+LogSink::~LogSink()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_one();
+    thread.join();
+
+    if (fileFd >= 0)
+        close(fileFd);
+}
+
+/**
+ * @brief 提交一条日志
+ * @details 只在锁内拷贝一条记录；缓冲区过半时才唤醒后台线程，平时由后台线程定时批量取走
+ */
+void LogSink::submit(LogLevel level, const char *file, const char *text, int length)
+{
+    qint64 now = clockMs(CLOCK_REALTIME);
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (head - tail >= Slots) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Record &record = ring[head % Slots];
+        record.timeMs = now;
+        record.level = level;
+        record.file = file;
+        record.length = qMin<int>(length, LogStream::MaxLength);
+        memcpy(record.text, text, record.length);
+        head++;
+        wake = head - tail == Slots / 2 || level >= LogError;
+    }
+    if (wake)
+        wakeup.notify_one();
+}
+
+/**
+ * @brief 等待缓冲区中的日志全部写出
+ */
+void LogSink::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    wakeup.notify_one();
+    drained.wait(lock, [this]() { return head == tail && !writing; });
+}
+
+/**
+ * @brief 后台线程，定时或被唤醒时取出缓冲区中的全部日志写出
+ */
+void LogSink::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        if (head == tail) {
+            drained.notify_all();
+            if (stopping)
+                break;
+            wakeup.wait_for(lock, std::chrono::milliseconds(FlushIntervalMs));
+            continue;
+        }
+
+        int count = 0;
+        while (tail != head)
+            batch[count++] = ring[tail++ % Slots];
+        writing = true;
+        lock.unlock();
+
+        write(batch, count);
+
+        lock.lock();
+        writing = false;
+    }
+}
+
+/**
+ * @brief 格式化并写出一批日志
+ * @details 格式为"MM-dd HH:mm:ss.zzz 级别 源文件名: 内容"，整批日志只调用一次write
+ */
+void LogSink::write(const Record *records, int count)
+{
+    static const char Levels[] = "TDIWE";
+    static char out[Slots * (LogStream::MaxLength + 64)];
+    int length = 0;
+
+    for (int i = 0; i < count; i++) {
+        const Record &record = records[i];
+        time_t seconds = record.timeMs / 1000;
+        struct tm tm;
+        localtime_r(&seconds, &tm);
+
+        const char *name = strrchr(record.file, '/');
+        name = name ? name + 1 : record.file;
+
+        length += snprintf(out + length, sizeof(out) - length,
+                           "%02d-%02d %02d:%02d:%02d.%03d %c %.32s: ",
+                           tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                           (int)(record.timeMs % 1000), Levels[record.level], name);
+        memcpy(out + length, record.text, record.length);
+        length += record.length;
+        out[length++] = '\n';
+    }
+
+    if (::write(STDERR_FILENO, out, length) < 0) {
+        // 标准错误不可用时忽略，仍然写文件
+    }
+    if (fileFd >= 0 && ::write(fileFd, out, length) < 0) {
+        // 文件写满等错误不影响程序运行
+    }
+}
+
+static LogSink &sink()
+{
+    static LogSink instance;
+    return instance;
+}
+
+/**
+ * @brief LogStream类构造函数
+ */
+LogStream::LogStream(LogLevel level, const char *file, int suppressed)
+    : level(level), file(file), length(0)
+{
+    if (suppressed > 0)
+        length = snprintf(buffer, sizeof(buffer), "[此前%d条相同日志被抑制]", suppressed);
+}
+
+/**
+ * @brief LogStream类析构函数，提交日志
+ */
+LogStream::~LogStream()
+{
+    Logger::submit(level, file, buffer, length);
+}
+
+/**
+ * @brief 追加内容，各项之间加空格，超长部分截断
+ */
+void LogStream::append(const char *data, int n)
+{
+    if (length > 0 && length < MaxLength)
+        buffer[length++] = ' ';
+    n = qMin(n, MaxLength - length);
+    memcpy(buffer + length, data, n);
+    length += n;
+}
+
+LogStream &LogStream::operator<<(const char *text)
+{
+    append(text, text ? (int)strlen(text) : 0);
+    return *this;
+}
+
+LogStream &LogStream::operator<<(const QByteArray &text)
+{
+    append(text.constData(), text.size());
+    return *this;
+}
+
+LogStream &LogStream::operator<<(const QString &text)
+{
+    QByteArray utf8 = text.toUtf8();
+    append(utf8.constData(), utf8.size());
+    return *this;
+}
+
+LogStream &LogStream::operator<<(char c)
+{
+    append(&c, 1);
+    return *this;
+}
+
+LogStream &LogStream::operator<<(bool value)
+{
+    return *this << (value ? "true" : "false");
+}
+
+LogStream &LogStream::operator<<(int value)
+{
+    return *this << (long long)value;
+}
+
+LogStream &LogStream::operator<<(unsigned int value)
+{
+    return *this << (unsigned long long)value;
+}
+
+LogStream &LogStream::operator<<(long value)
+{
+    return *this << (long long)value;
+}
+
+LogStream &LogStream::operator<<(unsigned long value)
+{
+    return *this << (unsigned long long)value;
+}
+
+LogStream &LogStream::operator<<(long long value)
+{
+    char text[24];
+    append(text, snprintf(text, sizeof(text), "%lld", value));
+    return *this;
+}
+
+LogStream &LogStream::operator<<(unsigned long long value)
+{
+    char text[24];
+    append(text, snprintf(text, sizeof(text), "%llu", value));
+    return *this;
+}
+
+LogStream &LogStream::operator<<(double value)
+{
+    char text[32];
+    append(text, snprintf(text, sizeof(text), "%g", value));
+    return *this;
+}
+
+/**
+ * @brief LogRateLimiter类构造函数
+ */
+LogRateLimiter::LogRateLimiter(int intervalMs)
+    : intervalMs(intervalMs), last(-intervalMs), suppressed(0)
+{
+}
+
+/**
+ * @brief 尝试放行一条日志
+ * @details 多个线程同时到达时只有一个能更新放行时间，其余计入抑制条数
+ */
+int LogRateLimiter::acquire()
+{
+    qint64 now = clockMs(CLOCK_MONOTONIC);
+    qint64 previous = last.load(std::memory_order_relaxed);
+    if (now - previous < intervalMs ||
+        !last.compare_exchange_strong(previous, now, std::memory_order_relaxed)) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+    return 1 + suppressed.exchange(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 提交一条格式化好的日志
+ */
+void Logger::submit(LogLevel level, const char *file, const char *text, int length)
+{
+    sink().submit(level, file, text, length);
+}
+
+/**
+ * @brief Qt消息处理函数，按编译期日志级别过滤后转到异步日志
+ */
+static void qtMessageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    LogLevel level;
+    switch (type) {
+    case QtDebugMsg:
+        level = LogDebug;
+        break;
+    case QtInfoMsg:
+        level = LogInfo;
+        break;
+    case QtWarningMsg:
+        level = LogWarn;
+        break;
+    default:
+        level = LogError;
+        break;
+    }
+    if (level < SMARTHOME_LOG_LEVEL && type != QtFatalMsg)
+        return;
+
+    /* qDebug()<<...<<endl会在末尾留下换行和空格 */
+    QByteArray text = message.toUtf8().trimmed();
+    sink().submit(level, context.file ? context.file : "qt", text.constData(), text.size());
+
+    if (type == QtFatalMsg) {
+        sink().flush();
+        abort();
+    }
+}
+
+/**
+ * @brief 把Qt的qDebug()等输出也转到异步日志
+ */
+void Logger::installQtMessageHandler()
+{
+    qInstallMessageHandler(qtMessageHandler);
+}
+
+/**
+ * @brief 等待缓冲区中的日志全部写出
+ */
+void Logger::flush()
+{
+    sink().flush();
+}
+
+/**
+ * @brief 因缓冲区满被丢弃的日志条数
+ */
+quint64 Logger::droppedCount()
+{
+    return sink().droppedCount();
+}
@@ -0,0 +1,175 @@
+/**
+ * @file log.h
+ * @brief 日志模块的头文件
+ * @details 提供编译期按级别裁剪的日志宏、异步环形缓冲区输出和重复日志限流。
+ *          低于编译级别的日志语句连同参数的求值一起被编译器删除；
+ *          启用的日志只在调用线程中格式化到栈上的缓冲区，再拷贝进环形缓冲区，
+ *          由后台线程批量写出，调用线程不会阻塞在终端或文件的写入和刷新上
+ *
+ *          用法：
+ *          @code
+ *          LOG_INFO() << "串口打开成功";
+ *          LOG_DEBUG() << "发送命令" << cmd;
+ *          LOG_LIMITED(LogWarn, 10000) << "传感器读取超时";  // 每10秒最多一条，其余计数
+ *          @endcode
+ */
+#ifndef LOG_H
+#define LOG_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+
+/**
+ * @brief 日志级别
+ */
+enum LogLevel {
+    LogTrace = 0,   ///< 逐行的串口数据等最详细的信息
+    LogDebug = 1,   ///< 调试信息，例如发送的AT命令、执行器动作
+    LogInfo = 2,    ///< 连接流程等关键状态变化
+    LogWarn = 3,    ///< 可恢复的异常，例如超时、重试
+    LogError = 4,   ///< 需要关注的错误
+    LogOff = 5      ///< 关闭所有日志
+};
+
+/*
+ * 编译期日志级别，可在.pro中通过 DEFINES += SMARTHOME_LOG_LEVEL=0 修改；
+ * 默认release版本只保留Info及以上，debug版本保留Debug及以上
+ */
+#ifndef SMARTHOME_LOG_LEVEL
+#ifdef QT_NO_DEBUG
+#define SMARTHOME_LOG_LEVEL 2
+#else
+#define SMARTHOME_LOG_LEVEL 1
+#endif
+#endif
+
+/**
+ * @class LogStream
+ * @brief 一条日志的格式化缓冲区
+ * @details 在栈上格式化，析构时提交给日志输出线程；和qDebug()一样在各项之间自动加空格，超长部分被截断
+ */
+class LogStream
+{
+public:
+    enum {
+        MaxLength = 240     ///< 一条日志的最大长度，单位字节
+    };
+
+    /**
+     * @brief 构造函数
+     * @param level 日志级别
+     * @param file 源文件名(__FILE__)
+     * @param suppressed 限流时此前被抑制的条数
+     */
+    LogStream(LogLevel level, const char *file, int suppressed = 0);
+
+    /**
+     * @brief 析构函数，提交日志
+     */
+    ~LogStream();
+
+    LogStream &operator<<(const char *text);
+    LogStream &operator<<(const QByteArray &text);
+    LogStream &operator<<(const QString &text);
+    LogStream &operator<<(char c);
+    LogStream &operator<<(bool value);
+    LogStream &operator<<(int value);
+    LogStream &operator<<(unsigned int value);
+    LogStream &operator<<(long value);
+    LogStream &operator<<(unsigned long value);
+    LogStream &operator<<(long long value);
+    LogStream &operator<<(unsigned long long value);
+    LogStream &operator<<(double value);
+
+private:
+    Q_DISABLE_COPY(LogStream)
+
+    void append(const char *data, int length);  ///< 追加内容，各项之间加空格
+
+    LogLevel level;             ///< 日志级别
+    const char *file;           ///< 源文件名
+    int length;                 ///< 已格式化的长度
+    char buffer[MaxLength];     ///< 格式化缓冲区
+};
+
+/**
+ * @class LogRateLimiter
+ * @brief 单个日志语句的限流器
+ * @details 每个时间间隔内只放行一条，其余只计数，放行下一条时附带被抑制的条数
+ */
+class LogRateLimiter
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param intervalMs 两条日志之间的最小间隔，单位ms
+     */
+    explicit LogRateLimiter(int intervalMs);
+
+    /**
+     * @brief 尝试放行一条日志
+     * @return 不放行返回0，放行返回1加上此前被抑制的条数
+     */
+    int acquire();
+
+private:
+    qint64 intervalMs;              ///< 最小间隔
+    std::atomic<qint64> last;       ///< 上一次放行的时间
+    std::atomic<int> suppressed;    ///< 被抑制的条数
+};
+
+/**
+ * @class Logger
+ * @brief 日志输出
+ * @details 日志先写入固定条数的环形缓冲区，后台线程每200ms或缓冲区过半时批量写到标准错误，
+ *          设置环境变量SMARTHOME_LOG_FILE时同时追加写入该文件；缓冲区满时丢弃新日志并计数
+ */
+class Logger
+{
+public:
+    /**
+     * @brief 提交一条格式化好的日志
+     */
+    static void submit(LogLevel level, const char *file, const char *text, int length);
+
+    /**
+     * @brief 把Qt的qDebug()等输出也转到异步日志，未迁移的模块同样不会阻塞
+     */
+    static void installQtMessageHandler();
+
+    /**
+     * @brief 等待缓冲区中的日志全部写出
+     */
+    static void flush();
+
+    /**
+     * @brief 因缓冲区满被丢弃的日志条数
+     */
+    static quint64 droppedCount();
+};
+
+/*
+ * 日志宏。级别低于SMARTHOME_LOG_LEVEL时条件为编译期常量false，
+ * 整条语句(包括<<后面参数的求值)被编译器删除
+ */
+#define LOG_AT(level) \
+    if (SMARTHOME_LOG_LEVEL > (level)) {} else LogStream((level), __FILE__)
+
+#define LOG_TRACE() LOG_AT(LogTrace)
+#define LOG_DEBUG() LOG_AT(LogDebug)
+#define LOG_INFO()  LOG_AT(LogInfo)
+#define LOG_WARN()  LOG_AT(LogWarn)
+#define LOG_ERROR() LOG_AT(LogError)
+
+/*
+ * 限流的日志宏，每个调用位置有自己的限流器，intervalMs必须是常量
+ */
+#define LOG_LIMITED(level, intervalMs) \
+    if (SMARTHOME_LOG_LEVEL > (level)) {} else \
+    for (int logPass_ = ([]() -> LogRateLimiter & { \
+             static LogRateLimiter limiter(intervalMs); return limiter; })().acquire(); \
+         logPass_; logPass_ = 0) \
+        LogStream((level), __FILE__, logPass_ - 1)
+
+#endif // LOG_H
@@ -0,0 +1,5 @@
+SOURCES += \
+    ../log/log.cpp
+
+HEADERS += \
+    ../log/log.h
@@ -0,0 +1,221 @@
+/**
+ * @file metrics.cpp
+ * @brief 运行指标统计的实现文件
+ */
+#include "metrics.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+
+/* 直方图分桶上界，单位us */
+static const quint64 Bounds[MetricHistogram::BucketCount - 1] = {
+    50, 100, 250, 500,
+    1000, 2500, 5000, 10000,
+    25000, 50000, 100000, 250000,
+    500000, 1000000, 2500000, 5000000
+};
+
+/**
+ * @brief MetricHistogram类构造函数
+ */
+MetricHistogram::MetricHistogram()
+    : total(0), totalUs(0), maxUs(0)
+{
+    for (int i = 0; i < BucketCount; i++)
+        buckets[i].store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 记录一次耗时
+ * @details 分桶只有16档，顺序查找比二分查找更快
+ */
+void MetricHistogram::record(quint64 us)
+{
+    int index = 0;
+    while (index < BucketCount - 1 && us > Bounds[index])
+        index++;
+
+    buckets[index].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    totalUs.fetch_add(us, std::memory_order_relaxed);
+
+    quint64 current = maxUs.load(std::memory_order_relaxed);
+    while (us > current &&
+           !maxUs.compare_exchange_weak(current, us, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief 第index个分桶的上界
+ */
+quint64 MetricHistogram::bound(int index)
+{
+    return index < BucketCount - 1 ? Bounds[index] : 0;
+}
+
+/**
+ * @brief 记录次数
+ */
+quint64 MetricHistogram::count() const
+{
+    return total.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief 耗时总和
+ */
+quint64 MetricHistogram::sum() const
+{
+    return totalUs.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief 最大耗时
+ */
+quint64 MetricHistogram::max() const
+{
+    return maxUs.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief 第index个分桶的次数
+ */
+quint64 MetricHistogram::bucket(int index) const
+{
+    return buckets[index].load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief 按分桶估算百分位数
+ */
+quint64 MetricHistogram::percentile(double percentile) const
+{
+    quint64 n = 0;
+    quint64 counts[BucketCount];
+    for (int i = 0; i < BucketCount; i++) {
+        counts[i] = bucket(i);
+        n += counts[i];
+    }
+    if (n == 0)
+        return 0;
+
+    quint64 rank = (quint64)(percentile * n + 0.5);
+    if (rank == 0)
+        rank = 1;
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount - 1; i++) {
+        seen += counts[i];
+        if (seen >= rank)
+            return qMin(Bounds[i], max());
+    }
+    return max();
+}
+
+/**
+ * @brief 指标注册表的存储
+ * @details 用QMap保存，导出时按名称排序；指标对象永不释放，返回的指针始终有效
+ */
+struct Registry
+{
+    QMutex mutex;
+    QMap<QByteArray, MetricCounter *> counters;
+    QMap<QByteArray, MetricGauge *> gauges;
+    QMap<QByteArray, MetricHistogram *> histograms;
+};
+
+static Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+template <typename T>
+static T *lookup(QMap<QByteArray, T *> &map, const char *name)
+{
+    QMutexLocker locker(&registry().mutex);
+    T *&metric = map[QByteArray(name)];
+    if (!metric)
+        metric = new T();
+    return metric;
+}
+
+/**
+ * @brief 获取(必要时创建)计数器
+ */
+MetricCounter *Metrics::counter(const char *name)
+{
+    return lookup(registry().counters, name);
+}
+
+/**
+ * @brief 获取(必要时创建)数值指标
+ */
+MetricGauge *Metrics::gauge(const char *name)
+{
+    return lookup(registry().gauges, name);
+}
+
+/**
+ * @brief 获取(必要时创建)耗时直方图
+ */
+MetricHistogram *Metrics::histogram(const char *name)
+{
+    return lookup(registry().histograms, name);
+}
+
+/**
+ * @brief 导出所有指标的快照
+ * @details 格式为
+ *          {"ts":..,"counters":{..},"gauges":{..},"bounds_us":[..],
+ *           "histograms":{"名称":{"count":..,"sum_us":..,"max_us":..,"p50_us":..,"p90_us":..,"p99_us":..,"buckets":[..]}}}，
+ *          不包含分桶时省略bounds_us和buckets
+ */
+QByteArray Metrics::snapshot(bool withBuckets)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+
+    QJsonObject counters;
+    for (auto it = r.counters.constBegin(); it != r.counters.constEnd(); ++it)
+        counters.insert(QString::fromLatin1(it.key()), (qint64)it.value()->load());
+
+    QJsonObject gauges;
+    for (auto it = r.gauges.constBegin(); it != r.gauges.constEnd(); ++it)
+        gauges.insert(QString::fromLatin1(it.key()), it.value()->load());
+
+    QJsonObject histograms;
+    for (auto it = r.histograms.constBegin(); it != r.histograms.constEnd(); ++it) {
+        const MetricHistogram *h = it.value();
+        QJsonObject entry;
+        entry.insert("count", (qint64)h->count());
+        entry.insert("sum_us", (qint64)h->sum());
+        entry.insert("max_us", (qint64)h->max());
+        entry.insert("p50_us", (qint64)h->percentile(0.50));
+        entry.insert("p90_us", (qint64)h->percentile(0.90));
+        entry.insert("p99_us", (qint64)h->percentile(0.99));
+        if (withBuckets) {
+            QJsonArray buckets;
+            for (int i = 0; i < MetricHistogram::BucketCount; i++)
+                buckets.append((qint64)h->bucket(i));
+            entry.insert("buckets", buckets);
+        }
+        histograms.insert(QString::fromLatin1(it.key()), entry);
+    }
+
+    QJsonObject root;
+    root.insert("ts", QDateTime::currentMSecsSinceEpoch());
+    root.insert("counters", counters);
+    root.insert("gauges", gauges);
+    if (withBuckets) {
+        QJsonArray bounds;
+        for (int i = 0; i < MetricHistogram::BucketCount - 1; i++)
+            bounds.append((qint64)Bounds[i]);
+        root.insert("bounds_us", bounds);
+    }
+    root.insert("histograms", histograms);
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
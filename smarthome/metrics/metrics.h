@@ -0,0 +1,159 @@
+/**
+ * @file metrics.h
+ * @brief 运行指标统计的头文件
+ * @details 提供无锁计数器、数值指标和固定分桶的耗时直方图，用于统计传感器读取、
+ *          AT命令往返、执行器写入等热点路径的次数和耗时
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <atomic>
+
+/**
+ * @class MetricCounter
+ * @brief 单调递增的计数器
+ * @details 只使用relaxed原子操作，可以在任意线程中调用
+ */
+class MetricCounter
+{
+public:
+    MetricCounter() : value(0) {}
+
+    /**
+     * @brief 计数增加n
+     */
+    void add(quint64 n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+
+    /**
+     * @brief 当前计数
+     */
+    quint64 load() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<quint64> value;     ///< 计数值
+};
+
+/**
+ * @class MetricGauge
+ * @brief 表示当前状态的数值，例如发件箱积压条数
+ */
+class MetricGauge
+{
+public:
+    MetricGauge() : value(0) {}
+
+    /**
+     * @brief 设置当前值
+     */
+    void set(qint64 v) { value.store(v, std::memory_order_relaxed); }
+
+    /**
+     * @brief 当前值
+     */
+    qint64 load() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> value;      ///< 当前值
+};
+
+/**
+ * @class MetricHistogram
+ * @brief 固定分桶的耗时直方图
+ * @details 分桶上界固定为50us~5s共16档，另有一个溢出桶；
+ *          记录一次耗时只需几次relaxed原子加法，不分配内存、不加锁
+ */
+class MetricHistogram
+{
+public:
+    enum {
+        BucketCount = 17    ///< 分桶数(含溢出桶)
+    };
+
+    MetricHistogram();
+
+    /**
+     * @brief 记录一次耗时
+     * @param us 耗时，单位us
+     */
+    void record(quint64 us);
+
+    /**
+     * @brief 第index个分桶的上界，单位us，溢出桶返回0
+     */
+    static quint64 bound(int index);
+
+    quint64 count() const;              ///< 记录次数
+    quint64 sum() const;                ///< 耗时总和，单位us
+    quint64 max() const;                ///< 最大耗时，单位us
+    quint64 bucket(int index) const;    ///< 第index个分桶的次数
+
+    /**
+     * @brief 按分桶估算百分位数
+     * @param percentile 百分位，例如0.99
+     * @return 百分位所在分桶的上界，单位us；落在溢出桶时返回最大耗时
+     */
+    quint64 percentile(double percentile) const;
+
+private:
+    std::atomic<quint64> buckets[BucketCount];  ///< 各分桶的次数
+    std::atomic<quint64> total;                 ///< 记录次数
+    std::atomic<quint64> totalUs;               ///< 耗时总和
+    std::atomic<quint64> maxUs;                 ///< 最大耗时
+};
+
+/**
+ * @class MetricTimer
+ * @brief 作用域计时器，析构时把经过的时间记录到直方图
+ * @code
+ * static MetricHistogram *latency = Metrics::histogram("dht11.read_us");
+ * MetricTimer timer(latency);
+ * @endcode
+ */
+class MetricTimer
+{
+public:
+    explicit MetricTimer(MetricHistogram *histogram) : histogram(histogram) { timer.start(); }
+    ~MetricTimer() { histogram->record(timer.nsecsElapsed() / 1000); }
+
+private:
+    MetricHistogram *histogram;     ///< 记录到的直方图
+    QElapsedTimer timer;            ///< 计时器
+};
+
+/**
+ * @class Metrics
+ * @brief 进程内的指标注册表
+ * @details 指标按名称第一次获取时创建并一直存在到进程结束，返回的指针可以缓存
+ *          (通常保存在函数内的static变量中)，之后的更新不再查表。
+ *          只有创建和导出快照时加锁，热点路径上没有锁
+ */
+class Metrics
+{
+public:
+    /**
+     * @brief 获取(必要时创建)计数器
+     * @param name 指标名，例如"at.retries"
+     */
+    static MetricCounter *counter(const char *name);
+
+    /**
+     * @brief 获取(必要时创建)数值指标
+     */
+    static MetricGauge *gauge(const char *name);
+
+    /**
+     * @brief 获取(必要时创建)耗时直方图
+     */
+    static MetricHistogram *histogram(const char *name);
+
+    /**
+     * @brief 导出所有指标的快照
+     * @param withBuckets 是否包含直方图各分桶的次数，不包含时只有次数、总和、最大值和百分位数
+     * @return 紧凑格式的JSON数据
+     */
+    static QByteArray snapshot(bool withBuckets = true);
+};
+
+#endif // METRICS_H
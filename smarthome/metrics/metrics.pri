@@ -0,0 +1,5 @@
+SOURCES += \
+    ../metrics/metrics.cpp
+
+HEADERS += \
+    ../metrics/metrics.h
@@ -3,7 +3,8 @@
  * @brief 继电器控制类的实现文件
  */
 #include "relay.h"
-#include <QDebug>
+#include "../metrics/metrics.h"
+#include "../sysfs/sysfspath.h"
 
 /**
  * @brief 继电器类构造函数
@@ -13,7 +14,7 @@
 Relay::Relay(QObject *parent)
 {
     this->setParent(parent);
-    file.setFileName("/sys/class/leds/relay/brightness");
+    output.setPath(sysfsPath("/sys/class/leds/relay/brightness"));
 }
 
 /**
@@ -26,25 +27,16 @@ Relay::~Relay()
 /**
  * @brief 设置继电器的状态
  * @param flag 继电器状态，true表示打开，false表示关闭
- * @details 通过向系统文件写入0或1控制继电器的开闭
+ * @details 通过向系统文件写入0或1控制继电器的开闭，状态未改变时不写入；
+ *          写入耗时和失败次数记录到运行指标
  */
 void Relay::setRelayState(bool flag)
 {
-    /* 如果文件不存在，则返回 */
-    if (!file.exists())
-        return;
-
-    if(!file.open(QIODevice::ReadWrite))
-        qDebug()<<file.errorString();
-
-    QByteArray buf[2] = {"0", "1"};
+    static MetricHistogram *latency = Metrics::histogram("relay.write_us");
+    static MetricCounter *errors = Metrics::counter("relay.write_errors");
+    MetricTimer timer(latency);
 
     /* 写0或1,1表示打开继电器，0表示关闭继电器 */
-    if (flag)
-        file.write(buf[1]);
-    else
-        file.write(buf[0]);
-
-    /* 关闭文件 */
-    file.close();
+    if (!output.setState(flag))
+        errors->add();
 }
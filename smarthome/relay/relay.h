@@ -7,7 +7,7 @@
 #define RELAY_H
 
 #include <QObject>
-#include <QFile>
+#include "../sysfs/sysfsoutput.h"
 
 /**
  * @class Relay
@@ -20,10 +20,10 @@ class Relay : public QObject
 
 private:
     /**
-     * @brief 文件对象
-     * @details 用于访问继电器设备控制文件
+     * @brief sysfs输出对象
+     * @details 常驻打开继电器的brightness文件，状态未变化时不写入
      */
-    QFile file;
+    SysfsOutput output;
 
 public:
     /**
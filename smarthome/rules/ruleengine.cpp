@@ -0,0 +1,366 @@
+/**
+ * @file ruleengine.cpp
+ * @brief 本地自动化规则引擎类的实现文件
+ */
+#include "ruleengine.h"
+#include "../log/log.h"
+#include "../metrics/metrics.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+
+/*
+ * 内置规则：气体浓度超过10ppm时打开蜂鸣器，降到8ppm以下才关闭，
+ * 之间的回差避免浓度在阈值附近波动时蜂鸣器反复开关
+ */
+static const char DefaultRules[] = R"({
+    "rules": [
+        {"name": "燃气报警", "when": "mq135.ppm >= 10", "release": "mq135.ppm < 8",
+         "then": {"beep": true}, "else": {"beep": false}}
+    ]
+})";
+
+/**
+ * @brief RuleEngine类构造函数
+ * @param devices 设备注册表
+ * @param parent 父对象指针
+ */
+RuleEngine::RuleEngine(DeviceRegistry *devices, QObject *parent)
+    : QObject(parent), devices(devices)
+{
+    clock.start();
+}
+
+/**
+ * @brief 默认规则文件路径
+ */
+QString RuleEngine::defaultConfigPath()
+{
+    QString path = QString::fromLocal8Bit(qgetenv("SMARTHOME_RULES"));
+    return path.isEmpty() ? QStringLiteral("/etc/smarthome/rules.json") : path;
+}
+
+/**
+ * @brief 加载规则文件
+ */
+bool RuleEngine::load(const QString &path)
+{
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        QString error;
+        if (loadJson(file.readAll(), &error)) {
+            LOG_INFO() << "规则文件" << path << "加载了" << rules.size() << "条规则";
+            return true;
+        }
+        LOG_WARN() << "规则文件" << path << "无效:" << error << "，使用内置规则";
+    }
+
+    loadJson(QByteArray(DefaultRules));
+    return false;
+}
+
+/**
+ * @brief 编译规则
+ * @details 条件无效或引用了不存在的设备的规则记录警告后跳过
+ */
+bool RuleEngine::loadJson(const QByteArray &json, QString *error)
+{
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !document.object().value("rules").isArray()) {
+        if (error)
+            *error = parseError.error != QJsonParseError::NoError ? parseError.errorString()
+                                                                   : QStringLiteral("缺少rules数组");
+        return false;
+    }
+
+    rules.clear();
+    values.clear();
+    signalNames.clear();
+    dependents.clear();
+
+    const QJsonArray array = document.object().value("rules").toArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject object = value.toObject();
+        Rule rule;
+        rule.name = object.value("name").toString(QString("rule%1").arg(rules.size()));
+        rule.forMs = object.value("forMs").toInt();
+        rule.minOnMs = object.value("minOnMs").toInt();
+        rule.minOffMs = object.value("minOffMs").toInt();
+        rule.then = compileActions(object.value("then").toObject());
+        rule.otherwise = compileActions(object.value("else").toObject());
+
+        QString reason;
+        if (!compile(object.value("when").toString(), rule.when, &reason) ||
+            (object.contains("release") && !compile(object.value("release").toString(), rule.release, &reason))) {
+            LOG_WARN() << "跳过规则" << rule.name << ":" << reason;
+            continue;
+        }
+
+        /* 建立信号到规则的索引，采样只触发引用了该信号的规则求值 */
+        int index = rules.size();
+        for (const QVector<Term> *terms : { &rule.when, &rule.release }) {
+            for (const Term &term : *terms) {
+                if (!dependents[term.signal].contains(index))
+                    dependents[term.signal].append(index);
+            }
+        }
+        rules.append(rule);
+    }
+    return true;
+}
+
+/**
+ * @brief 已编译的规则数
+ */
+int RuleEngine::ruleCount() const
+{
+    return rules.size();
+}
+
+/**
+ * @brief 规则是否处于触发状态
+ */
+bool RuleEngine::isActive(const QString &name) const
+{
+    for (const Rule &rule : rules) {
+        if (rule.name == name)
+            return rule.state == 1;
+    }
+    return false;
+}
+
+/**
+ * @brief 用一个采样更新信号并求值相关规则
+ * @details 只求值引用了本次更新的信号的规则，求值耗时记录到运行指标
+ */
+void RuleEngine::update(const SensorSample &sample)
+{
+    static MetricHistogram *latency = Metrics::histogram("rules.eval_us");
+
+    if (rules.isEmpty())
+        return;
+
+    MetricTimer timer(latency);
+    QVector<int> dirty;
+    switch (sample.sensor) {
+    case SensorSample::Dht11:
+        setSignal(sample.device, "temperature", sample.temperature, sample.valid, dirty);
+        setSignal(sample.device, "humidity", sample.humidity, sample.valid, dirty);
+        break;
+
+    case SensorSample::Mq135:
+        setSignal(sample.device, "ppm", sample.ppm, sample.valid, dirty);
+        break;
+    }
+
+    qint64 now = clock.elapsed();
+    for (int index : dirty)
+        evaluate(rules[index], now);
+}
+
+/**
+ * @brief 信号名到下标，没有时新建
+ */
+int RuleEngine::signalIndex(const QString &name)
+{
+    auto it = signalNames.constFind(name);
+    if (it != signalNames.constEnd())
+        return it.value();
+
+    int index = values.size();
+    values.append(Signal());
+    dependents.append(QVector<int>());
+    signalNames.insert(name, index);
+    return index;
+}
+
+/**
+ * @brief 编译条件
+ * @param text 条件文本，例如"dht11.humidity < 40 && mq135.ppm < 5"
+ * @param terms 输出的比较项
+ * @param error 失败时输出原因
+ * @details 设备必须是传感器，字段必须是update()会更新的字段，否则规则永远不会求值
+ */
+bool RuleEngine::compile(const QString &text, QVector<Term> &terms, QString *error)
+{
+    static const QRegularExpression pattern(
+        QStringLiteral("^\\s*([\\w-]+)\\.(\\w+)\\s*(<=|>=|==|!=|<|>)\\s*(-?\\d+(?:\\.\\d+)?)\\s*$"));
+
+    terms.clear();
+    const QStringList parts = text.split("&&");
+    for (const QString &part : parts) {
+        QRegularExpressionMatch match = pattern.match(part);
+        if (!match.hasMatch()) {
+            *error = "无法解析条件\"" + part.trimmed() + "\"";
+            return false;
+        }
+        SensorDevice *sensor = devices->device<SensorDevice>(match.captured(1));
+        if (!sensor) {
+            *error = "没有传感器" + match.captured(1);
+            return false;
+        }
+        QString field = match.captured(2);
+        bool provided = sensor->sensor() == SensorSample::Dht11 ? field == "temperature" || field == "humidity"
+                                                                 : field == "ppm";
+        if (!provided) {
+            *error = "传感器" + match.captured(1) + "没有字段" + field;
+            return false;
+        }
+
+        QString op = match.captured(3);
+        Term term;
+        term.signal = signalIndex(match.captured(1) + "." + field);
+        term.op = op == "<" ? Less : op == "<=" ? LessEqual : op == ">" ? Greater
+                : op == ">=" ? GreaterEqual : op == "==" ? Equal : NotEqual;
+        term.value = match.captured(4).toDouble();
+        terms.append(term);
+    }
+    return true;
+}
+
+/**
+ * @brief 编译动作
+ * @details 不存在的设备记录警告后忽略
+ */
+QVector<RuleEngine::Action> RuleEngine::compileActions(const QJsonObject &object) const
+{
+    QVector<Action> actions;
+    for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+        if (!devices->device(it.key())) {
+            LOG_WARN() << "规则动作引用了不存在的设备" << it.key();
+            continue;
+        }
+        Action action;
+        action.device = it.key();
+        action.value = it.value();
+        actions.append(action);
+    }
+    return actions;
+}
+
+/**
+ * @brief 条件引用的信号是否都有效
+ */
+bool RuleEngine::known(const QVector<Term> &terms) const
+{
+    for (const Term &term : terms) {
+        if (!values[term.signal].valid)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 条件是否成立
+ */
+bool RuleEngine::test(const QVector<Term> &terms) const
+{
+    for (const Term &term : terms) {
+        double value = values[term.signal].value;
+        bool result;
+        switch (term.op) {
+        case Less:          result = value < term.value; break;
+        case LessEqual:     result = value <= term.value; break;
+        case Greater:       result = value > term.value; break;
+        case GreaterEqual:  result = value >= term.value; break;
+        case Equal:         result = value == term.value; break;
+        default:            result = value != term.value; break;
+        }
+        if (!result)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 更新一个信号，并把引用它的规则加入待求值列表
+ */
+void RuleEngine::setSignal(const QString &device, const char *field, double value, bool valid, QVector<int> &dirty)
+{
+    int index = signalNames.value(device + "." + QLatin1String(field), -1);
+    if (index < 0)
+        return;
+
+    values[index].value = value;
+    values[index].valid = valid;
+    for (int rule : dependents[index]) {
+        if (!dirty.contains(rule))
+            dirty.append(rule);
+    }
+}
+
+/**
+ * @brief 求值一条规则
+ * @details 触发需要条件持续成立forMs且解除后已过minOffMs；解除需要解除条件成立且触发后已过minOnMs。
+ *          保持时间未到时不改变状态，之后的采样到来时再判断
+ */
+void RuleEngine::evaluate(Rule &rule, qint64 now)
+{
+    static MetricCounter *fired = Metrics::counter("rules.fired");
+
+    if (!known(rule.when)) {
+        rule.pendingSince = -1;
+        return;
+    }
+    bool triggered = test(rule.when);
+
+    /*
+     * 第一次求值记为解除状态，触发不受minOffMs限制。
+     * else只对不接受云端控制或状态未知的执行器执行：云端可控且状态已知的执行器保持启动时的状态
+     * (可能是手动或云端设置的)；只由规则控制的执行器(如蜂鸣器)以及状态未知的执行器
+     * 必须进入确定的状态，否则上次运行遗留的蜂鸣声要等到规则再次触发并解除才会停止
+     */
+    if (rule.state < 0) {
+        rule.state = 0;
+        rule.changedAt = now - rule.minOffMs;
+        QVector<Action> initial;
+        for (const Action &action : rule.otherwise) {
+            Device *device = devices->device(action.device);
+            if (device && (!device->isRemote() || device->state().isNull()))
+                initial.append(action);
+        }
+        run(rule, initial);
+    }
+
+    if (rule.state == 0) {
+        if (!triggered) {
+            rule.pendingSince = -1;
+            return;
+        }
+        if (rule.pendingSince < 0)
+            rule.pendingSince = now;
+        if (now - rule.pendingSince < rule.forMs || now - rule.changedAt < rule.minOffMs)
+            return;
+
+        rule.state = 1;
+        rule.changedAt = now;
+        rule.pendingSince = -1;
+        fired->add();
+        LOG_INFO() << "规则" << rule.name << "触发";
+        run(rule, rule.then);
+        emit ruleChanged(rule.name, true);
+    } else {
+        bool released = rule.release.isEmpty() ? !triggered : known(rule.release) && test(rule.release);
+        if (!released || now - rule.changedAt < rule.minOnMs)
+            return;
+
+        rule.state = 0;
+        rule.changedAt = now;
+        LOG_INFO() << "规则" << rule.name << "解除";
+        run(rule, rule.otherwise);
+        emit ruleChanged(rule.name, false);
+    }
+}
+
+/**
+ * @brief 执行动作
+ */
+void RuleEngine::run(const Rule &rule, const QVector<Action> &actions)
+{
+    for (const Action &action : actions) {
+        if (!devices->command(action.device, action.value))
+            LOG_WARN() << "规则" << rule.name << "的动作执行失败:" << action.device;
+    }
+}
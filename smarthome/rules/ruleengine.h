@@ -0,0 +1,169 @@
+/**
+ * @file ruleengine.h
+ * @brief 本地自动化规则引擎类的头文件
+ * @details 在板上根据传感器采样直接控制执行器，不经过云端，MQTT断开时照常工作
+ */
+#ifndef RULEENGINE_H
+#define RULEENGINE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QVector>
+#include "../device/deviceregistry.h"
+
+/**
+ * @class RuleEngine
+ * @brief 本地自动化规则引擎类
+ * @details 规则配置格式：
+ * @code
+ * {
+ *     "rules": [
+ *         {"name": "燃气报警", "when": "mq135.ppm >= 10", "release": "mq135.ppm < 8",
+ *          "then": {"beep": true}, "else": {"beep": false}},
+ *         {"name": "加湿", "when": "dht11.humidity < 40", "minOnMs": 300000,
+ *          "then": {"relay": "open"}, "else": {"relay": "close"}},
+ *         {"name": "通风", "when": "mq135.ppm > 20", "forMs": 30000,
+ *          "then": {"beep": true, "curtain": 100}}
+ *     ]
+ * }
+ * @endcode
+ *          - "when"：触发条件，由"<设备id>.<字段> <比较符> <数值>"用&&连接，
+ *            字段必须是该传感器提供的：DHT11为temperature或humidity，MQ-135为ppm
+ *          - "release"：解除条件，没有时为when不成立；两者之间的区间形成回差
+ *          - "forMs"：触发条件需要持续成立的时间
+ *          - "minOnMs"/"minOffMs"：触发后至少保持、解除后至少保持的时间，避免执行器频繁开关
+ *          - "then"/"else"：触发/解除时执行的控制命令，格式与云端控制命令相同
+ *
+ *          加载时把条件编译为(信号下标, 比较符, 阈值)数组，运行时不再解析字符串；
+ *          每个采样只更新该设备的信号，并只求值引用了这些信号的规则。
+ *          引用的信号还没有有效数据时规则保持原状态；第一次求值时记为解除状态，
+ *          else只对不接受云端控制或状态未知的执行器执行，让它们进入确定的状态，
+ *          不覆盖云端可控的执行器启动时已知的状态；条件成立时照常触发then
+ */
+class RuleEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param devices 执行规则动作的设备注册表
+     * @param parent 父对象指针
+     */
+    RuleEngine(DeviceRegistry *devices, QObject *parent = nullptr);
+
+    /**
+     * @brief 默认规则文件路径
+     * @return 环境变量SMARTHOME_RULES非空时为其值，否则为/etc/smarthome/rules.json
+     */
+    static QString defaultConfigPath();
+
+    /**
+     * @brief 加载规则文件
+     * @param path 规则文件路径
+     * @return 规则文件有效返回true；文件不存在或格式错误时使用内置规则(燃气报警)并返回false
+     */
+    bool load(const QString &path);
+
+    /**
+     * @brief 编译规则，原有规则全部丢弃
+     * @param json 规则内容
+     * @param error 格式错误时输出错误描述，可以为空
+     * @return 格式正确返回true；单条规则无效时跳过该规则
+     */
+    bool loadJson(const QByteArray &json, QString *error = nullptr);
+
+    /**
+     * @brief 已编译的规则数
+     */
+    int ruleCount() const;
+
+    /**
+     * @brief 规则是否处于触发状态
+     * @param name 规则名
+     */
+    bool isActive(const QString &name) const;
+
+public slots:
+    /**
+     * @brief 用一个采样更新信号并求值相关规则
+     * @param sample 采样结果，无效采样把该设备的信号置为无效
+     */
+    void update(const SensorSample &sample);
+
+signals:
+    /**
+     * @brief 规则状态变化
+     * @param name 规则名
+     * @param active true为触发，false为解除
+     */
+    void ruleChanged(const QString &name, bool active);
+
+private:
+    /**
+     * @brief 比较符
+     */
+    enum Op { Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual };
+
+    /**
+     * @brief 编译后的一个比较项
+     */
+    struct Term {
+        int signal;             ///< 信号下标
+        Op op;                  ///< 比较符
+        double value;           ///< 阈值
+    };
+
+    /**
+     * @brief 一个控制动作
+     */
+    struct Action {
+        QString device;         ///< 设备标识
+        QJsonValue value;       ///< 控制命令值
+    };
+
+    /**
+     * @brief 编译后的规则
+     */
+    struct Rule {
+        QString name;               ///< 规则名
+        QVector<Term> when;         ///< 触发条件，各项为与关系
+        QVector<Term> release;      ///< 解除条件，为空时使用when取反
+        qint64 forMs = 0;           ///< 触发条件需要持续成立的时间
+        qint64 minOnMs = 0;         ///< 触发后至少保持的时间
+        qint64 minOffMs = 0;        ///< 解除后至少保持的时间
+        QVector<Action> then;       ///< 触发动作
+        QVector<Action> otherwise;  ///< 解除动作
+        int state = -1;             ///< 1触发，0解除，-1尚未求值
+        qint64 pendingSince = -1;   ///< 触发条件开始成立的时间，-1表示不成立
+        qint64 changedAt = 0;       ///< 最近一次状态变化的时间
+    };
+
+    /**
+     * @brief 一个信号的当前值
+     */
+    struct Signal {
+        double value = 0;       ///< 当前值
+        bool valid = false;     ///< 是否有有效数据
+    };
+
+    int signalIndex(const QString &name);                       ///< 信号名到下标，没有时新建
+    bool compile(const QString &text, QVector<Term> &terms, QString *error);    ///< 编译条件
+    QVector<Action> compileActions(const QJsonObject &object) const;            ///< 编译动作
+    bool known(const QVector<Term> &terms) const;               ///< 条件引用的信号是否都有效
+    bool test(const QVector<Term> &terms) const;                ///< 条件是否成立
+    void setSignal(const QString &device, const char *field, double value, bool valid, QVector<int> &dirty);
+    void evaluate(Rule &rule, qint64 now);                      ///< 求值一条规则
+    void run(const Rule &rule, const QVector<Action> &actions); ///< 执行动作
+
+    DeviceRegistry *devices;                ///< 设备注册表
+    QVector<Rule> rules;                    ///< 已编译的规则
+    QVector<Signal> values;                 ///< 信号当前值
+    QHash<QString, int> signalNames;        ///< 信号名("设备id.字段")到下标
+    QVector<QVector<int>> dependents;       ///< 每个信号被哪些规则引用
+    QElapsedTimer clock;                    ///< 规则计时
+};
+
+#endif // RULEENGINE_H
@@ -0,0 +1,5 @@
+SOURCES += \
+    ../rules/ruleengine.cpp
+
+HEADERS += \
+    ../rules/ruleengine.h
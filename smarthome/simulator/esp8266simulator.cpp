@@ -0,0 +1,338 @@
+/**
+ * @file esp8266simulator.cpp
+ * @brief ESP8266 AT固件模拟器的实现文件
+ */
+#include "esp8266simulator.h"
+#include <QDebug>
+#include <QFile>
+#include <QRandomGenerator>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+/* MQTT连接成功的上报内容 */
+static const char MqttConnected[] = "+MQTTCONNECTED:0,1,\"simulator\",\"1883\",\"\",1\r\n";
+
+/**
+ * @brief Esp8266Simulator类构造函数
+ * @param options 时延和故障注入参数
+ * @param parent 父对象指针
+ */
+Esp8266Simulator::Esp8266Simulator(const SimulatorOptions &options, QObject *parent)
+    : QObject(parent), options(options), master(-1), slave(-1), notifier(nullptr),
+      rawRemaining(0), echo(true), wifiConnected(false), mqttConnected(false),
+      commands(0), publishes(0), publishBytes(0), injected(0), faults(0)
+{
+    clock.start();
+
+    replyTimer.setSingleShot(true);
+    connect(&replyTimer, &QTimer::timeout, this, &Esp8266Simulator::writeDue);
+    connect(&disconnectTimer, &QTimer::timeout, this, &Esp8266Simulator::disconnectMqtt);
+}
+
+/**
+ * @brief Esp8266Simulator类析构函数
+ * @details 关闭伪终端并删除符号链接
+ */
+Esp8266Simulator::~Esp8266Simulator()
+{
+    if (slave >= 0)
+        close(slave);
+    if (master >= 0)
+        close(master);
+    if (!linkPath.isEmpty())
+        QFile::remove(linkPath);
+}
+
+/**
+ * @brief 创建伪终端
+ * @details 从设备设置为原始模式并保持打开；板上程序用QSerialPort打开时会重新设置串口参数
+ */
+bool Esp8266Simulator::open(const QString &link)
+{
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        qDebug()<<"无法创建伪终端"<<endl;
+        return false;
+    }
+    slavePath = QString::fromLocal8Bit(ptsname(master));
+
+    slave = ::open(ptsname(master), O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (slave >= 0) {
+        struct termios tio;
+        tcgetattr(slave, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+
+    if (!link.isEmpty()) {
+        QFile::remove(link);
+        if (QFile::link(slavePath, link))
+            linkPath = link;
+        else
+            qDebug()<<"无法创建符号链接"<<link<<endl;
+    }
+
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    notifier = new QSocketNotifier(master, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &Esp8266Simulator::readPort);
+    return true;
+}
+
+/**
+ * @brief 伪终端从设备路径
+ */
+QString Esp8266Simulator::portPath() const
+{
+    return linkPath.isEmpty() ? slavePath : linkPath;
+}
+
+/**
+ * @brief 向已订阅的主题下发一条消息
+ * @details 板上程序只订阅控制命令主题，消息发到第一个订阅的主题
+ */
+bool Esp8266Simulator::inject(const QByteArray &payload)
+{
+    if (!mqttConnected || topics.isEmpty())
+        return false;
+
+    QByteArray topic = *topics.constBegin();
+    reply("+MQTTSUBRECV:0,\"" + topic + "\"," + QByteArray::number(payload.size()) + "," +
+          payload + "\r\n");
+    injected++;
+    return true;
+}
+
+/**
+ * @brief 输出统计信息
+ */
+void Esp8266Simulator::printStats() const
+{
+    qDebug()<<"命令"<<commands<<"发布"<<publishes<<"发布字节"<<publishBytes
+            <<"下发"<<injected<<"注入故障"<<faults<<endl;
+}
+
+/**
+ * @brief 读取板上程序写入的数据
+ * @details AT+MQTTPUBRAW提示符之后按长度接收原始数据，其余按行处理
+ */
+void Esp8266Simulator::readPort()
+{
+    char buffer[1024];
+    ssize_t n;
+    while ((n = read(master, buffer, sizeof(buffer))) > 0)
+        input.append(buffer, (int)n);
+
+    for (;;) {
+        if (rawRemaining > 0) {
+            int take = qMin(rawRemaining, input.size());
+            if (take == 0)
+                return;
+            rawPayload += input.left(take);
+            input.remove(0, take);
+            rawRemaining -= take;
+            if (rawRemaining == 0)
+                finishRawPublish();
+            continue;
+        }
+
+        int end = input.indexOf('\n');
+        if (end < 0)
+            return;
+        QByteArray line = input.left(end).trimmed();
+        input.remove(0, end + 1);
+        if (!line.isEmpty())
+            handleLine(line);
+    }
+}
+
+/**
+ * @brief 处理一条AT命令
+ * @details 先回显命令，再按故障注入概率决定丢弃响应或回复ERROR，最后按命令模拟模块的行为
+ */
+void Esp8266Simulator::handleLine(const QByteArray &line)
+{
+    commands++;
+    if (echo)
+        reply(line + "\r\n", -options.latencyMs);
+
+    if (line.startsWith("AT+RST")) {
+        /* 复位：断开所有连接，启动信息以74880波特率输出，在115200下表现为乱码 */
+        wifiConnected = false;
+        mqttConnected = false;
+        topics.clear();
+        rawRemaining = 0;
+        disconnectTimer.stop();
+        reply("\r\nOK\r\n");
+        reply(QByteArray("\xff\x00 ets Jan  8 2013,rst cause:2, boot mode:(3,6)\r\n", 49) +
+              "\r\nready\r\n", options.bootMs);
+        return;
+    }
+
+    double roll = QRandomGenerator::global()->generateDouble();
+    if (roll < options.dropRate) {
+        faults++;
+        return;
+    }
+    if (roll < options.dropRate + options.errorRate) {
+        faults++;
+        reply("\r\nERROR\r\n");
+        return;
+    }
+
+    int eq = line.indexOf('=');
+    QList<QByteArray> args = splitArgs(eq < 0 ? QByteArray() : line.mid(eq + 1));
+
+    if (line == "AT") {
+        reply("\r\nOK\r\n");
+    } else if (line == "ATE0" || line == "ATE1") {
+        echo = line == "ATE1";
+        reply("\r\nOK\r\n");
+    } else if (line.startsWith("AT+CWMODE") || line.startsWith("AT+CIPSNTPCFG") ||
+               line.startsWith("AT+MQTTUSERCFG") || line.startsWith("AT+MQTTCLIENTID")) {
+        reply("\r\nOK\r\n");
+    } else if (line.startsWith("AT+CWJAP")) {
+        wifiConnected = true;
+        reply("WIFI CONNECTED\r\n", options.wifiMs / 2);
+        reply("WIFI GOT IP\r\n\r\nOK\r\n", options.wifiMs / 2);
+    } else if (line.startsWith("AT+MQTTCONN")) {
+        if (!wifiConnected) {
+            reply("\r\nERROR\r\n");
+            return;
+        }
+        mqttConnected = true;
+        reply(QByteArray(MqttConnected) + "\r\nOK\r\n", 50);
+        if (options.disconnectEveryMs > 0)
+            disconnectTimer.start(options.disconnectEveryMs);
+    } else if (line.startsWith("AT+MQTTSUB")) {
+        if (!mqttConnected || args.size() < 2) {
+            reply("\r\nERROR\r\n");
+            return;
+        }
+        topics.insert(args[1]);
+        reply("\r\nOK\r\n");
+    } else if (line.startsWith("AT+MQTTPUBRAW")) {
+        if (!mqttConnected || args.size() < 3 || args[2].toInt() <= 0) {
+            reply("\r\nERROR\r\n");
+            return;
+        }
+        rawTopic = args[1];
+        rawPayload.clear();
+        rawRemaining = args[2].toInt();
+        reply("\r\nOK\r\n\r\n>");
+    } else if (line.startsWith("AT+MQTTPUB")) {
+        if (!mqttConnected || args.size() < 3) {
+            reply("\r\nERROR\r\n");
+            return;
+        }
+        publishes++;
+        publishBytes += args[2].size();
+        emit published(args[1], args[2]);
+        reply("\r\nOK\r\n");
+    } else {
+        reply("\r\nERROR\r\n");
+    }
+}
+
+/**
+ * @brief AT+MQTTPUBRAW数据接收完成
+ */
+void Esp8266Simulator::finishRawPublish()
+{
+    if (!mqttConnected) {
+        reply("\r\n+MQTTPUB:FAIL\r\n");
+        return;
+    }
+    publishes++;
+    publishBytes += rawPayload.size();
+    emit published(rawTopic, rawPayload);
+    reply("\r\n+MQTTPUB:OK\r\n");
+}
+
+/**
+ * @brief 注入MQTT断线
+ * @details 模块上报断开并清除订阅，reconnectMs后自动重连，需要板上程序重新订阅
+ */
+void Esp8266Simulator::disconnectMqtt()
+{
+    if (!mqttConnected)
+        return;
+
+    mqttConnected = false;
+    topics.clear();
+    faults++;
+    reply("+MQTTDISCONNECTED:0\r\n");
+
+    QTimer::singleShot(options.reconnectMs, this, [this]() {
+        if (!wifiConnected || mqttConnected)
+            return;
+        mqttConnected = true;
+        reply(MqttConnected);
+    });
+}
+
+/**
+ * @brief 按顺序延迟写回响应
+ * @param text 响应内容
+ * @param extraMs 在基础时延之外增加的时延，可以为负(回显不需要时延)
+ * @details 写回时间不早于前一条响应，保证响应顺序与真实模块一致
+ */
+void Esp8266Simulator::reply(const QByteArray &text, int extraMs)
+{
+    qint64 delay = options.latencyMs + extraMs;
+    if (options.jitterMs > 0)
+        delay += QRandomGenerator::global()->bounded(options.jitterMs + 1);
+
+    qint64 at = clock.elapsed() + qMax<qint64>(delay, 0);
+    if (!replies.isEmpty())
+        at = qMax(at, replies.last().at);
+
+    Reply r = { at, text };
+    replies.append(r);
+    if (replies.size() == 1)
+        replyTimer.start((int)qMax<qint64>(at - clock.elapsed(), 0));
+}
+
+/**
+ * @brief 写回已到时间的响应
+ */
+void Esp8266Simulator::writeDue()
+{
+    qint64 now = clock.elapsed();
+    while (!replies.isEmpty() && replies.first().at <= now) {
+        QByteArray data = replies.takeFirst().data;
+        if (write(master, data.constData(), data.size()) < 0)
+            qDebug()<<"写伪终端失败"<<endl;
+    }
+    if (!replies.isEmpty())
+        replyTimer.start((int)(replies.first().at - now));
+}
+
+/**
+ * @brief 按引号外的逗号拆分参数
+ * @details 去掉引号，反斜杠转义的字符(\,和\")还原为原字符
+ */
+QList<QByteArray> Esp8266Simulator::splitArgs(const QByteArray &args)
+{
+    QList<QByteArray> fields;
+    QByteArray field;
+    bool quoted = false;
+
+    for (int i = 0; i < args.size(); i++) {
+        char c = args[i];
+        if (c == '\\' && i + 1 < args.size()) {
+            field += args[++i];
+        } else if (c == '"') {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            fields.append(field);
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    if (!args.isEmpty())
+        fields.append(field);
+    return fields;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file esp8266simulator.h
+ * @brief ESP8266 AT固件模拟器的头文件
+ * @details 在伪终端上模拟ESP8266模块的AT命令响应，板上程序通过SMARTHOME_SERIAL_PORT连接到伪终端，
+ *          不需要真实模块和云平台即可跑通连接、上传和控制命令流程
+ */
+#ifndef ESP8266SIMULATOR_H
+#define ESP8266SIMULATOR_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QTimer>
+
+/**
+ * @struct SimulatorOptions
+ * @brief 模拟器的时延和故障注入参数
+ */
+struct SimulatorOptions
+{
+    int latencyMs = 5;              ///< 每条响应的基础时延，单位ms
+    int jitterMs = 0;               ///< 在基础时延上叠加的随机时延上限，单位ms
+    double errorRate = 0;           ///< 命令回复ERROR的概率
+    double dropRate = 0;            ///< 命令没有任何回复(触发超时)的概率
+    int bootMs = 300;               ///< AT+RST到输出ready的时间，单位ms
+    int wifiMs = 1500;              ///< AT+CWJAP连接WiFi的时间，单位ms
+    int disconnectEveryMs = 0;      ///< 周期性断开MQTT的间隔，0表示不断开
+    int reconnectMs = 3000;         ///< MQTT断开后自动重连的时间，单位ms
+};
+
+/**
+ * @class Esp8266Simulator
+ * @brief ESP8266 AT固件模拟器
+ * @details 支持复位、WiFi和MQTT连接流程、AT+MQTTPUB/AT+MQTTPUBRAW发布和+MQTTSUBRECV控制命令下发。
+ *          响应按发出顺序写回，时延、ERROR、丢失响应和MQTT断线都可以注入
+ */
+class Esp8266Simulator : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param options 时延和故障注入参数
+     * @param parent 父对象指针
+     */
+    explicit Esp8266Simulator(const SimulatorOptions &options, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数
+     */
+    ~Esp8266Simulator();
+
+    /**
+     * @brief 创建伪终端
+     * @param linkPath 不为空时创建指向伪终端从设备的符号链接，便于固定串口名
+     * @return 创建成功返回true
+     */
+    bool open(const QString &linkPath = QString());
+
+    /**
+     * @brief 伪终端从设备路径，板上程序打开该路径作为串口
+     */
+    QString portPath() const;
+
+    /**
+     * @brief 向已订阅的主题下发一条消息(+MQTTSUBRECV)
+     * @param payload 消息内容，例如{"relay":"open"}
+     * @return 已连接并有订阅时返回true
+     */
+    bool inject(const QByteArray &payload);
+
+    /**
+     * @brief 输出统计信息
+     */
+    void printStats() const;
+
+signals:
+    /**
+     * @brief 板上程序发布了一条消息
+     */
+    void published(const QByteArray &topic, const QByteArray &payload);
+
+private slots:
+    void readPort();            ///< 读取板上程序写入的数据
+    void disconnectMqtt();      ///< 注入MQTT断线
+
+private:
+    void handleLine(const QByteArray &line);            ///< 处理一条AT命令
+    void reply(const QByteArray &text, int extraMs = 0);    ///< 按顺序延迟写回响应
+    void writeDue();                                    ///< 写回已到时间的响应
+    void finishRawPublish();                            ///< AT+MQTTPUBRAW数据接收完成
+    static QList<QByteArray> splitArgs(const QByteArray &args); ///< 按引号外的逗号拆分参数
+
+    SimulatorOptions options;   ///< 时延和故障注入参数
+    int master;                 ///< 伪终端主设备
+    int slave;                  ///< 保持打开的从设备，避免板上程序未连接时读到EIO
+    QString slavePath;          ///< 从设备路径
+    QString linkPath;           ///< 符号链接路径
+    QSocketNotifier *notifier;  ///< 主设备可读通知
+
+    QByteArray input;           ///< 未处理完的输入
+    int rawRemaining;           ///< AT+MQTTPUBRAW剩余待接收的字节数
+    QByteArray rawTopic;        ///< AT+MQTTPUBRAW的主题
+    QByteArray rawPayload;      ///< AT+MQTTPUBRAW已接收的数据
+
+    bool echo;                  ///< 是否回显命令(ATE1)
+    bool wifiConnected;         ///< WiFi是否已连接
+    bool mqttConnected;         ///< MQTT是否已连接
+    QSet<QByteArray> topics;    ///< 已订阅的主题
+    QTimer disconnectTimer;     ///< MQTT断线注入定时器
+
+    /**
+     * @brief 等待写回的响应
+     */
+    struct Reply {
+        qint64 at;              ///< 写回时间
+        QByteArray data;        ///< 响应内容
+    };
+    QList<Reply> replies;       ///< 按写回时间排序的响应
+    QTimer replyTimer;          ///< 响应写回定时器
+    QElapsedTimer clock;        ///< 响应排序用的时钟
+
+    quint64 commands;           ///< 收到的命令数
+    quint64 publishes;          ///< 成功的发布数
+    quint64 publishBytes;       ///< 发布的数据字节数
+    quint64 injected;           ///< 下发的消息数
+    quint64 faults;             ///< 注入的ERROR和丢失响应数
+};
+
+#endif // ESP8266SIMULATOR_H
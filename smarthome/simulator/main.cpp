@@ -0,0 +1,112 @@
+/**
+ * @file main.cpp
+ * @brief 板外模拟器入口
+ * @details 用法示例：
+ * @code
+ * ./simulator --link /tmp/ttyESP --sysfs-root /tmp/sim --inject '{"relay":"open"}' --inject-every 5000
+ * SMARTHOME_SERIAL_PORT=/tmp/ttyESP SMARTHOME_SYSFS_ROOT=/tmp/sim SMARTHOME_DATA_DIR=/tmp/sim/data ./Esp8266
+ * @endcode
+ *          在标准输入中输入一行JSON也会作为控制命令下发
+ */
+#include "esp8266simulator.h"
+#include "sysfssimulator.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("智能家居板外模拟器：伪终端ESP8266模块和模拟sysfs目录树");
+    parser.addHelpOption();
+    QCommandLineOption linkOption("link", "创建指向伪终端的符号链接", "path");
+    QCommandLineOption sysfsOption("sysfs-root", "创建模拟sysfs目录树的根目录", "dir");
+    QCommandLineOption adcOption("adc", "ADC原始值基准，约4200以上触发气体报警", "raw", "3000");
+    QCommandLineOption sensorOption("sensor-every", "传感器数据更新周期(ms)", "ms", "1000");
+    QCommandLineOption latencyOption("latency", "AT响应基础时延(ms)", "ms", "5");
+    QCommandLineOption jitterOption("jitter", "AT响应随机时延上限(ms)", "ms", "0");
+    QCommandLineOption errorOption("error-rate", "AT命令回复ERROR的概率", "p", "0");
+    QCommandLineOption dropOption("drop-rate", "AT命令不回复的概率", "p", "0");
+    QCommandLineOption bootOption("boot-ms", "复位到ready的时间(ms)", "ms", "300");
+    QCommandLineOption wifiOption("wifi-ms", "连接WiFi的时间(ms)", "ms", "1500");
+    QCommandLineOption disconnectOption("disconnect-every", "周期性断开MQTT(ms)，0为不断开", "ms", "0");
+    QCommandLineOption reconnectOption("reconnect-ms", "MQTT断开后自动重连的时间(ms)", "ms", "3000");
+    QCommandLineOption injectOption("inject", "周期性下发的控制命令JSON", "json");
+    QCommandLineOption injectEveryOption("inject-every", "控制命令下发周期(ms)", "ms", "5000");
+    QCommandLineOption quietOption("quiet", "不输出板上程序发布的数据");
+    parser.addOptions({ linkOption, sysfsOption, adcOption, sensorOption, latencyOption,
+                        jitterOption, errorOption, dropOption, bootOption, wifiOption,
+                        disconnectOption, reconnectOption, injectOption, injectEveryOption,
+                        quietOption });
+    parser.process(app);
+
+    SimulatorOptions options;
+    options.latencyMs = parser.value(latencyOption).toInt();
+    options.jitterMs = parser.value(jitterOption).toInt();
+    options.errorRate = parser.value(errorOption).toDouble();
+    options.dropRate = parser.value(dropOption).toDouble();
+    options.bootMs = parser.value(bootOption).toInt();
+    options.wifiMs = parser.value(wifiOption).toInt();
+    options.disconnectEveryMs = parser.value(disconnectOption).toInt();
+    options.reconnectMs = parser.value(reconnectOption).toInt();
+
+    /* 伪终端ESP8266模块 */
+    Esp8266Simulator esp(options);
+    if (!esp.open(parser.value(linkOption)))
+        return 1;
+    qDebug()<<"模拟串口:"<<esp.portPath()<<endl;
+
+    bool quiet = parser.isSet(quietOption);
+    QObject::connect(&esp, &Esp8266Simulator::published,
+                     [quiet](const QByteArray &topic, const QByteArray &payload) {
+        if (!quiet)
+            qDebug()<<"发布"<<topic<<payload<<endl;
+    });
+
+    /* 模拟sysfs目录树 */
+    SysfsSimulator *sysfs = nullptr;
+    if (parser.isSet(sysfsOption)) {
+        sysfs = new SysfsSimulator(parser.value(sysfsOption), &app);
+        sysfs->setAdcBase(parser.value(adcOption).toInt());
+        if (!sysfs->create())
+            return 1;
+        sysfs->start(parser.value(sensorOption).toInt());
+        qDebug()<<"模拟sysfs根目录:"<<parser.value(sysfsOption)<<endl;
+    }
+
+    /* 周期性下发控制命令 */
+    QTimer injectTimer;
+    if (parser.isSet(injectOption)) {
+        QByteArray payload = parser.value(injectOption).toUtf8();
+        QObject::connect(&injectTimer, &QTimer::timeout, [&esp, payload]() {
+            esp.inject(payload);
+        });
+        injectTimer.start(parser.value(injectEveryOption).toInt());
+    }
+
+    /* 标准输入的每一行作为控制命令下发 */
+    QSocketNotifier stdinNotifier(STDIN_FILENO, QSocketNotifier::Read);
+    QObject::connect(&stdinNotifier, &QSocketNotifier::activated, [&esp, &stdinNotifier]() {
+        char line[1024];
+        ssize_t n = read(STDIN_FILENO, line, sizeof(line));
+        if (n <= 0) {
+            stdinNotifier.setEnabled(false);
+            return;
+        }
+        QByteArray payload = QByteArray(line, (int)n).trimmed();
+        if (!payload.isEmpty() && !esp.inject(payload))
+            qDebug()<<"MQTT未连接或未订阅，无法下发"<<endl;
+    });
+
+    /* 每10秒输出一次统计 */
+    QTimer statsTimer;
+    QObject::connect(&statsTimer, &QTimer::timeout, [&esp]() { esp.printStats(); });
+    statsTimer.start(10000);
+
+    return app.exec();
+}
@@ -0,0 +1,138 @@
+/**
+ * @file sysfssimulator.cpp
+ * @brief 模拟sysfs目录树的实现文件
+ */
+#include "sysfssimulator.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* 板上程序写入的执行器文件 */
+static const char *const OutputFiles[] = {
+    "/sys/class/leds/sys-led/trigger",
+    "/sys/devices/platform/leds/leds/sys-led/brightness",
+    "/sys/devices/platform/leds/leds/beep/brightness",
+    "/sys/class/leds/relay/brightness",
+    "/sys/class/pwm/pwmchip4/export",
+    "/sys/class/pwm/pwmchip4/pwm2/period",
+    "/sys/class/pwm/pwmchip4/pwm2/duty_cycle",
+    "/sys/class/pwm/pwmchip4/pwm2/enable"
+};
+
+static const char Dht11File[] = "/sys/class/misc/dht11/value";
+static const char AdcRawFile[] = "/sys/bus/iio/devices/iio:device0/in_voltage10_raw";
+static const char AdcScaleFile[] = "/sys/bus/iio/devices/iio:device0/in_voltage_scale";
+
+/**
+ * @brief SysfsSimulator类构造函数
+ * @param root 模拟的sysfs根目录
+ * @param parent 父对象指针
+ */
+SysfsSimulator::SysfsSimulator(const QString &root, QObject *parent)
+    : QObject(parent), root(root), humidity(50), temperature(25), adcBase(3000), adc(3000)
+{
+    connect(&timer, &QTimer::timeout, this, &SysfsSimulator::update);
+}
+
+/**
+ * @brief 创建目录树和初始文件内容
+ * @details ADC缩放系数与板上3.3V参考电压、16位ADC一致
+ */
+bool SysfsSimulator::create()
+{
+    bool ok = true;
+    for (const char *file : OutputFiles)
+        ok = writeFile(file, "0\n", true) && ok;
+    ok = writeFile("/sys/class/leds/sys-led/trigger", "heartbeat\n", true) && ok;
+    ok = writeFile(AdcScaleFile, "0.050354003\n", true) && ok;
+    update();
+
+    for (const char *file : OutputFiles)
+        outputs.insert(file, readFile(file));
+    return ok;
+}
+
+/**
+ * @brief 开始更新传感器数据并监视执行器状态
+ */
+void SysfsSimulator::start(int periodMs)
+{
+    timer.start(periodMs);
+}
+
+/**
+ * @brief 设置ADC原始值的基准
+ */
+void SysfsSimulator::setAdcBase(int raw)
+{
+    adcBase = qBound(1, raw, 65535);
+    adc = adcBase;
+}
+
+/**
+ * @brief 更新传感器数据并检查执行器状态
+ * @details 温湿度每次最多变化1，ADC在基准值附近±5%波动；
+ *          DHT11文件为定长4字节"湿度温度"，ADC原始值补零为定长5位
+ */
+void SysfsSimulator::update()
+{
+    QRandomGenerator *random = QRandomGenerator::global();
+    humidity = qBound(20, humidity + random->bounded(3) - 1, 95);
+    temperature = qBound(0, temperature + random->bounded(3) - 1, 50);
+    int spread = qMax(1, adcBase / 20);
+    adc = qBound(1, adcBase + random->bounded(2 * spread + 1) - spread, 65535);
+
+    writeFile(Dht11File, QString::asprintf("%02d%02d", humidity, temperature).toLatin1());
+    writeFile(AdcRawFile, QString::asprintf("%05d\n", adc).toLatin1());
+
+    for (auto it = outputs.begin(); it != outputs.end(); ++it) {
+        QByteArray content = readFile(it.key().constData());
+        if (content != it.value()) {
+            qDebug()<<"执行器状态变化:"<<it.key()<<it.value().trimmed()<<"->"<<content.trimmed()<<endl;
+            it.value() = content;
+        }
+    }
+}
+
+/**
+ * @brief 板上路径在模拟根目录下的位置
+ */
+QString SysfsSimulator::path(const char *sysfsPath) const
+{
+    return root + QString::fromLatin1(sysfsPath);
+}
+
+/**
+ * @brief 原位置覆盖写入
+ * @details 更新时不截断、不替换文件，已打开该文件的读取方(常驻描述符)也能读到新内容；
+ *          只有创建时截断，清除上一次运行留下的内容
+ */
+bool SysfsSimulator::writeFile(const char *sysfsPath, const QByteArray &content, bool truncate)
+{
+    QString file = path(sysfsPath);
+    QDir().mkpath(QFileInfo(file).path());
+
+    int fd = ::open(QFile::encodeName(file).constData(), O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        qDebug()<<"无法创建模拟文件"<<file<<endl;
+        return false;
+    }
+    bool ok = pwrite(fd, content.constData(), content.size(), 0) == (ssize_t)content.size();
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief 读取文件内容
+ */
+QByteArray SysfsSimulator::readFile(const char *sysfsPath) const
+{
+    QFile file(path(sysfsPath));
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
@@ -0,0 +1,67 @@
+/**
+ * @file sysfssimulator.h
+ * @brief 模拟sysfs目录树的头文件
+ * @details 在普通目录下创建板上各设备使用的sysfs文件，板上程序通过SMARTHOME_SYSFS_ROOT指向该目录
+ */
+#ifndef SYSFSSIMULATOR_H
+#define SYSFSSIMULATOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+
+/**
+ * @class SysfsSimulator
+ * @brief 模拟sysfs目录树
+ * @details 创建LED、继电器、蜂鸣器、PWM、DHT11和IIO ADC的属性文件：
+ *          传感器文件按固定周期随机游走更新，更新时在原位置覆盖定长内容，
+ *          板上程序读到的总是完整的值(包括常驻描述符的读取方式)；
+ *          执行器文件被板上程序写入后输出状态变化
+ */
+class SysfsSimulator : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param root 模拟的sysfs根目录
+     * @param parent 父对象指针
+     */
+    explicit SysfsSimulator(const QString &root, QObject *parent = nullptr);
+
+    /**
+     * @brief 创建目录树和初始文件内容
+     * @return 创建成功返回true
+     */
+    bool create();
+
+    /**
+     * @brief 开始更新传感器数据并监视执行器状态
+     * @param periodMs 更新周期，单位ms
+     */
+    void start(int periodMs);
+
+    /**
+     * @brief 设置ADC原始值的基准(对应空气质量)，用于模拟气体浓度报警
+     */
+    void setAdcBase(int raw);
+
+private slots:
+    void update();      ///< 更新传感器数据并检查执行器状态
+
+private:
+    QString path(const char *sysfsPath) const;  ///< 板上路径在模拟根目录下的位置
+    bool writeFile(const char *sysfsPath, const QByteArray &content, bool truncate = false);  ///< 原位置覆盖写入
+    QByteArray readFile(const char *sysfsPath) const;   ///< 读取文件内容
+
+    QString root;                   ///< 模拟的sysfs根目录
+    QTimer timer;                   ///< 更新定时器
+    int humidity;                   ///< 当前湿度
+    int temperature;                ///< 当前温度
+    int adcBase;                    ///< ADC原始值基准
+    int adc;                        ///< 当前ADC原始值
+    QHash<QByteArray, QByteArray> outputs;  ///< 执行器文件的上一次内容
+};
+
+#endif // SYSFSSIMULATOR_H
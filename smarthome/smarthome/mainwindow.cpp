@@ -1,5 +1,27 @@
 #include "mainwindow.h"
 #include <unistd.h>
+#include <QDateTime>
+#include <QStyle>
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cmath>
+#include "telemetryscanner.h"
+
+/* 逐条消息的调试输出，默认关闭，QT_LOGGING_RULES="smarthome.messages.debug=true"打开 */
+Q_LOGGING_CATEGORY(lcmessages, "smarthome.messages", QtInfoMsg)
+
+/* 控制命令发布主题 */
+static const char CommandTopic[] = "/k25r9vo1EmV/QtDesktop/user/update";
+/* 控制命令超过该时间没有确认则认为丢失，单位ms */
+static const qint64 CommandTimeoutMs = 5000;
+/* 经局域网发送的控制命令超过该时间没有确认，改经云端重发，单位ms */
+static const qint64 LanAckTimeoutMs = 500;
+/* 控制命令合并窗口，窗口内的连续点击合并为一条消息，单位ms */
+static const int CommandCoalesceMs = 200;
+/* 请求全量快照后超过该时间仍未收到，认为请求或快照丢失，允许再次请求，单位ms */
+static const qint64 SnapshotTimeoutMs = 3000;
+/* 计算控制延迟百分位数保留的最近延迟个数 */
+static const int LatencySamples = 256;
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -10,6 +32,18 @@ MainWindow::MainWindow(QWidget *parent)
     /* 连接MQTT服务器 */
     ConnectMQTT();  // 建立与阿里云物联网平台的MQTT连接
 
+    /*
+     * 局域网链路，默认连接开发板的mDNS主机名，控制命令和设备影子不经过云平台；
+     * 环境变量SMARTHOME_LAN_BROKER=主机:端口可以指定其它服务器，设为空则只使用云端
+     */
+    lan = new LanLink(LanLink::defaultBroker("smarthome.local"), "k25r9vo1EmV.QtDesktop.lan", this);
+    lan->subscribe(LanLink::ShadowTopic);
+    connect(lan, &LanLink::messageReceived, this, &MainWindow::MessageReceived);
+    connect(lan, &LanLink::connected, this, [this]() {
+        qDebug()<<"连接局域网MQTT服务器成功"<<endl;
+        RequestSnapshot(true);
+    });
+
     /* 连接成功处理 */
     connect(client, &QMqttClient::connected, this, &MainWindow::ConnectionSucceeded);
     /* 主题接收到消息处理 */
@@ -31,6 +65,22 @@ MainWindow::MainWindow(QWidget *parent)
     connect(curtainopen, &QPushButton::clicked, this, &MainWindow::CurtainControl);
     connect(curtainclose, &QPushButton::clicked, this, &MainWindow::CurtainControl);
     connect(curtainstop, &QPushButton::clicked, this, &MainWindow::CurtainControl);
+
+    /* 控制命令确认超时检查，延迟分布用于衡量云端链路的控制延迟 */
+    commandlatency = Metrics::histogram("panel.command_latency_us");
+    commandtimer = new QTimer(this);
+    connect(commandtimer, &QTimer::timeout, this, &MainWindow::CheckPendingCommands);
+    commandtimer->start(100);
+    coalescetimer = new QTimer(this);
+    coalescetimer->setSingleShot(true);
+    connect(coalescetimer, &QTimer::timeout, this, &MainWindow::FlushCommands);
+
+    /* 本地历史数据，每分钟刷新一次 */
+    history = new TimeSeriesStore(true);
+    historytimer = new QTimer(this);
+    connect(historytimer, &QTimer::timeout, this, &MainWindow::UpdateHistory);
+    historytimer->start(60000);
+    UpdateHistory();
 }
 
 MainWindow::~MainWindow()
@@ -47,45 +97,159 @@ void MainWindow::ConnectionSucceeded()
 
     /* 订阅主题 */
     subscribeTopic("/k25r9vo1EmV/QtDesktop/user/get");
+    subscribeTopic("/k25r9vo1EmV/QtDesktop/user/shadow");
+
+    /* 请求全量影子，按钮显示开发板上执行器的实际状态 */
+    shadowepoch = -1;
+    snapshotrequested = QDateTime::currentMSecsSinceEpoch();
+    publicMessage(CommandTopic, "{\"shadow\":\"get\"}");
 }
 
 /* 
  * 主题接收到消息处理
  * @param message 接收到的MQTT消息内容
  * @param topic 消息来源的主题名称
+ * 支持两种数据格式，界面只显示最新的一条数据：
+ * v1: {"ts":..,"temperature":..,"humidity":..,"ppm":..,"ppmmax":..}，每条消息一条数据
+ * v2: {"v":2,"t0":..,"d":[[dt,温度,湿度,ppm,ppm最大值],...]}，每条消息多条数据，没有的值为null
+ * 带"shadow"键的消息为执行器状态影子，交给ShadowReceived处理。
+ * 上传数据直接在消息缓冲区上扫描需要的三个字段，不构造QJsonDocument；
+ * 只有显示内容变化的控件才更新，ppm超标的颜色通过属性切换，只在状态变化时重新应用样式
  */
 void MainWindow::MessageReceived(const QByteArray &message, const QMqttTopicName &topic)
 {
-    qDebug()<<"主题受到消息 "<<topic.name()<<": "<<message<<endl;
+    qCDebug(lcmessages)<<"主题收到消息 "<<topic.name()<<": "<<message;
 
-    /* 解析Json数据 */
-    QJsonDocument doc = QJsonDocument::fromJson(message);
-    if(doc.isObject()) {
+    Telemetry telemetry;
+    Telemetry::Kind kind = scanTelemetry(message.constData(), message.size(), telemetry);
+    if (kind == Telemetry::Invalid) {
+        qCDebug(lcmessages)<<"Invalid JSON received.";
+        return;
+    }
+
+    /* 收到第一条有效消息后显示系统名称，之后不再重复设置 */
+    if (!online) {
         this->homename->setText("云启慧居");
-        QJsonObject jsonObject = doc.object();
+        online = true;
+    }
 
-        int temperature = jsonObject["temperature"].toInt();
-        int humidity = jsonObject["humidity"].toInt();
-        float ppm = jsonObject["ppm"].toDouble();
+    if (kind == Telemetry::Shadow) {
+        ShadowReceived(QJsonDocument::fromJson(message).object());
+        return;
+    }
 
-        qDebug()<< "temperature: "<< temperature << "humidity: " << humidity << "ppm: " << ppm << endl;
+    if (telemetry.hasTemperature) {
+        int temperature = qRound(telemetry.temperature);
+        if (temperature != showntemperature) {
+            showntemperature = temperature;
+            this->temperature->setText(QString::number(temperature) + " \u2103");
+            this->thermometer->setValue(temperature);
+        }
+    }
 
-        this->temperature->setText(QString::number(temperature) + " \u2103");
-        this->thermometer->setValue(temperature);
+    if (telemetry.hasHumidity) {
+        int humidity = qRound(telemetry.humidity);
+        if (humidity != shownhumidity) {
+            shownhumidity = humidity;
+            this->humidity->setText(QString::number(humidity) + " %RH");
+        }
+    }
 
-        this->humidity->setText(QString::number(humidity) + " %RH");
+    if (telemetry.hasPpm) {
+        /* 显示到0.1ppm，小于显示精度的波动不刷新 */
+        int tenths = qRound(telemetry.ppm * 10);
+        if (tenths != shownppm) {
+            shownppm = tenths;
+            this->ppm->setText(QString::number(tenths / 10.0, 'f', 1) + " ppm");
+        }
 
-        this->ppm->setText(QString::number(ppm) + " ppm");
-        if(ppm >= 10) {
-            this->ppm->setStyleSheet("color: red;");
-        } else {
-            this->ppm->setStyleSheet("color: white;");
+        bool alarm = telemetry.ppm >= 10;
+        if (alarm != this->ppm->property("alarm").toBool()) {
+            this->ppm->setProperty("alarm", alarm);
+            this->ppm->style()->unpolish(this->ppm);
+            this->ppm->style()->polish(this->ppm);
         }
-    } else {
-        qDebug()<<"Invalid JSON received."<<endl;
     }
 }
 
+/*
+ * 处理设备影子
+ * @param shadow {"shadow":版本号,"epoch":启动时间,"full":true,"state":{设备id:状态,...}}
+ * 全量快照或开发板重启(epoch变化)后从快照重新开始；增量必须紧接已应用的版本号，
+ * 旧的或重复的增量直接丢弃，版本号不连续(中间的增量丢失)时请求全量快照；
+ * 命令确认("acks")与版本号无关，每条消息都先处理
+ */
+void MainWindow::ShadowReceived(const QJsonObject &shadow)
+{
+    for (const QJsonValue &ack : shadow["acks"].toArray())
+        CommandAcknowledged(ack.toObject());
+
+    qint64 version = (qint64)shadow["shadow"].toDouble();
+    qint64 epoch = (qint64)shadow["epoch"].toDouble();
+    bool full = shadow["full"].toBool();
+
+    if (full) {
+        if (epoch == shadowepoch && version <= shadowversion)
+            return;
+    } else if (epoch != shadowepoch || version > shadowversion + 1) {
+        qDebug()<<"设备影子版本不连续，请求全量快照"<<endl;
+        RequestSnapshot();
+        return;
+    } else if (version <= shadowversion) {
+        return;
+    }
+
+    if (full)
+        snapshotrequested = 0;
+    shadowepoch = epoch;
+    shadowversion = version;
+    ApplyShadowState(shadow["state"].toObject());
+}
+
+/*
+ * 请求全量快照
+ * @param force 链路刚建立时为true，不管是否在等待快照都重新请求
+ * 收到全量快照之前不重复请求：连续丢失多条增量、多条命令失败或超时只产生一次请求；
+ * 超过SnapshotTimeoutMs仍未收到快照时允许再次请求
+ */
+void MainWindow::RequestSnapshot(bool force)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (!force && snapshotrequested > 0 && now - snapshotrequested < SnapshotTimeoutMs)
+        return;
+    snapshotrequested = now;
+    PublishCommand("{\"shadow\":\"get\"}");
+}
+
+/*
+ * 只刷新影子中变化的控件
+ * @param state 设备id到状态的映射，开关为true/false，窗帘为位置百分比，null表示状态未知
+ * 更新开关时屏蔽toggled信号，避免把开发板上报的状态又作为控制命令发回去
+ */
+void MainWindow::ApplyShadowState(const QJsonObject &state)
+{
+    if (state["livingroomlump"].isBool()) {
+        bool on = state["livingroomlump"].toBool();
+        if (livingroomlumpswitch->isChecked() != on) {
+            QSignalBlocker blocker(livingroomlumpswitch);
+            livingroomlumpswitch->setChecked(on);
+            LumpStatusImageChange(on);
+        }
+    }
+
+    if (state["relay"].isBool()) {
+        bool on = state["relay"].toBool();
+        if (relayswitch->isChecked() != on) {
+            QSignalBlocker blocker(relayswitch);
+            relayswitch->setChecked(on);
+            RelayStatusImageChange(on);
+        }
+    }
+
+    if (state["curtain"].isDouble())
+        curtainname->setText(QString("窗帘 %1%").arg(state["curtain"].toInt()));
+}
+
 /* 
  * 客户端错误处理
  * @param error MQTT客户端错误代码
@@ -121,11 +285,7 @@ void MainWindow::publicMessage(QString topic, QString mes)
  */
 void MainWindow::LivingroomlumpControls(bool checked)
 {
-    if (checked) {
-        publicMessage("/k25r9vo1EmV/QtDesktop/user/update", "{\"livingroomlump\":\"open\"}");
-    } else {
-        publicMessage("/k25r9vo1EmV/QtDesktop/user/update", "{\"livingroomlump\":\"close\"}");
-    }
+    SendCommand("livingroomlump", checked ? "open" : "close");
 }
 
 /* 
@@ -146,11 +306,7 @@ void MainWindow::LumpStatusImageChange(bool checked)
  */
 void MainWindow::RelayControls(bool checked)
 {
-    if (checked) {
-        publicMessage("/k25r9vo1EmV/QtDesktop/user/update", "{\"relay\":\"open\"}");
-    } else {
-        publicMessage("/k25r9vo1EmV/QtDesktop/user/update", "{\"relay\":\"close\"}");
-    }
+    SendCommand("relay", checked ? "open" : "close");
 }
 
 /* 
@@ -174,11 +330,237 @@ void MainWindow::CurtainControl()
     QPushButton *button = qobject_cast<QPushButton*>(sender());
 
     if(button == curtainopen) {
-        publicMessage("/k25r9vo1EmV/QtDesktop/user/update", "{\"curtain\":\"open\"}");
+        SendCommand("curtain", "open");
     } else if(button == curtainstop) {
-        publicMessage("/k25r9vo1EmV/QtDesktop/user/update", "{\"curtain\":\"stop\"}");
+        SendCommand("curtain", "stop");
     } else if(button == curtainclose) {
-        publicMessage("/k25r9vo1EmV/QtDesktop/user/update", "{\"curtain\":\"close\"}");
+        SendCommand("curtain", "close");
+    }
+}
+
+/*
+ * 发送控制命令
+ * @param device 设备id
+ * @param value 控制命令值
+ * 空闲时立即发送；上一条消息发送后CommandCoalesceMs内的命令先合并，每个设备只保留最后的值，
+ * 窗口结束时作为一条消息发送，连续点击时最终状态一定会发出，且不会产生一次点击一条消息
+ */
+void MainWindow::SendCommand(QString device, QJsonValue value)
+{
+    if (queuedcommands.isEmpty())
+        queuedts = QDateTime::currentMSecsSinceEpoch();
+    queuedcommands.insert(device, value);
+    SetPending(device);
+
+    if (!coalescetimer->isActive())
+        FlushCommands();
+}
+
+/*
+ * 把合并的控制命令作为一条消息发布
+ * 命令带上递增的id和第一次点击的时间，例如{"relay":"open","livingroomlump":"close","id":7,"ts":1737095730012}，
+ * 开发板执行后在设备影子中返回确认；确认之前设备控件显示为等待状态。
+ * 发布后开始新的合并窗口，窗口内没有新命令时定时器到期后不再发布
+ */
+void MainWindow::FlushCommands()
+{
+    static MetricCounter *merged = Metrics::counter("panel.commands_merged");
+
+    if (queuedcommands.isEmpty())
+        return;
+
+    int id = nextcommandid++;
+    QJsonObject command = queuedcommands;
+    command.insert("id", id);
+    command.insert("ts", queuedts);
+    QByteArray message = QJsonDocument(command).toJson(QJsonDocument::Compact);
+    bool overlan = PublishCommand(message);
+
+    pendingcommands.insert(id, PendingCommand{queuedcommands.keys(), queuedts, message, overlan});
+    if (queuedcommands.size() > 1)
+        merged->add(queuedcommands.size() - 1);
+    queuedcommands = QJsonObject();
+    coalescetimer->start(CommandCoalesceMs);
+}
+
+/*
+ * 发布控制命令
+ * @param message 控制命令JSON
+ * @return 经局域网发布返回true；局域网未连接时经云端发布，返回false
+ */
+bool MainWindow::PublishCommand(const QByteArray &message)
+{
+    if (lan->publish(LanLink::CommandTopic, message))
+        return true;
+    publicMessage(CommandTopic, message);
+    return false;
+}
+
+/*
+ * 处理控制命令确认
+ * @param ack {"id":命令id,"ts":第一次点击的时间,"ok":是否执行成功}
+ * 从点击到开发板执行完成的延迟记录到直方图(另按局域网/云端分开统计)并导出到运行指标；
+ * 两条链路都送达的重复确认找不到对应的命令，直接忽略；
+ * 执行失败时请求全量影子，把开关恢复为开发板上的实际状态
+ */
+void MainWindow::CommandAcknowledged(const QJsonObject &ack)
+{
+    static MetricHistogram *lanlatency = Metrics::histogram("panel.command_latency_lan_us");
+    static MetricHistogram *cloudlatency = Metrics::histogram("panel.command_latency_cloud_us");
+
+    int id = ack["id"].toInt();
+    auto it = pendingcommands.find(id);
+    if (it == pendingcommands.end())
+        return;
+
+    QStringList devices = it->devices;
+    qint64 latency = QDateTime::currentMSecsSinceEpoch() - it->ts;
+    bool overlan = it->lan;
+    pendingcommands.erase(it);
+    for (const QString &device : devices)
+        SetPending(device);
+
+    if (!ack["ok"].toBool()) {
+        qDebug()<<"控制命令执行失败: "<<devices<<endl;
+        RequestSnapshot();
+        return;
+    }
+
+    latency = qMax<qint64>(latency, 0);
+    quint64 latencyus = latency * 1000;
+    commandlatency->record(latencyus);
+    (overlan ? lanlatency : cloudlatency)->record(latencyus);
+    RecordLatency(latency);
+}
+
+/*
+ * 记录一次控制延迟并刷新提示中的百分位数
+ * @param latency 延迟，单位ms
+ * 直方图的百分位数只是桶的上界，提示中的百分位数由最近LatencySamples次的原始延迟排序得到
+ */
+void MainWindow::RecordLatency(qint64 latency)
+{
+    if (latencysamples.size() < LatencySamples) {
+        latencysamples.append(latency);
+    } else {
+        latencysamples[latencynext] = latency;
+    }
+    latencynext = (latencynext + 1) % LatencySamples;
+
+    QVector<qint64> sorted = latencysamples;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        /* 最近秩法：不小于p比例样本的最小值 */
+        int index = qBound(0, (int)std::ceil(p * sorted.size()) - 1, sorted.size() - 1);
+        return sorted[index];
+    };
+    homename->setToolTip(QString("控制延迟(最近%1次，共%2次)\nP50: %3 ms\nP90: %4 ms\nP99: %5 ms")
+                         .arg(sorted.size())
+                         .arg(commandlatency->count())
+                         .arg(percentile(0.5))
+                         .arg(percentile(0.9))
+                         .arg(percentile(0.99)));
+}
+
+/*
+ * 超时未确认的控制命令处理
+ * 经局域网发送超过LanAckTimeoutMs未确认的命令原样经云端重发，开发板按id去重，两条链路都送达时只执行一次；
+ * 超过CommandTimeoutMs仍未确认则放弃等待并请求全量影子，按钮以开发板上的实际状态为准
+ */
+void MainWindow::CheckPendingCommands()
+{
+    static MetricCounter *timeouts = Metrics::counter("panel.command_timeouts");
+    static MetricCounter *fallbacks = Metrics::counter("panel.lan_fallbacks");
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QStringList devices;
+    for (auto it = pendingcommands.begin(); it != pendingcommands.end();) {
+        if (it->lan && now - it->ts >= LanAckTimeoutMs) {
+            fallbacks->add();
+            qDebug()<<"局域网未确认，经云端重发: "<<it->devices<<endl;
+            publicMessage(CommandTopic, it->message);
+            it->lan = false;
+        }
+        if (now - it->ts < CommandTimeoutMs) {
+            ++it;
+            continue;
+        }
+        timeouts->add();
+        qDebug()<<"控制命令超时未确认: "<<it->devices<<endl;
+        devices.append(it->devices);
+        it = pendingcommands.erase(it);
+    }
+
+    if (devices.isEmpty())
+        return;
+    for (const QString &device : devices)
+        SetPending(device);
+    RequestSnapshot();
+}
+
+/*
+ * 刷新设备控件的等待状态
+ * @param device 设备id
+ * 该设备还有尚未发送或未确认的命令时，控件的pending属性为true，由样式表显示虚线边框
+ */
+void MainWindow::SetPending(QString device)
+{
+    QWidget *widget = device == "livingroomlump" ? lumpwidget
+                    : device == "relay" ? relaywidget
+                    : device == "curtain" ? curtainwidget : nullptr;
+    if (!widget)
+        return;
+
+    bool pending = queuedcommands.contains(device);
+    for (auto it = pendingcommands.constBegin(); !pending && it != pendingcommands.constEnd(); ++it)
+        pending = it->devices.contains(device);
+    if (widget->property("pending").toBool() == pending)
+        return;
+
+    widget->setProperty("pending", pending);
+    widget->style()->unpolish(widget);
+    widget->style()->polish(widget);
+}
+
+/* 
+ * 刷新历史数据
+ * 从开发板本地时序数据存储中查询最近一小时的每分钟聚合，
+ * 在温度、湿度、空气质量控件的提示中显示最低、最高和平均值
+ */
+void MainWindow::UpdateHistory()
+{
+    struct {
+        const char *metric;
+        QWidget *widget;
+        const char *unit;
+    } items[] = {
+        { "temperature", tempwidget[1], " \u2103" },
+        { "humidity", humiditywidget, " %RH" },
+        { "ppm", ppmwidget, " ppm" },
+    };
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (auto &item : items) {
+        /* 不在开发板上运行时没有本地数据，下次刷新再尝试打开 */
+        if (!history->addMetric(item.metric, 0))
+            continue;
+
+        QVector<TsAggregate> minutes = history->aggregate(item.metric, now - 3600000, now, 60000);
+        if (minutes.isEmpty())
+            continue;
+
+        float min = minutes[0].min, max = minutes[0].max;
+        double sum = 0;
+        int count = 0;
+        for (const TsAggregate &minute : minutes) {
+            min = qMin(min, minute.min);
+            max = qMax(max, minute.max);
+            sum += (double)minute.avg * minute.count;
+            count += minute.count;
+        }
+
+        item.widget->setToolTip(QString("最近1小时\n最低: %1%4\n最高: %2%4\n平均: %3%4")
+                                .arg(min).arg(max).arg(sum / count, 0, 'f', 1).arg(item.unit));
     }
 }
 
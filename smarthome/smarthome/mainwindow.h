@@ -8,6 +8,7 @@
 #include <QtMqtt/qmqttmessage.h>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLayout>
@@ -18,6 +19,14 @@
 #include <QPixmap>
 #include <QProgressBar>
 #include <QDebug>
+#include <QTimer>
+#include <QSignalBlocker>
+#include <QHash>
+#include <QVector>
+#include <climits>
+#include "../tsstore/timeseriesstore.h"
+#include "../metrics/metrics.h"
+#include "../lan/lanlink.h"
 
 class MainWindow : public QMainWindow
 {
@@ -29,6 +38,7 @@ public:
 
 private:
     QMqttClient *client;                 // mqtt客户端
+    LanLink *lan;                        // 局域网mqtt链路，直接连接开发板上的服务器
 
     /* 主窗口相关变量 */
     QWidget *mainwidget;                 // 主窗口
@@ -36,6 +46,7 @@ private:
     QHBoxLayout *hboxlayout[4];
     QVBoxLayout *mainvboxlayout;         // 主窗口采用垂直布局
     QLabel *homename;                    // 智能家居系统名称
+    bool online = false;                 // 是否已收到有效消息，系统名称只设置一次
 
     /* 客厅灯相关变量 */
     QWidget *lumpwidget;                 // 客厅灯窗口部件
@@ -50,17 +61,20 @@ private:
     QLabel *temperature;                 // 温度数字
     QLabel *tempname;                    // 温度名字
     QProgressBar *thermometer;           // 温度计
+    int showntemperature = INT_MIN;      // 当前显示的温度
 
     /* 湿度相关变量 */
     QWidget *humiditywidget;
     QLabel *humidityname;
     QLabel *humidity;
+    int shownhumidity = INT_MIN;          // 当前显示的湿度
     QVBoxLayout *humidityvboxlayout;
 
     /* ppm相关变量 */
     QWidget *ppmwidget;
     QLabel *ppmname;
     QLabel *ppm;
+    int shownppm = INT_MIN;               // 当前显示的ppm，单位0.1ppm
     QVBoxLayout *ppmvboxlayout;
 
     /* 继电器相关变量 */
@@ -79,9 +93,43 @@ private:
     QHBoxLayout *controlhboxlayout;
     QVBoxLayout *curtainvboxlayout;
 
+    /* 设备影子相关变量 */
+    qint64 shadowepoch = -1;              // 开发板本次启动的时间，-1表示尚未收到全量快照
+    qint64 shadowversion = 0;             // 已应用的影子版本号
+    qint64 snapshotrequested = 0;         // 最近一次请求全量快照的时间，0表示没有在等待快照
+
+    /* 控制命令确认相关变量 */
+    struct PendingCommand {
+        QStringList devices;              // 命令中的设备id
+        qint64 ts;                        // 第一次点击的时间
+        QByteArray message;               // 已发布的消息，局域网确认超时后原样经云端重发
+        bool lan;                         // 是否经局域网发送
+    };
+    QHash<int, PendingCommand> pendingcommands; // 已发送、尚未确认的控制命令
+    int nextcommandid = 1;                // 下一条控制命令的id
+    QTimer *commandtimer;                 // 控制命令确认超时检查定时器
+    QJsonObject queuedcommands;           // 合并窗口内尚未发送的控制命令，每个设备只保留最后的值
+    qint64 queuedts = 0;                  // 尚未发送的控制命令中第一次点击的时间
+    QTimer *coalescetimer;                // 控制命令合并窗口定时器
+    MetricHistogram *commandlatency;      // 从点击到开发板执行完成的延迟
+    QVector<qint64> latencysamples;       // 最近LatencySamples次控制的原始延迟(ms)，环形使用，百分位数按此精确计算
+    int latencynext = 0;                  // 下一个延迟写入latencysamples的位置
+
+    /* 本地历史数据相关变量 */
+    TimeSeriesStore *history;             // 本地时序数据(只读)
+    QTimer *historytimer;                 // 历史数据刷新定时器
+
     void ConnectMQTT();                             // 连接阿里云物联网平台
     void subscribeTopic(QString topic);             // 订阅主题
     void publicMessage(QString topic, QString mes); // 发布消息
+    void ShadowReceived(const QJsonObject &shadow); // 处理设备影子
+    void RequestSnapshot(bool force = false);       // 请求全量快照，等待快照期间不重复请求
+    void SendCommand(QString device, QJsonValue value); // 发送控制命令，连续点击合并发送
+    bool PublishCommand(const QByteArray &message);  // 优先经局域网发布控制命令，返回是否经局域网
+    void CommandAcknowledged(const QJsonObject &ack);   // 处理控制命令确认
+    void RecordLatency(qint64 latency);              // 记录一次控制延迟并刷新提示中的百分位数
+    void SetPending(QString device);                // 按未确认的命令刷新设备控件的等待状态
+    void ApplyShadowState(const QJsonObject &state);// 只刷新影子中变化的控件
 
     void InterfaceLayout();                         // 界面布局
     void LumpInterfaceLayout();                     // 客厅灯部分的界面布局
@@ -103,5 +151,9 @@ private slots:
     void RelayStatusImageChange(bool checked);          // 继电器状态图片改变
 
     void CurtainControl();                              // 窗帘控制
+    void CheckPendingCommands();                        // 超时未确认的控制命令处理
+    void FlushCommands();                               // 把合并的控制命令作为一条消息发布
+
+    void UpdateHistory();                               // 刷新最近一小时的历史数据
 };
 #endif // MAINWINDOW_H
@@ -17,10 +17,12 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    telemetryscanner.cpp
 
 HEADERS += \
-    mainwindow.h
+    mainwindow.h \
+    telemetryscanner.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -29,3 +31,7 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 
 RESOURCES += \
     resource.qrc
+
+include(../tsstore/tsstore.pri)
+include(../metrics/metrics.pri)
+include(../lan/lan.pri)
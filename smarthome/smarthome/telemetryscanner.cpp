@@ -0,0 +1,316 @@
+/**
+ * @file telemetryscanner.cpp
+ * @brief 上传数据字段扫描函数的实现文件
+ */
+#include "telemetryscanner.h"
+#include <cstring>
+
+namespace {
+
+/* 解析的最大十进制指数，double的最大值约为1.8e308 */
+const int MaxExponent = 308;
+
+/**
+ * @brief 扫描位置
+ */
+struct Cursor
+{
+    const char *p;      ///< 当前位置
+    const char *end;    ///< 数据末尾
+};
+
+/**
+ * @brief 跳过空白字符
+ */
+void skipSpace(Cursor &c)
+{
+    while (c.p < c.end && (*c.p == ' ' || *c.p == '\t' || *c.p == '\n' || *c.p == '\r'))
+        c.p++;
+}
+
+/**
+ * @brief 当前字符是否为ch，是则跳过
+ */
+bool consume(Cursor &c, char ch)
+{
+    skipSpace(c);
+    if (c.p < c.end && *c.p == ch) {
+        c.p++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 跳过一个字符串，当前位置为开头的引号
+ * @param key 输出字符串内容的起始位置，可以为空
+ * @param length 输出字符串内容的长度(不处理转义)
+ */
+bool skipString(Cursor &c, const char **key = nullptr, int *length = nullptr)
+{
+    const char *start = ++c.p;
+    while (c.p < c.end && *c.p != '"') {
+        if (*c.p == '\\')
+            c.p++;
+        c.p++;
+    }
+    if (c.p >= c.end)
+        return false;
+    if (key) {
+        *key = start;
+        *length = (int)(c.p - start);
+    }
+    c.p++;
+    return true;
+}
+
+/**
+ * @brief 解析一个数值
+ * @details 按JSON数值格式解析，与区域设置无关；指数限制在MaxExponent以内
+ */
+bool parseNumber(Cursor &c, double &value)
+{
+    bool negative = false;
+    if (c.p < c.end && *c.p == '-') {
+        negative = true;
+        c.p++;
+    }
+    if (c.p >= c.end || *c.p < '0' || *c.p > '9')
+        return false;
+
+    double result = 0;
+    while (c.p < c.end && *c.p >= '0' && *c.p <= '9')
+        result = result * 10 + (*c.p++ - '0');
+
+    if (c.p < c.end && *c.p == '.') {
+        c.p++;
+        double scale = 0.1;
+        while (c.p < c.end && *c.p >= '0' && *c.p <= '9') {
+            result += (*c.p++ - '0') * scale;
+            scale /= 10;
+        }
+    }
+
+    if (c.p < c.end && (*c.p == 'e' || *c.p == 'E')) {
+        c.p++;
+        bool negativeExp = false;
+        if (c.p < c.end && (*c.p == '+' || *c.p == '-'))
+            negativeExp = *c.p++ == '-';
+        /* 指数超过double的范围时结果已是无穷大或0，不再累加，避免溢出 */
+        int exponent = 0;
+        while (c.p < c.end && *c.p >= '0' && *c.p <= '9') {
+            if (exponent <= MaxExponent)
+                exponent = exponent * 10 + (*c.p - '0');
+            c.p++;
+        }
+        if (exponent > MaxExponent)
+            exponent = MaxExponent;
+
+        /* 按二进制位平方求10的幂，乘法次数与指数的位数成正比 */
+        double factor = 1;
+        double base = 10;
+        for (; exponent > 0; exponent >>= 1, base *= base) {
+            if (exponent & 1)
+                factor *= base;
+        }
+        result = negativeExp ? result / factor : result * factor;
+    }
+
+    value = negative ? -result : result;
+    return true;
+}
+
+/**
+ * @brief 解析一个可以为null的数值
+ * @param present 输出是否为数值
+ */
+bool parseNullableNumber(Cursor &c, double &value, bool &present)
+{
+    skipSpace(c);
+    if (c.end - c.p >= 4 && memcmp(c.p, "null", 4) == 0) {
+        c.p += 4;
+        present = false;
+        return true;
+    }
+    present = parseNumber(c, value);
+    return present;
+}
+
+/**
+ * @brief 跳过任意一个值
+ * @details 对象和数组只按括号深度跳过，其中的字符串按引号跳过，不检查内部语法
+ */
+bool skipValue(Cursor &c)
+{
+    skipSpace(c);
+    if (c.p >= c.end)
+        return false;
+
+    if (*c.p == '"')
+        return skipString(c);
+
+    if (*c.p == '{' || *c.p == '[') {
+        int depth = 0;
+        while (c.p < c.end) {
+            char ch = *c.p;
+            if (ch == '"') {
+                if (!skipString(c))
+                    return false;
+                continue;
+            }
+            c.p++;
+            if (ch == '{' || ch == '[') {
+                depth++;
+            } else if (ch == '}' || ch == ']') {
+                if (--depth == 0)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    /* 数值、true、false、null */
+    const char *start = c.p;
+    while (c.p < c.end && *c.p != ',' && *c.p != '}' && *c.p != ']' &&
+           *c.p != ' ' && *c.p != '\t' && *c.p != '\n' && *c.p != '\r')
+        c.p++;
+    return c.p > start;
+}
+
+/**
+ * @brief 解析v2格式的一条数据[dt,温度,湿度,ppm,ppm最大值]
+ */
+bool scanRecord(Cursor &c, Telemetry &telemetry)
+{
+    if (!consume(c, '['))
+        return false;
+
+    double value;
+    bool present;
+    for (int index = 0; ; index++) {
+        if (index >= 1 && index <= 3) {
+            value = 0;
+            if (!parseNullableNumber(c, value, present))
+                return false;
+            if (index == 1) {
+                telemetry.hasTemperature = present;
+                telemetry.temperature = value;
+            } else if (index == 2) {
+                telemetry.hasHumidity = present;
+                telemetry.humidity = value;
+            } else {
+                telemetry.hasPpm = present;
+                telemetry.ppm = value;
+            }
+        } else if (!skipValue(c)) {
+            return false;
+        }
+
+        if (consume(c, ']'))
+            return true;
+        if (!consume(c, ','))
+            return false;
+    }
+}
+
+/**
+ * @brief 跳过v2格式的数据数组，记下最后一条数据的位置
+ * @param last 输出最后一条数据的起始位置，数组为空时为空
+ */
+bool scanBatch(Cursor &c, const char *&last)
+{
+    last = nullptr;
+    if (!consume(c, '['))
+        return false;
+    if (consume(c, ']'))
+        return true;
+
+    for (;;) {
+        skipSpace(c);
+        last = c.p;
+        if (!skipValue(c))
+            return false;
+        if (consume(c, ']'))
+            return true;
+        if (!consume(c, ','))
+            return false;
+    }
+}
+
+/**
+ * @brief 键是否等于name
+ */
+bool keyIs(const char *key, int length, const char *name)
+{
+    return (int)strlen(name) == length && memcmp(key, name, length) == 0;
+}
+
+} // namespace
+
+/**
+ * @brief 扫描一条消息，取出界面需要的字段
+ * @details 只扫描一遍顶层对象；v2格式的数据数组先整体跳过，最后只解析其中的最后一条
+ */
+Telemetry::Kind scanTelemetry(const char *data, int length, Telemetry &telemetry)
+{
+    Cursor c = { data, data + length };
+    telemetry = Telemetry();
+
+    if (!consume(c, '{'))
+        return Telemetry::Invalid;
+
+    double version = 1;
+    const char *last = nullptr;
+    Telemetry v1;
+    bool present;
+
+    if (!consume(c, '}')) {
+        for (;;) {
+            skipSpace(c);
+            const char *key;
+            int keyLength;
+            if (c.p >= c.end || *c.p != '"' || !skipString(c, &key, &keyLength) || !consume(c, ':'))
+                return Telemetry::Invalid;
+
+            bool ok;
+            if (keyIs(key, keyLength, "shadow")) {
+                return Telemetry::Shadow;
+            } else if (keyIs(key, keyLength, "temperature")) {
+                ok = parseNullableNumber(c, v1.temperature, present);
+                v1.hasTemperature = present;
+            } else if (keyIs(key, keyLength, "humidity")) {
+                ok = parseNullableNumber(c, v1.humidity, present);
+                v1.hasHumidity = present;
+            } else if (keyIs(key, keyLength, "ppm")) {
+                ok = parseNullableNumber(c, v1.ppm, present);
+                v1.hasPpm = present;
+            } else if (keyIs(key, keyLength, "v")) {
+                skipSpace(c);
+                ok = parseNumber(c, version);
+            } else if (keyIs(key, keyLength, "d")) {
+                ok = scanBatch(c, last);
+            } else {
+                ok = skipValue(c);
+            }
+            if (!ok)
+                return Telemetry::Invalid;
+
+            if (consume(c, '}'))
+                break;
+            if (!consume(c, ','))
+                return Telemetry::Invalid;
+        }
+    }
+
+    if (version != 2) {
+        telemetry = v1;
+        return Telemetry::Sample;
+    }
+
+    if (last) {
+        Cursor record = { last, c.end };
+        if (!scanRecord(record, telemetry))
+            return Telemetry::Invalid;
+    }
+    return Telemetry::Sample;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file telemetryscanner.h
+ * @brief 上传数据字段扫描函数的头文件
+ * @details 面板每收到一条上传数据只需要温度、湿度和ppm三个字段，
+ *          直接在消息缓冲区上扫描一遍取出这三个字段，不构造QJsonDocument，不复制数据
+ */
+#ifndef TELEMETRYSCANNER_H
+#define TELEMETRYSCANNER_H
+
+/**
+ * @struct Telemetry
+ * @brief 一条上传数据中界面需要的字段
+ */
+struct Telemetry
+{
+    /**
+     * @brief 消息类型
+     */
+    enum Kind {
+        Invalid,        ///< 不是有效的JSON对象
+        Sample,         ///< 传感器数据(v1或v2格式)
+        Shadow          ///< 设备影子，需要完整解析
+    };
+
+    bool hasTemperature = false;    ///< 是否有温度
+    bool hasHumidity = false;       ///< 是否有湿度
+    bool hasPpm = false;            ///< 是否有气体浓度
+    double temperature = 0;         ///< 温度
+    double humidity = 0;            ///< 湿度
+    double ppm = 0;                 ///< 气体浓度
+};
+
+/**
+ * @brief 扫描一条消息，取出界面需要的字段
+ * @param data 消息内容，不需要以'\0'结尾
+ * @param length 消息长度
+ * @param telemetry 输出的字段，没有出现或为null的字段对应的has标志为false
+ * @return 消息类型
+ * @details 支持两种格式：
+ *          v1: {"ts":..,"temperature":..,"humidity":..,"ppm":..,"ppmmax":..}
+ *          v2: {"v":2,"t0":..,"d":[[dt,温度,湿度,ppm,ppm最大值],...]}，只取最后一条数据
+ *          顶层对象中出现"shadow"键时立即返回Shadow，不再扫描后面的内容；
+ *          其它键的值只跳过，不解析
+ */
+Telemetry::Kind scanTelemetry(const char *data, int length, Telemetry &telemetry);
+
+#endif // TELEMETRYSCANNER_H
@@ -1,19 +1,19 @@
 #include "steeringgear.h"
-#include <unistd.h>
+#include <QDebug>
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
     SteeringGear w;
-    while(1)
-    {
-        w.SGturnClockwise();
-        sleep(1);
-        w.SGstop();
-        sleep(1);
-        w.SGcounterclockwise();
-        sleep(1);
-    }
+    /* 依次打开、移动到40%、关闭，循环往复 */
+    static const int positions[] = { 100, 40, 0 };
+    int next = 0;
+    QObject::connect(&w, &SteeringGear::motionFinished, [&](int percent) {
+        qDebug() << "position" << percent;
+        next = (next + 1) % 3;
+        QTimer::singleShot(1000, &w, [&]() { w.moveTo(positions[next]); });
+    });
+    w.moveTo(positions[next]);
     return a.exec();
 }
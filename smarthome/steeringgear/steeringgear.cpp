@@ -3,104 +3,46 @@
  * @brief 舵机控制类的实现文件
  */
 #include "steeringgear.h"
+#include "../metrics/metrics.h"
+#include "../sysfs/sysfspath.h"
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QtMath>
 
 /**
  * @brief 舵机类构造函数
  * @param parent 父对象指针
- * @details 初始化舵机相关的PWM控制文件路径
+ * @details 初始化舵机相关的PWM控制文件路径，文件在第一次运动时才打开。
+ *          上电后窗帘位置未知，假定为完全关闭，第一次完全打开或关闭后即可校准
  */
 SteeringGear::SteeringGear(QObject *parent)
+    : exported(false), travelMs(DefaultTravelMs), current(0), target(0), speed(0)
 {
     this->setParent(parent);
-    // PWM通道导出文件
-    tim1pwmexport.setFileName("/sys/class/pwm/pwmchip4/export");
-    // PWM周期设置文件
-    pwm2period.setFileName("/sys/class/pwm/pwmchip4/pwm2/period");
-    // PWM占空比设置文件
-    pwm2duty_cycle.setFileName("/sys/class/pwm/pwmchip4/pwm2/duty_cycle");
-    // PWM使能控制文件
-    pwm2enable.setFileName("/sys/class/pwm/pwmchip4/pwm2/enable");
+    // TIM1CH3对应pwmchip4的通道2
+    setChannel(sysfsPath("/sys/class/pwm/pwmchip4"), 2);
+
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, &SteeringGear::tick);
 }
 
 /**
  * @brief 控制舵机顺时针旋转
- * @details 通过设置PWM信号参数使舵机顺时针旋转
- *          1. 导出PWM通道2
- *          2. 设置PWM周期为20ms(20,000,000ns)
- *          3. 设置PWM占空比为0.5ms(500,000ns)，对应舵机顺时针旋转
- *          4. 使能PWM输出
+ * @details 打开窗帘
  */
 void SteeringGear::SGturnClockwise()
 {
-    if (!tim1pwmexport.exists()) {
-        qDebug() << "/sys/class/pwm/pwmchip4/export: 文件不存在" << endl;
-        return;
-    }
-
-    /* 打开TIM1CH3通道 */
-    if(!tim1pwmexport.open(QIODevice::WriteOnly))
-        qDebug()<<tim1pwmexport.errorString();
-    tim1pwmexport.write("2");
-    tim1pwmexport.close();
-    
-    /* 设置周期为20ms */
-    if(!pwm2period.open(QIODevice::WriteOnly))
-        qDebug()<<pwm2period.errorString();
-    pwm2period.write("20000000");
-    pwm2period.close();
-    
-    /* 设置PWM占空比,0.5ms */
-    if(!pwm2duty_cycle.open(QIODevice::WriteOnly))
-        qDebug()<<pwm2duty_cycle.errorString();
-    pwm2duty_cycle.write("500000");
-    pwm2duty_cycle.close();
-    
-    /* 使能TIM1CH3通道 */
-    if(!pwm2enable.open(QIODevice::WriteOnly))
-        qDebug()<<pwm2enable.errorString();
-    pwm2enable.write("1");
-    pwm2enable.close();
+    moveTo(100);
 }
 
 /**
  * @brief 控制舵机逆时针旋转
- * @details 通过设置PWM信号参数使舵机逆时针旋转
- *          1. 导出PWM通道2
- *          2. 设置PWM周期为20ms(20,000,000ns)
- *          3. 设置PWM占空比为2.5ms(2,500,000ns)，对应舵机逆时针旋转
- *          4. 使能PWM输出
+ * @details 关闭窗帘
  */
 void SteeringGear::SGcounterclockwise()
 {
-    if (!tim1pwmexport.exists()) {
-        qDebug() << "/sys/class/pwm/pwmchip4/export: 文件不存在" << endl;
-        return;
-    }
-
-    /* 打开TIM1CH3通道 */
-    if(!tim1pwmexport.open(QIODevice::WriteOnly))
-        qDebug()<<tim1pwmexport.errorString();
-    tim1pwmexport.write("2");
-    tim1pwmexport.close();
-    
-    /* 设置周期为20ms */
-    if(!pwm2period.open(QIODevice::WriteOnly))
-        qDebug()<<pwm2period.errorString();
-    pwm2period.write("20000000");
-    pwm2period.close();
-    
-    /* 设置PWM占空比,2.5ms */
-    if(!pwm2duty_cycle.open(QIODevice::WriteOnly))
-        qDebug()<<pwm2duty_cycle.errorString();
-    pwm2duty_cycle.write("2500000");
-    pwm2duty_cycle.close();
-    
-    /* 使能TIM1CH3通道 */
-    if(!pwm2enable.open(QIODevice::WriteOnly))
-        qDebug()<<pwm2enable.errorString();
-    pwm2enable.write("1");
-    pwm2enable.close();
+    moveTo(0);
 }
 
 /**
@@ -109,16 +51,199 @@ void SteeringGear::SGcounterclockwise()
  */
 void SteeringGear::SGstop()
 {
-    if (!pwm2enable.exists()) {
-        qDebug() << "/sys/class/pwm/pwmchip4/pwm2/enable: 文件不存在" << endl;
+    static MetricHistogram *latency = Metrics::histogram("steeringgear.write_us");
+    MetricTimer metric(latency);
+    halt();
+}
+
+/**
+ * @brief 移动窗帘到指定位置
+ * @param percent 目标位置
+ * @details 第一次运动时导出PWM通道并设置周期，之后只在开始运动时写一次使能；
+ *          立即执行第一个控制周期，命令到舵机开始转动之间没有定时器延迟
+ */
+void SteeringGear::moveTo(int percent)
+{
+    static MetricHistogram *latency = Metrics::histogram("steeringgear.write_us");
+    MetricTimer metric(latency);
+
+    percent = qBound(0, percent, 100);
+    if (percent == 0)
+        target = -HomingOvertravel;
+    else if (percent == 100)
+        target = 100 + HomingOvertravel;
+    else
+        target = percent;
+
+    if (!isMoving()) {
+        if (qAbs(target - current) < 0.5) {
+            emit motionFinished(position());
+            return;
+        }
+        if (exportChannel()) {
+            /* 周期不变时SysfsOutput不会重复写入 */
+            period.setValue(PeriodNs);
+            dutyCycle.setValue(NeutralNs);
+            enable.setState(true);
+        }
+        speed = 0;
+        clock.start();
+        timer.start(TickMs);
+    }
+    tick();
+}
+
+/**
+ * @brief 估计的当前位置
+ */
+int SteeringGear::position() const
+{
+    return qBound(0, qRound(current), 100);
+}
+
+/**
+ * @brief 目标位置
+ */
+int SteeringGear::targetPosition() const
+{
+    return qBound(0, qRound(target), 100);
+}
+
+/**
+ * @brief 是否正在运动
+ */
+bool SteeringGear::isMoving() const
+{
+    return timer.isActive();
+}
+
+/**
+ * @brief 设置全速走完全程的时间
+ */
+void SteeringGear::setTravelTime(int ms)
+{
+    travelMs = qMax(1000, ms);
+}
+
+/**
+ * @brief 设置PWM通道
+ * @param chipPath PWM控制器目录
+ * @param channel 通道号
+ */
+void SteeringGear::setChannel(const QString &chipPath, int channel)
+{
+    this->channel = channel;
+    chipDir = chipPath;
+    exported = false;
+    QString dir = chipDir + "/pwm" + QString::number(channel);
+    // PWM周期设置文件
+    period.setPath(dir + "/period");
+    // PWM占空比设置文件
+    dutyCycle.setPath(dir + "/duty_cycle");
+    // PWM使能控制文件
+    enable.setPath(dir + "/enable");
+}
+
+/**
+ * @brief 运动控制周期处理函数
+ * @details 梯形速度曲线：按加速度向期望转速靠近，期望转速受剩余行程限制(v = sqrt(2·a·剩余行程))，
+ *          因此接近目标时自动减速；转速低于舵机死区时舵机不转，直接从最低转速起步。
+ *          位置按转速对实际经过的时间积分，定时器延迟不会造成累计误差
+ */
+void SteeringGear::tick()
+{
+    /* 事件循环被长时间阻塞时限制单步时间，避免位置估计跳变 */
+    double dt = qMin<qint64>(clock.restart(), 5 * TickMs);
+    double maxSpeed = 100.0 / travelMs;
+    double minSpeed = maxSpeed * MinSpeedPercent / 100;
+    double accel = maxSpeed / RampMs;
+
+    double before = target - current;
+    current += speed * dt;
+    double remaining = target - current;
+    double direction = remaining >= 0 ? 1 : -1;
+    if (qAbs(remaining) < 0.5 || before * remaining < 0) {
+        /* 到达或在这一步越过了目标 */
+        current = target;
+        halt();
         return;
     }
 
+    double desired = direction * qMin(maxSpeed, qMax(minSpeed, qSqrt(2 * accel * qAbs(remaining))));
+    double step = accel * dt;
+    if (desired > speed)
+        speed = qMin(desired, speed + step);
+    else
+        speed = qMax(desired, speed - step);
+    if (qAbs(speed) < minSpeed)
+        speed = direction * minSpeed;
+
+    writeDuty(speed / maxSpeed);
+}
+
+/**
+ * @brief 导出PWM通道
+ * @return 通道可用返回true
+ * @details 通道目录已存在(例如程序重启或已由其它程序导出)时不写export，否则内核返回EBUSY
+ */
+bool SteeringGear::exportChannel()
+{
+    if (exported)
+        return true;
+
+    if (QDir(chipDir + "/pwm" + QString::number(channel)).exists()) {
+        exported = true;
+        return true;
+    }
+
+    QFile exportFile(chipDir + "/export");
+    if (!exportFile.exists()) {
+        qDebug() << exportFile.fileName() << ": 文件不存在" << endl;
+        return false;
+    }
+
+    /* 导出PWM通道 */
+    QByteArray number = QByteArray::number(channel);
+    if (!exportFile.open(QIODevice::WriteOnly) || exportFile.write(number) != number.size()) {
+        qDebug() << exportFile.errorString();
+        return false;
+    }
+    exportFile.close();
+    exported = true;
+    return true;
+}
+
+/**
+ * @brief 按转速写入占空比
+ * @param fraction 全速的比例，-1~1，正为顺时针(打开)方向
+ * @details 顺时针全速0.5ms，中位1.5ms，逆时针全速2.5ms；量化到DutyStepNs，变化不足一步时不写入
+ */
+bool SteeringGear::writeDuty(double fraction)
+{
+    fraction = qBound(-1.0, fraction, 1.0);
+    int duty = NeutralNs - qRound(fraction * FullSpeedNs / DutyStepNs) * DutyStepNs;
+    return dutyCycle.setValue(duty);
+}
+
+/**
+ * @brief 禁用PWM并停止定时器
+ * @details 位置估计限制在0~100之间，回零时多转的行程不计入位置
+ */
+void SteeringGear::halt()
+{
+    static MetricGauge *positionGauge = Metrics::gauge("steeringgear.position");
+
+    bool moving = timer.isActive();
+    timer.stop();
+    speed = 0;
+    current = qBound(0.0, current, 100.0);
+    target = current;
     // 禁用PWM输出，写入0表示禁用
-    if(!pwm2enable.open(QIODevice::WriteOnly))
-        qDebug()<<pwm2enable.errorString();
-    pwm2enable.write("0");
-    pwm2enable.close();
+    enable.setState(false);
+    positionGauge->set(position());
+
+    if (moving)
+        emit motionFinished(position());
 }
 
 /**
@@ -126,5 +251,6 @@ void SteeringGear::SGstop()
  */
 SteeringGear::~SteeringGear()
 {
+    timer.stop();
+    enable.setState(false);
 }
-
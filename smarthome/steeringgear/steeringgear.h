@@ -1,57 +1,134 @@
 /**
  * @file steeringgear.h
  * @brief 舵机控制类的头文件
- * @details 通过Linux系统PWM接口控制舵机的旋转
+ * @details 通过Linux系统PWM接口控制窗帘舵机(连续旋转舵机)的旋转，并估计窗帘位置
  */
 #ifndef STEERINGGEAR_H
 #define STEERINGGEAR_H
 
 #include <QObject>
-#include <QFile>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "../sysfs/sysfsoutput.h"
 
 /**
  * @class SteeringGear
  * @brief 舵机控制类
- * @details 负责控制开发板上舵机的旋转方向和停止动作
+ * @details 负责控制开发板上舵机的旋转方向和停止动作，并按运动曲线移动窗帘到指定位置。
+ *          PWM通道只导出一次，周期、占空比、使能文件的描述符常驻打开，值未变化时不写入；
+ *          运动由定时器驱动：占空比从中位(停转)按加速度逐步变化到全速，接近目标时按同样的加速度减速，
+ *          避免舵机从静止直接全速启动产生的电流冲击。
+ *          窗帘位置(0为完全关闭，100为完全打开)由转速对时间积分估计；
+ *          移动到0或100时多转一段，让窗帘顶到尽头，顺便消除累计的估计误差
  */
 class SteeringGear : public QObject
 {
     Q_OBJECT
 
 public:
+    enum {
+        PeriodNs = 20000000,        ///< PWM周期20ms
+        NeutralNs = 1500000,        ///< 中位占空比1.5ms，舵机停转
+        FullSpeedNs = 1000000,      ///< 全速时占空比与中位之差，0.5ms为顺时针全速，2.5ms为逆时针全速
+        DutyStepNs = 10000,         ///< 占空比量化步长，变化不足一步时不写入
+        TickMs = 20,                ///< 运动控制周期，与PWM周期相同
+        RampMs = 400,               ///< 从停转加速到全速的时间
+        DefaultTravelMs = 10000,    ///< 全速从完全关闭到完全打开的默认时间
+        MinSpeedPercent = 20,       ///< 运动中的最低转速(全速的百分比)，低于舵机死区时舵机不转
+        HomingOvertravel = 10       ///< 移动到两端时额外多转的行程，单位%
+    };
+
     /**
      * @brief 构造函数
      * @param parent 父对象指针
      */
     SteeringGear(QObject *parent = nullptr);
-    
+
     /**
-     * @brief 析构函数
+     * @brief 析构函数，停止舵机
      */
     ~SteeringGear();
 
     /**
      * @brief 控制舵机顺时针旋转
-     * @details 通过设置适当的PWM占空比使舵机顺时针旋转
+     * @details 相当于moveTo(100)，打开窗帘
      */
     void SGturnClockwise();    // 顺时针转
-    
+
     /**
      * @brief 控制舵机逆时针旋转
-     * @details 通过设置适当的PWM占空比使舵机逆时针旋转
+     * @details 相当于moveTo(0)，关闭窗帘
      */
     void SGcounterclockwise(); // 逆时针转
-    
+
     /**
      * @brief 停止舵机旋转
-     * @details 通过禁用PWM信号使舵机停止旋转
+     * @details 立即禁用PWM信号，位置估计停在当前值
      */
     void SGstop();             // 停转
 
+    /**
+     * @brief 移动窗帘到指定位置
+     * @param percent 目标位置，0为完全关闭，100为完全打开
+     * @details 立即开始加速，不阻塞；运动中调用会从当前速度平滑地改向新目标
+     */
+    void moveTo(int percent);
+
+    /**
+     * @brief 估计的当前位置，0~100
+     */
+    int position() const;
+
+    /**
+     * @brief 目标位置，0~100
+     */
+    int targetPosition() const;
+
+    /**
+     * @brief 是否正在运动
+     */
+    bool isMoving() const;
+
+    /**
+     * @brief 设置全速走完全程(0到100)的时间
+     * @param ms 时间，单位ms，按窗帘实际测得的时间设置
+     */
+    void setTravelTime(int ms);
+
+    /**
+     * @brief 设置PWM通道，必须在第一次运动之前调用
+     * @param chipPath PWM控制器目录，默认/sys/class/pwm/pwmchip4
+     * @param channel 通道号，默认2(TIM1CH3)
+     */
+    void setChannel(const QString &chipPath, int channel);
+
+signals:
+    /**
+     * @brief 运动结束信号
+     * @param percent 结束时估计的位置
+     */
+    void motionFinished(int percent);
+
+private slots:
+    void tick();                ///< 运动控制周期处理函数
+
 private:
-    QFile tim1pwmexport;
-    QFile pwm2period;
-    QFile pwm2duty_cycle;
-    QFile pwm2enable;
+    bool exportChannel();       ///< 导出PWM通道(只在通道目录不存在时写export)
+    bool writeDuty(double speed); ///< 按转速(-1~1，正为打开方向)写入占空比
+    void halt();                ///< 禁用PWM并停止定时器
+
+    QString chipDir;            ///< PWM控制器目录
+    int channel;                ///< PWM通道号
+    bool exported;              ///< PWM通道是否已导出
+    SysfsOutput period;         ///< PWM周期文件
+    SysfsOutput dutyCycle;      ///< PWM占空比文件
+    SysfsOutput enable;         ///< PWM使能文件
+
+    QTimer timer;               ///< 运动控制定时器
+    QElapsedTimer clock;        ///< 距离上一个控制周期的时间
+    int travelMs;               ///< 全速走完全程的时间
+    double current;             ///< 估计的位置，单位%，回零时可以超出0~100
+    double target;              ///< 运动目标，单位%，回零时在0~100之外
+    double speed;               ///< 当前转速，单位%/ms，正为打开方向
 };
 #endif // STEERINGGEAR_H
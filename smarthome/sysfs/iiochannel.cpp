@@ -0,0 +1,180 @@
+/**
+ * @file iiochannel.cpp
+ * @brief IIO通道元数据和读取类的实现文件
+ */
+#include "iiochannel.h"
+#include "sysfspath.h"
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <sys/stat.h>
+
+static QMutex cacheMutex;                       ///< 保护元数据缓存
+static QHash<QString, IioChannelInfo> cache;    ///< "设备/通道"到元数据的缓存
+static quint64 generations = 0;                 ///< 已读取的元数据版本数
+
+/**
+ * @brief 设备在sysfs中的目录
+ */
+static QString deviceDir(const QString &device)
+{
+    return sysfsPath("/sys/bus/iio/devices/" + device);
+}
+
+/**
+ * @brief 设备目录的inode，目录不存在时返回0
+ */
+static quint64 deviceInode(const QString &device)
+{
+    struct stat st;
+    if (stat(QFile::encodeName(deviceDir(device)).constData(), &st) != 0)
+        return 0;
+    return st.st_ino;
+}
+
+/**
+ * @brief 读取一个属性文件，去掉末尾换行，文件不存在时返回空
+ */
+static QByteArray readAttribute(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll().trimmed();
+}
+
+/**
+ * @brief 读取通道属性，先找通道自己的属性(in_voltage10_scale)，再找同类通道共用的属性(in_voltage_scale)
+ */
+static QByteArray channelAttribute(const QString &dir, const QString &channel, const char *name)
+{
+    QByteArray value = readAttribute(dir + "/in_" + channel + "_" + name);
+    if (!value.isEmpty())
+        return value;
+
+    QString type = channel;
+    while (!type.isEmpty() && type.at(type.size() - 1).isDigit())
+        type.chop(1);
+    return readAttribute(dir + "/in_" + type + "_" + name);
+}
+
+/**
+ * @brief 从sysfs读取通道元数据
+ */
+static IioChannelInfo loadMetadata(const QString &device, const QString &channel)
+{
+    QString dir = deviceDir(device);
+    IioChannelInfo info;
+    info.inode = deviceInode(device);
+    info.deviceName = QString::fromLatin1(readAttribute(dir + "/name"));
+    info.type = QString::fromLatin1(readAttribute(dir + "/scan_elements/in_" + channel + "_type"));
+
+    bool ok = false;
+    info.scale = channelAttribute(dir, channel, "scale").toDouble(&ok);
+    info.valid = ok && info.scale > 0;
+    info.offset = channelAttribute(dir, channel, "offset").toDouble();
+    return info;
+}
+
+/**
+ * @brief IioChannel类构造函数
+ * @details 原始值文件在第一次读取时才打开
+ */
+IioChannel::IioChannel(const QString &device, const QString &channel)
+    : device(device), channel(channel)
+{
+    current = metadata(device, channel);
+    raw.setPath(deviceDir(device) + "/in_" + channel + "_raw");
+    checked.start();
+}
+
+/**
+ * @brief 读取一个原始值
+ * @details 稳态下只有一次pread；读取失败时检查驱动是否重新绑定，是则重新打开后再读一次
+ */
+bool IioChannel::readRaw(int &value)
+{
+    if (checked.hasExpired(RebindCheckMs)) {
+        checked.start();
+        checkRebind();
+    }
+
+    if (raw.readInt(value))
+        return true;
+
+    quint64 generation = current.generation;
+    checked.start();
+    checkRebind();
+    return current.generation != generation && raw.readInt(value);
+}
+
+/**
+ * @brief 当前元数据
+ */
+const IioChannelInfo &IioChannel::info() const
+{
+    return current;
+}
+
+/**
+ * @brief 把原始值换算为电压，单位mV
+ */
+double IioChannel::toMillivolts(double value) const
+{
+    return (value + current.offset) * current.scale;
+}
+
+/**
+ * @brief 检查驱动是否重新绑定
+ * @details 只有一次stat系统调用
+ */
+void IioChannel::checkRebind()
+{
+    if (deviceInode(device) != current.inode) {
+        qDebug()<<"IIO设备"<<device<<"重新绑定，重新读取元数据";
+        reload();
+    }
+}
+
+/**
+ * @brief 丢弃缓存并重新读取元数据、重新打开原始值文件
+ */
+void IioChannel::reload()
+{
+    invalidate(device);
+    current = metadata(device, channel);
+    raw.reopen();
+}
+
+/**
+ * @brief 获取(必要时读取)通道元数据
+ */
+IioChannelInfo IioChannel::metadata(const QString &device, const QString &channel)
+{
+    QMutexLocker locker(&cacheMutex);
+    QString key = device + "/" + channel;
+    auto it = cache.find(key);
+    if (it != cache.end())
+        return it.value();
+
+    IioChannelInfo info = loadMetadata(device, channel);
+    info.generation = ++generations;
+    cache.insert(key, info);
+    return info;
+}
+
+/**
+ * @brief 丢弃一个设备所有通道的缓存元数据
+ */
+void IioChannel::invalidate(const QString &device)
+{
+    QMutexLocker locker(&cacheMutex);
+    QString prefix = device + "/";
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (it.key().startsWith(prefix))
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+}
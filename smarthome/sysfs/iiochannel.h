@@ -0,0 +1,93 @@
+/**
+ * @file iiochannel.h
+ * @brief IIO通道元数据和读取类的头文件
+ * @details 缩放系数、偏移量等静态属性在驱动绑定期间不变，只读取一次并在进程内共享
+ */
+#ifndef IIOCHANNEL_H
+#define IIOCHANNEL_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include "sysfsinput.h"
+
+/**
+ * @struct IioChannelInfo
+ * @brief IIO通道的静态属性
+ * @details 换算公式: 电压(mV) = (原始值 + offset) * scale
+ */
+struct IioChannelInfo
+{
+    bool valid = false;         ///< 是否读到了scale
+    QString deviceName;         ///< 设备的name属性，例如"48003000.adc:adc@100"
+    QString type;               ///< 触发缓冲区中的采样格式(scan_elements的_type)，没有时为空
+    double scale = 0;           ///< 缩放系数
+    double offset = 0;          ///< 偏移量，没有offset属性时为0
+    quint64 inode = 0;          ///< 设备目录的inode，驱动重新绑定后会变化
+    quint64 generation = 0;     ///< 元数据版本，每次重新读取加1
+};
+
+/**
+ * @class IioChannel
+ * @brief IIO通道读取类
+ * @details 元数据通过metadata()在进程内按"设备/通道"缓存，所有传感器类共享，第一次使用时读取；
+ *          原始值通过常驻描述符pread读取，稳态下每个采样只有一次系统调用。
+ *          驱动重新绑定时sysfs目录被重新创建：读取失败时，以及每隔RebindCheckMs检查一次
+ *          设备目录的inode，发现变化后重新读取元数据并重新打开原始值文件
+ */
+class IioChannel
+{
+public:
+    enum {
+        RebindCheckMs = 30000   ///< 检查驱动是否重新绑定的间隔
+    };
+
+    /**
+     * @brief 构造函数
+     * @param device IIO设备名，例如"iio:device0"
+     * @param channel 通道名(不含in_前缀)，例如"voltage10"
+     */
+    IioChannel(const QString &device, const QString &channel);
+
+    /**
+     * @brief 读取一个原始值
+     * @param raw 输出的原始值
+     * @return 读取成功返回true
+     */
+    bool readRaw(int &raw);
+
+    /**
+     * @brief 当前元数据
+     */
+    const IioChannelInfo &info() const;
+
+    /**
+     * @brief 把原始值换算为电压，单位mV
+     */
+    double toMillivolts(double raw) const;
+
+    /**
+     * @brief 获取(必要时读取)通道元数据，线程安全
+     * @param device IIO设备名
+     * @param channel 通道名
+     * @return 缓存的元数据
+     */
+    static IioChannelInfo metadata(const QString &device, const QString &channel);
+
+    /**
+     * @brief 丢弃一个设备所有通道的缓存元数据，下一次metadata()重新读取
+     * @param device IIO设备名
+     */
+    static void invalidate(const QString &device);
+
+private:
+    void checkRebind();     ///< 检查驱动是否重新绑定，是则重新读取元数据
+    void reload();          ///< 丢弃缓存并重新读取元数据、重新打开原始值文件
+
+    QString device;         ///< IIO设备名
+    QString channel;        ///< 通道名
+    IioChannelInfo current; ///< 当前使用的元数据
+    SysfsInput raw;         ///< 原始值文件
+    QElapsedTimer checked;  ///< 距离上次检查驱动重新绑定的时间
+};
+
+#endif // IIOCHANNEL_H
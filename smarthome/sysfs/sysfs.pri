@@ -0,0 +1,11 @@
+SOURCES += \
+    ../sysfs/iiochannel.cpp \
+    ../sysfs/sysfsinput.cpp \
+    ../sysfs/sysfsoutput.cpp \
+    ../sysfs/sysfspath.cpp
+
+HEADERS += \
+    ../sysfs/iiochannel.h \
+    ../sysfs/sysfsinput.h \
+    ../sysfs/sysfsoutput.h \
+    ../sysfs/sysfspath.h
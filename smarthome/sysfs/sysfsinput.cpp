@@ -0,0 +1,128 @@
+/**
+ * @file sysfsinput.cpp
+ * @brief sysfs输入属性访问类的实现文件
+ */
+#include "sysfsinput.h"
+#include "../log/log.h"
+#include <QFile>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief SysfsInput类构造函数
+ * @param path sysfs属性文件路径
+ * @details 构造时不打开文件，第一次读取时再打开，避免板外运行时报错
+ */
+SysfsInput::SysfsInput(const QString &path)
+    : filePath(QFile::encodeName(path)), fd(-1)
+{
+}
+
+/**
+ * @brief SysfsInput类析构函数
+ */
+SysfsInput::~SysfsInput()
+{
+    closeFile();
+}
+
+/**
+ * @brief 设置sysfs属性文件路径
+ * @param path 文件路径
+ */
+void SysfsInput::setPath(const QString &path)
+{
+    closeFile();
+    filePath = QFile::encodeName(path);
+}
+
+/**
+ * @brief 获取sysfs属性文件路径
+ */
+QString SysfsInput::path() const
+{
+    return QFile::decodeName(filePath);
+}
+
+/**
+ * @brief 读取属性内容
+ * @details 描述符已打开时只有一次pread系统调用；
+ *          读取失败时关闭描述符，下一次调用会重新打开
+ */
+int SysfsInput::read(char *buffer, int size)
+{
+    if (size <= 0 || (fd < 0 && !openFile()))
+        return -1;
+
+    ssize_t ret;
+    do {
+        ret = pread(fd, buffer, size - 1, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        LOG_LIMITED(LogWarn, 60000) << "read" << path() << "failed:" << strerror(errno);
+        closeFile();
+        return -1;
+    }
+
+    buffer[ret] = '\0';
+    return (int)ret;
+}
+
+/**
+ * @brief 读取整数属性
+ */
+bool SysfsInput::readInt(int &value)
+{
+    char buffer[32];
+    if (read(buffer, sizeof(buffer)) <= 0)
+        return false;
+
+    char *end;
+    long result = strtol(buffer, &end, 10);
+    if (end == buffer)
+        return false;
+    value = (int)result;
+    return true;
+}
+
+/**
+ * @brief 关闭常驻的文件描述符
+ */
+void SysfsInput::reopen()
+{
+    closeFile();
+}
+
+/**
+ * @brief 打开属性文件并保存描述符
+ * @return 打开成功返回true
+ */
+bool SysfsInput::openFile()
+{
+    /* 未设置路径或文件不存在(如在PC上运行)时直接返回 */
+    if (filePath.isEmpty())
+        return false;
+
+    fd = open(filePath.constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT)
+            LOG_LIMITED(LogWarn, 60000) << "open" << path() << "failed:" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 关闭常驻的文件描述符
+ */
+void SysfsInput::closeFile()
+{
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
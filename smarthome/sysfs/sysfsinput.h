@@ -0,0 +1,75 @@
+/**
+ * @file sysfsinput.h
+ * @brief sysfs输入属性访问类的头文件
+ * @details 传感器共用的sysfs读取后端，常驻文件描述符，每次读取只有一次pread系统调用
+ */
+#ifndef SYSFSINPUT_H
+#define SYSFSINPUT_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @class SysfsInput
+ * @brief sysfs输入属性访问类
+ * @details 第一次读取时打开属性文件(如in_voltage10_raw)并保持描述符，
+ *          之后每次用pread从偏移0读取，sysfs每次从偏移0读取都会重新取值；
+ *          读取失败时关闭描述符，下一次调用重新打开(例如驱动重新绑定后)。
+ *          sysfs属性总是报告可读，poll和O_NONBLOCK都无法限制读取时间，
+ *          驱动挂死时pread会一直阻塞在驱动中，只能由SensorSampler的读取超时发现
+ */
+class SysfsInput
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param path sysfs属性文件路径
+     */
+    explicit SysfsInput(const QString &path = QString());
+
+    /**
+     * @brief 析构函数，关闭常驻的文件描述符
+     */
+    ~SysfsInput();
+
+    /**
+     * @brief 设置sysfs属性文件路径
+     * @param path 文件路径，修改路径会关闭原描述符
+     */
+    void setPath(const QString &path);
+
+    /**
+     * @brief 获取sysfs属性文件路径
+     */
+    QString path() const;
+
+    /**
+     * @brief 读取属性内容
+     * @param buffer 输出缓冲区，读取的内容以'\0'结尾
+     * @param size 缓冲区大小
+     * @return 读到的字节数，文件不可用或读取失败返回-1
+     */
+    int read(char *buffer, int size);
+
+    /**
+     * @brief 读取整数属性
+     * @param value 输出的值
+     * @return 读取并解析成功返回true
+     */
+    bool readInt(int &value);
+
+    /**
+     * @brief 关闭常驻的文件描述符，下一次读取重新打开
+     */
+    void reopen();
+
+private:
+    Q_DISABLE_COPY(SysfsInput)
+
+    bool openFile();
+    void closeFile();
+
+    QByteArray filePath;    ///< 属性文件路径(本地编码)
+    int fd;                 ///< 常驻文件描述符，-1表示未打开
+};
+#endif // SYSFSINPUT_H
@@ -0,0 +1,177 @@
+/**
+ * @file sysfsoutput.cpp
+ * @brief sysfs输出属性访问类的实现文件
+ */
+#include "sysfsoutput.h"
+#include "../log/log.h"
+#include <QFile>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief SysfsOutput类构造函数
+ * @param path sysfs属性文件路径
+ * @details 构造时不打开文件，第一次写入时再打开，避免板外运行时报错
+ */
+SysfsOutput::SysfsOutput(const QString &path)
+    : filePath(QFile::encodeName(path)), fd(-1), cachedState(-1)
+{
+}
+
+/**
+ * @brief SysfsOutput类析构函数
+ */
+SysfsOutput::~SysfsOutput()
+{
+    closeFile();
+}
+
+/**
+ * @brief 设置sysfs属性文件路径
+ * @param path 文件路径
+ */
+void SysfsOutput::setPath(const QString &path)
+{
+    closeFile();
+    filePath = QFile::encodeName(path);
+    cachedState = -1;
+}
+
+/**
+ * @brief 获取sysfs属性文件路径
+ */
+QString SysfsOutput::path() const
+{
+    return QFile::decodeName(filePath);
+}
+
+/**
+ * @brief 打开属性文件并读回当前值
+ * @return 文件已打开或打开成功返回true
+ */
+bool SysfsOutput::open()
+{
+    return fd >= 0 || openFile();
+}
+
+/**
+ * @brief 设置输出状态
+ * @param on true写入"1"，false写入"0"
+ * @return 写入成功或跳过时返回true，失败返回false
+ * @details 状态与缓存一致时直接返回，不产生任何系统调用；
+ *          写入失败时关闭描述符并清除缓存，下一次调用会重新打开(例如驱动重新绑定后)
+ */
+bool SysfsOutput::setState(bool on)
+{
+    return setValue(on ? 1 : 0);
+}
+
+/**
+ * @brief 设置非负整数值
+ * @param value 要写入的值
+ * @return 写入成功或跳过时返回true，失败返回false
+ * @details 与setState相同：值与缓存一致时不产生系统调用，写入失败时关闭描述符并清除缓存
+ */
+bool SysfsOutput::setValue(int value)
+{
+    if (value < 0)
+        return false;
+
+    /* 值未改变，跳过写入 */
+    if (cachedState == value)
+        return true;
+
+    if (fd < 0) {
+        if (!openFile())
+            return false;
+        /* 打开时读回的值已经是目标值 */
+        if (cachedState == value)
+            return true;
+    }
+
+    /* 写十进制文本，sysfs属性文件每次都从偏移0开始解析 */
+    char text[16];
+    int length = snprintf(text, sizeof(text), "%d", value);
+    ssize_t ret;
+    do {
+        ret = pwrite(fd, text, length, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret != length) {
+        LOG_LIMITED(LogWarn, 60000) << "write" << path() << "failed:" << strerror(errno);
+        closeFile();
+        cachedState = -1;
+        return false;
+    }
+
+    cachedState = value;
+    return true;
+}
+
+/**
+ * @brief 获取缓存的输出状态
+ * @return 1表示打开，0表示关闭，-1表示未知
+ */
+int SysfsOutput::state() const
+{
+    return cachedState;
+}
+
+/**
+ * @brief 清除状态缓存
+ */
+void SysfsOutput::invalidate()
+{
+    cachedState = -1;
+}
+
+/**
+ * @brief 打开属性文件并保存描述符
+ * @return 打开成功返回true
+ * @details 能以读写方式打开时读回属性的当前值作为状态缓存；
+ *          只写的属性(如PWM的export)以只写方式打开，状态保持未知
+ */
+bool SysfsOutput::openFile()
+{
+    /* 未设置路径或文件不存在(如在PC上运行)时直接返回 */
+    if (filePath.isEmpty())
+        return false;
+
+    fd = ::open(filePath.constData(), O_RDWR | O_CLOEXEC);
+    if (fd < 0 && errno == EACCES)
+        fd = ::open(filePath.constData(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT)
+            LOG_LIMITED(LogWarn, 60000) << "open" << path() << "failed:" << strerror(errno);
+        return false;
+    }
+
+    char text[16];
+    ssize_t ret;
+    do {
+        ret = pread(fd, text, sizeof(text) - 1, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret > 0) {
+        text[ret] = '\0';
+        char *end;
+        long value = strtol(text, &end, 10);
+        if (end != text && value >= 0)
+            cachedState = (int)value;
+    }
+    return true;
+}
+
+/**
+ * @brief 关闭常驻的文件描述符
+ */
+void SysfsOutput::closeFile()
+{
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
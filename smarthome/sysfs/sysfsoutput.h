@@ -0,0 +1,87 @@
+/**
+ * @file sysfsoutput.h
+ * @brief sysfs输出属性访问类的头文件
+ * @details LED、继电器、蜂鸣器、舵机PWM共用的sysfs输出后端，常驻文件描述符并缓存输出状态
+ */
+#ifndef SYSFSOUTPUT_H
+#define SYSFSOUTPUT_H
+
+#include <QByteArray>
+#include <QString>
+
+/**
+ * @class SysfsOutput
+ * @brief sysfs输出属性访问类
+ * @details 第一次写入(或调用open())时打开属性文件(如brightness)并保持描述符，
+ *          打开时读回属性的当前值作为状态缓存，开机后不必先写一次才知道状态；
+ *          之后每次仅用pwrite在偏移0处写入；若缓存的状态与目标状态一致则跳过写入，
+ *          因此每次状态真正改变时只产生一次write系统调用
+ */
+class SysfsOutput
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param path sysfs属性文件路径
+     */
+    explicit SysfsOutput(const QString &path = QString());
+
+    /**
+     * @brief 析构函数，关闭常驻的文件描述符
+     */
+    ~SysfsOutput();
+
+    /**
+     * @brief 设置sysfs属性文件路径
+     * @param path 文件路径，修改路径会关闭原描述符并清除状态缓存
+     */
+    void setPath(const QString &path);
+
+    /**
+     * @brief 获取sysfs属性文件路径
+     */
+    QString path() const;
+
+    /**
+     * @brief 打开属性文件并读回当前值
+     * @return 文件已打开或打开成功返回true，文件不可用返回false
+     */
+    bool open();
+
+    /**
+     * @brief 设置输出状态
+     * @param on true写入"1"，false写入"0"
+     * @return 写入成功或状态未变化而跳过时返回true，文件不可用或写入失败返回false
+     */
+    bool setState(bool on);
+
+    /**
+     * @brief 设置非负整数值，例如PWM的周期和占空比
+     * @param value 要写入的值，以十进制文本写入
+     * @return 写入成功或值未变化而跳过时返回true，文件不可用或写入失败返回false
+     */
+    bool setValue(int value);
+
+    /**
+     * @brief 获取缓存的输出状态
+     * @return 属性的当前值：0表示关闭，非0表示打开(LED的brightness可能读回大于1的值)，
+     *         -1表示状态未知(文件未打开、属性不可读且尚未写入过)
+     */
+    int state() const;
+
+    /**
+     * @brief 清除状态缓存，下一次setState一定会写入硬件
+     */
+    void invalidate();
+
+private:
+    Q_DISABLE_COPY(SysfsOutput)
+
+    bool openFile();
+    void closeFile();
+
+    QByteArray filePath;    ///< 属性文件路径(本地编码)
+    int fd;                 ///< 常驻文件描述符，-1表示未打开
+    int cachedState;        ///< 打开时读回或最近一次成功写入的值，-1表示未知
+};
+#endif // SYSFSOUTPUT_H
@@ -0,0 +1,18 @@
+/**
+ * @file sysfspath.cpp
+ * @brief sysfs路径映射的实现文件
+ */
+#include "sysfspath.h"
+#include <QtGlobal>
+
+/**
+ * @brief 把板上的sysfs绝对路径映射到模拟根目录
+ * @details 根目录只在第一次调用时读取环境变量
+ */
+QString sysfsPath(const QString &path)
+{
+    static const QString root = QString::fromLocal8Bit(qgetenv("SMARTHOME_SYSFS_ROOT"));
+    if (root.isEmpty())
+        return path;
+    return root + path;
+}
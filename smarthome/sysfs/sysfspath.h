@@ -0,0 +1,18 @@
+/**
+ * @file sysfspath.h
+ * @brief sysfs路径映射的头文件
+ * @details 板外运行(模拟器、基准测试)时把设备访问的sysfs路径重定向到一个普通目录
+ */
+#ifndef SYSFSPATH_H
+#define SYSFSPATH_H
+
+#include <QString>
+
+/**
+ * @brief 把板上的sysfs绝对路径映射到模拟根目录
+ * @param path 板上的绝对路径，例如"/sys/class/leds/relay/brightness"
+ * @return 环境变量SMARTHOME_SYSFS_ROOT非空时返回<根目录><path>，否则原样返回
+ */
+QString sysfsPath(const QString &path);
+
+#endif // SYSFSPATH_H
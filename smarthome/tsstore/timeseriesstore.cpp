@@ -0,0 +1,572 @@
+/**
+ * @file timeseriesstore.cpp
+ * @brief 本地时序数据存储类的实现文件
+ */
+#include "timeseriesstore.h"
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+static const quint32 TsMagic = 0x31535448;     // "HTS1"
+static const quint16 TsVersion = 1;
+static const int DefaultBlockSamples = 246;    // 块头40字节 + 246个增量 = 1024字节
+static const quint16 EmptyDelta = 0xFFFF;      // 未使用的增量槽
+static const qint64 TimeUnitMs = 100;          // 时间增量单位
+static const float ValueScale = 10.0f;         // 值以0.1为单位保存
+
+/**
+ * @brief 文件头，只在创建文件时写入
+ */
+struct TimeSeries::FileHeader
+{
+    quint32 magic;          ///< 文件标识
+    quint16 version;        ///< 格式版本
+    quint16 blockSamples;   ///< 每块增量槽数
+    quint32 blockCount;     ///< 块数
+    quint32 reserved;
+};
+
+/**
+ * @brief 块头
+ * @details seq为0表示空块；count包含基准点在内的采样数，
+ *          写入时先写增量槽再增加count，count之前的数据总是完整的
+ */
+struct TimeSeries::BlockHeader
+{
+    quint32 seq;            ///< 块序号，递增，0表示空块
+    quint32 checksum;       ///< 基准点、count和已用增量槽的CRC32
+    quint16 count;          ///< 已写入的采样数(含基准点)
+    quint16 reserved;
+    quint32 reserved2;
+    qint64 baseTime;        ///< 基准点时间，单位ms
+    qint64 lastTime;        ///< 最后一个采样的时间，单位ms
+    qint32 baseValue;       ///< 基准点值，单位0.1
+    qint32 lastValue;       ///< 最后一个采样的值，单位0.1
+};
+
+/**
+ * @brief 相对上一个采样的增量
+ */
+struct TimeSeries::Delta
+{
+    quint16 dt;             ///< 时间增量，单位100ms，EmptyDelta表示未使用
+    qint16 dv;              ///< 值增量，单位0.1
+};
+
+/**
+ * @brief 计算CRC32
+ * @param crc 上一段数据的CRC，第一段传0
+ * @param data 数据
+ * @param length 数据长度
+ */
+static quint32 crc32(quint32 crc, const void *data, size_t length)
+{
+    static quint32 table[256];
+    static bool initialized = false;
+    if (!initialized) {
+        for (quint32 i = 0; i < 256; i++) {
+            quint32 c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        initialized = true;
+    }
+
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    while (length--)
+        crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+/**
+ * @brief TimeSeries类构造函数
+ */
+TimeSeries::TimeSeries()
+    : fd(-1), readOnly(true), map(nullptr), mapSize(0),
+      blockSamples(0), blockCount(0), current(-1), dirty(false)
+{
+}
+
+/**
+ * @brief TimeSeries类析构函数
+ */
+TimeSeries::~TimeSeries()
+{
+    close();
+}
+
+/**
+ * @brief 打开(必要时创建)时序文件
+ * @details 写入端在文件不存在或格式不匹配时重新创建文件，然后校验并恢复各块
+ */
+bool TimeSeries::open(const QString &path, int capacity, bool readOnly)
+{
+    close();
+    this->readOnly = readOnly;
+
+    QByteArray name = QFile::encodeName(path);
+    fd = ::open(name.constData(), readOnly ? O_RDONLY | O_CLOEXEC : O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        if (!readOnly || errno != ENOENT)
+            qDebug()<<"open"<<path<<"failed:"<<strerror(errno);
+        return false;
+    }
+
+    FileHeader header;
+    struct stat st;
+    bool valid = fstat(fd, &st) == 0 &&
+                 pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                 header.magic == TsMagic && header.version == TsVersion &&
+                 header.blockSamples > 0 && header.blockCount > 0;
+    if (valid) {
+        size_t expected = sizeof(FileHeader) +
+            (size_t)header.blockCount * (sizeof(BlockHeader) + header.blockSamples * sizeof(Delta));
+        valid = (size_t)st.st_size == expected;
+    }
+
+    if (!valid) {
+        if (readOnly) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+
+        /* 新建文件：按容量计算块数，块内容全部清零(seq为0表示空块) */
+        header.magic = TsMagic;
+        header.version = TsVersion;
+        header.blockSamples = DefaultBlockSamples;
+        header.blockCount = qMax(2, (capacity + DefaultBlockSamples) / (DefaultBlockSamples + 1));
+        header.reserved = 0;
+        size_t size = sizeof(FileHeader) +
+            (size_t)header.blockCount * (sizeof(BlockHeader) + header.blockSamples * sizeof(Delta));
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0 ||
+            pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+            qDebug()<<"create"<<path<<"failed:"<<strerror(errno);
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+    }
+
+    blockSamples = header.blockSamples;
+    blockCount = header.blockCount;
+    mapSize = sizeof(FileHeader) + (size_t)blockCount * (sizeof(BlockHeader) + blockSamples * sizeof(Delta));
+
+    void *addr = mmap(nullptr, mapSize, readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        qDebug()<<"mmap"<<path<<"failed:"<<strerror(errno);
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    map = static_cast<char *>(addr);
+
+    if (!readOnly)
+        recover();
+    return true;
+}
+
+/**
+ * @brief 关闭文件
+ */
+void TimeSeries::close()
+{
+    if (map) {
+        flush();
+        munmap(map, mapSize);
+        map = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    current = -1;
+    dirty = false;
+}
+
+/**
+ * @brief 是否已打开
+ */
+bool TimeSeries::isOpen() const
+{
+    return map != nullptr;
+}
+
+/**
+ * @brief 追加一个采样
+ * @details 先写增量槽，再更新最后值，最后增加count，读取端只会看到完整的采样；
+ *          增量只能为正，时钟回拨后的采样从新块开始，不丢弃
+ */
+bool TimeSeries::append(qint64 time, float value)
+{
+    if (!map || readOnly)
+        return false;
+
+    qint32 v = qRound(value * ValueScale);
+    if (current < 0) {
+        startBlock(time, v);
+        return true;
+    }
+
+    /* 最后时间按TimeUnitMs取整保存，回退不超过半个单位的按增量0记录 */
+    BlockHeader *header = block(current);
+    qint64 elapsed = time - header->lastTime;
+    qint64 dt = (elapsed + TimeUnitMs / 2) / TimeUnitMs;
+    qint64 dv = (qint64)v - header->lastValue;
+    if (header->count - 1 >= blockSamples || elapsed < -TimeUnitMs / 2 || dt >= EmptyDelta ||
+        dv < -32768 || dv > 32767) {
+        startBlock(time, v);
+        return true;
+    }
+
+    Delta *d = deltas(header) + header->count - 1;
+    d->dt = (quint16)dt;
+    d->dv = (qint16)dv;
+    header->lastTime += dt * TimeUnitMs;
+    header->lastValue = v;
+    __atomic_store_n(&header->count, (quint16)(header->count + 1), __ATOMIC_RELEASE);
+    dirty = true;
+    return true;
+}
+
+/**
+ * @brief 把修改过的块的校验和更新并同步到存储器
+ * @details msync等待所有脏页写回，返回后flush()之前的采样已落盘；
+ *          内核在两次调用之间也可能自行写回，这里不能限制写回次数
+ */
+void TimeSeries::flush()
+{
+    if (!map || readOnly || !dirty)
+        return;
+
+    BlockHeader *header = block(current);
+    header->checksum = checksum(header);
+    if (msync(map, mapSize, MS_SYNC) != 0)
+        qDebug()<<"msync failed:"<<strerror(errno);
+    dirty = false;
+}
+
+/**
+ * @brief 查询时间范围内的原始数据
+ * @details 时钟回拨后块的顺序与时间不一致，此时按时间重新排序
+ */
+QVector<TsPoint> TimeSeries::range(qint64 from, qint64 to) const
+{
+    QVector<TsPoint> points;
+    bool ordered = true;
+    visit(from, to, [&points, &ordered](qint64 time, float value) {
+        if (!points.isEmpty() && time < points.last().time)
+            ordered = false;
+        TsPoint point = { time, value };
+        points.append(point);
+    });
+    if (!ordered) {
+        std::stable_sort(points.begin(), points.end(), [](const TsPoint &a, const TsPoint &b) {
+            return a.time < b.time;
+        });
+    }
+    return points;
+}
+
+/**
+ * @brief 按固定时间段聚合
+ * @details 数据通常按时间顺序遍历，只在时间段变化时查找；
+ *          时钟回拨后较早的采样按起始时间找到或插入对应的时间段，结果仍按时间排序
+ */
+QVector<TsAggregate> TimeSeries::aggregate(qint64 from, qint64 to, qint64 bucketMs) const
+{
+    QVector<TsAggregate> buckets;
+    QVector<double> sums;
+    if (bucketMs <= 0)
+        return buckets;
+
+    visit(from, to, [&](qint64 time, float value) {
+        qint64 start = time - time % bucketMs;
+        int index = buckets.size() - 1;
+        if (index < 0 || buckets[index].start != start) {
+            auto it = std::lower_bound(buckets.begin(), buckets.end(), start,
+                                       [](const TsAggregate &bucket, qint64 key) {
+                return bucket.start < key;
+            });
+            index = it - buckets.begin();
+            if (it == buckets.end() || it->start != start) {
+                TsAggregate bucket = { start, value, value, value, 0 };
+                buckets.insert(index, bucket);
+                sums.insert(index, 0);
+            }
+        }
+        TsAggregate &bucket = buckets[index];
+        bucket.min = qMin(bucket.min, value);
+        bucket.max = qMax(bucket.max, value);
+        bucket.count++;
+        sums[index] += value;
+    });
+    for (int i = 0; i < buckets.size(); i++)
+        buckets[i].avg = sums[i] / buckets[i].count;
+    return buckets;
+}
+
+/**
+ * @brief 第index个块的块头
+ */
+TimeSeries::BlockHeader *TimeSeries::block(int index) const
+{
+    size_t blockSize = sizeof(BlockHeader) + blockSamples * sizeof(Delta);
+    return reinterpret_cast<BlockHeader *>(map + sizeof(FileHeader) + index * blockSize);
+}
+
+/**
+ * @brief 块的增量数组
+ */
+TimeSeries::Delta *TimeSeries::deltas(BlockHeader *header) const
+{
+    return reinterpret_cast<Delta *>(header + 1);
+}
+
+/**
+ * @brief 计算块的校验和
+ */
+quint32 TimeSeries::checksum(BlockHeader *header) const
+{
+    quint32 crc = crc32(0, &header->baseTime, sizeof(header->baseTime));
+    crc = crc32(crc, &header->baseValue, sizeof(header->baseValue));
+    crc = crc32(crc, &header->count, sizeof(header->count));
+    return crc32(crc, deltas(header), (header->count - 1) * sizeof(Delta));
+}
+
+/**
+ * @brief 打开时校验并恢复各块，找到当前写入块
+ * @details 校验失败说明掉电前该块的修改没有完整同步：
+ *          增量槽按顺序写入、未使用的槽为全1，据此恢复count和最后值并重新计算校验和
+ */
+void TimeSeries::recover()
+{
+    quint32 maxSeq = 0;
+    current = -1;
+
+    for (int i = 0; i < blockCount; i++) {
+        BlockHeader *header = block(i);
+        if (header->seq == 0)
+            continue;
+
+        if (header->count == 0 || header->count - 1 > blockSamples || checksum(header) != header->checksum) {
+            Delta *d = deltas(header);
+            int count = 1;
+            qint64 time = header->baseTime;
+            qint32 value = header->baseValue;
+            while (count - 1 < blockSamples && d[count - 1].dt != EmptyDelta) {
+                time += d[count - 1].dt * TimeUnitMs;
+                value += d[count - 1].dv;
+                count++;
+            }
+            header->count = count;
+            header->lastTime = time;
+            header->lastValue = value;
+            header->checksum = checksum(header);
+            dirty = true;
+            qDebug()<<"时序数据块"<<i<<"校验失败，已恢复"<<count<<"个采样"<<endl;
+        }
+
+        if (header->seq > maxSeq) {
+            maxSeq = header->seq;
+            current = i;
+        }
+    }
+    flush();
+}
+
+/**
+ * @brief 在下一个块中开始新的基准点
+ * @details 旧块先更新校验和；新块在写完之前seq保持为0，写完后才赋予新的序号，
+ *          只读进程据此发现正在被回收的块(见visit())
+ */
+void TimeSeries::startBlock(qint64 time, qint32 value)
+{
+    quint32 seq = 1;
+    int next = 0;
+    if (current >= 0) {
+        BlockHeader *old = block(current);
+        old->checksum = checksum(old);
+        seq = old->seq + 1;
+        next = (current + 1) % blockCount;
+    }
+
+    BlockHeader *header = block(next);
+    __atomic_store_n(&header->seq, 0u, __ATOMIC_RELAXED);
+    /* 只读进程必须先看到seq清零，才能看到下面改写的块内容 */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset(deltas(header), 0xFF, blockSamples * sizeof(Delta));
+    header->count = 1;
+    header->reserved = 0;
+    header->reserved2 = 0;
+    header->baseTime = time;
+    header->lastTime = time;
+    header->baseValue = value;
+    header->lastValue = value;
+    header->checksum = checksum(header);
+    __atomic_store_n(&header->seq, seq, __ATOMIC_RELEASE);
+
+    current = next;
+    dirty = true;
+}
+
+/**
+ * @brief 按写入顺序排列的有效块序号
+ */
+QVector<int> TimeSeries::orderedBlocks() const
+{
+    QVector<QPair<quint32, int> > blocks;
+    for (int i = 0; i < blockCount; i++) {
+        quint32 seq = __atomic_load_n(&block(i)->seq, __ATOMIC_ACQUIRE);
+        if (seq != 0)
+            blocks.append(qMakePair(seq, i));
+    }
+    std::sort(blocks.begin(), blocks.end());
+
+    QVector<int> order;
+    order.reserve(blocks.size());
+    for (int i = 0; i < blocks.size(); i++)
+        order.append(blocks[i].second);
+    return order;
+}
+
+/**
+ * @brief 按写入顺序遍历范围内的采样
+ * @details 块内的采样按时间递增，整块不在范围内的直接跳过；
+ *          时钟回拨后后写入的块可能早于前面的块，所以遇到晚于结束时间的块不能停止遍历。
+ *          只读进程遍历时写入进程可能正在startBlock()中回收同一个块，
+ *          每块的采样先解码到缓冲区，遍历完再读一次seq，seq变化(或开始时为0)说明块已被改写，整块丢弃
+ */
+template <typename Visitor>
+void TimeSeries::visit(qint64 from, qint64 to, Visitor visitor) const
+{
+    if (!map)
+        return;
+
+    QVector<QPair<qint64, qint32> > points;
+    QVector<int> order = orderedBlocks();
+    for (int i = 0; i < order.size(); i++) {
+        BlockHeader *header = block(order[i]);
+        quint32 seq = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE);
+        int count = __atomic_load_n(&header->count, __ATOMIC_ACQUIRE);
+        if (seq == 0 || count == 0 || count - 1 > blockSamples ||
+            header->lastTime < from || header->baseTime > to)
+            continue;
+
+        points.clear();
+        const Delta *d = deltas(header);
+        qint64 time = header->baseTime;
+        qint32 value = header->baseValue;
+        for (int k = 0; k < count; k++) {
+            if (k > 0) {
+                time += d[k - 1].dt * TimeUnitMs;
+                value += d[k - 1].dv;
+            }
+            if (time > to)
+                break;
+            if (time >= from)
+                points.append(qMakePair(time, value));
+        }
+
+        /* 块内容的读取必须在再次读取seq之前完成 */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&header->seq, __ATOMIC_RELAXED) != seq)
+            continue;
+
+        for (int k = 0; k < points.size(); k++)
+            visitor(points[k].first, points[k].second / ValueScale);
+    }
+}
+
+/**
+ * @brief TimeSeriesStore类构造函数
+ * @param readOnly 是否只读
+ * @param dir 数据目录，为空时使用环境变量SMARTHOME_DATA_DIR或/var/lib/smarthome
+ */
+TimeSeriesStore::TimeSeriesStore(bool readOnly, const QString &dir)
+    : readOnly(readOnly), dir(dir)
+{
+    if (this->dir.isEmpty())
+        this->dir = qEnvironmentVariable("SMARTHOME_DATA_DIR", "/var/lib/smarthome");
+}
+
+/**
+ * @brief TimeSeriesStore类析构函数
+ */
+TimeSeriesStore::~TimeSeriesStore()
+{
+    qDeleteAll(series);
+}
+
+/**
+ * @brief 注册指标并打开其时序文件
+ */
+bool TimeSeriesStore::addMetric(const QString &metric, int capacity)
+{
+    if (series.contains(metric))
+        return true;
+
+    if (!readOnly)
+        QDir().mkpath(dir);
+
+    TimeSeries *ts = new TimeSeries();
+    if (!ts->open(dir + "/" + metric + ".ts", capacity, readOnly)) {
+        delete ts;
+        return false;
+    }
+    series.insert(metric, ts);
+    return true;
+}
+
+/**
+ * @brief 追加一个采样
+ */
+bool TimeSeriesStore::append(const QString &metric, qint64 time, float value)
+{
+    TimeSeries *ts = series.value(metric);
+    return ts && ts->append(time, value);
+}
+
+/**
+ * @brief 同步所有指标文件
+ */
+void TimeSeriesStore::flush()
+{
+    for (QHash<QString, TimeSeries *>::iterator it = series.begin(); it != series.end(); ++it)
+        it.value()->flush();
+}
+
+/**
+ * @brief 查询时间范围内的原始数据
+ */
+QVector<TsPoint> TimeSeriesStore::range(const QString &metric, qint64 from, qint64 to) const
+{
+    TimeSeries *ts = series.value(metric);
+    return ts ? ts->range(from, to) : QVector<TsPoint>();
+}
+
+/**
+ * @brief 按固定时间段聚合
+ */
+QVector<TsAggregate> TimeSeriesStore::aggregate(const QString &metric, qint64 from, qint64 to, qint64 bucketMs) const
+{
+    TimeSeries *ts = series.value(metric);
+    return ts ? ts->aggregate(from, to, bucketMs) : QVector<TsAggregate>();
+}
+
+/**
+ * @brief 数据目录
+ */
+QString TimeSeriesStore::directory() const
+{
+    return dir;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file timeseriesstore.h
+ * @brief 本地时序数据存储类的头文件
+ * @details 在开发板上以内存映射文件保存温度、湿度、ppm等指标的历史数据，
+ *          上传程序写入，Qt面板只读查询
+ */
+#ifndef TIMESERIESSTORE_H
+#define TIMESERIESSTORE_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+/**
+ * @struct TsPoint
+ * @brief 一个时序数据点
+ */
+struct TsPoint
+{
+    qint64 time;    ///< 采样时间，自1970-01-01起的毫秒数
+    float value;    ///< 采样值
+};
+
+/**
+ * @struct TsAggregate
+ * @brief 一个时间段内的聚合结果
+ */
+struct TsAggregate
+{
+    qint64 start;   ///< 时间段起始时间，单位ms
+    float min;      ///< 最小值
+    float max;      ///< 最大值
+    float avg;      ///< 平均值
+    int count;      ///< 采样数
+};
+
+/**
+ * @class TimeSeries
+ * @brief 单个指标的环形时序文件
+ * @details 文件由固定数量的块组成，写满后覆盖最旧的块，文件大小和内存占用固定。
+ *          每块保存一个基准点(时间、值)和若干增量：时间增量以100ms为单位存为16位，
+ *          值以0.1为单位、增量存为16位，每个采样只占4字节；增量超出范围时开始新块。
+ *
+ *          写入只修改共享映射的内存，不产生系统调用；flush()用msync强制写回，
+ *          保证调用之前的数据已落盘。内核也会按自己的回写周期(dirty_expire_centisecs，通常30秒)
+ *          随时写回脏页，flush()的间隔只是数据落盘的最长延迟，不是flash写入次数的上限。
+ *          系统时钟回拨(如SNTP校时)后的采样从新块开始，同一时间段可能出现在两个块中，
+ *          查询结果仍按时间排序。
+ *          每块带有校验和，flush()时更新；掉电后重新打开时，校验失败的块按"未使用的增量槽为全1"
+ *          恢复到最后一个完整写入的采样，不会因一次掉电丢失整个文件
+ */
+class TimeSeries
+{
+public:
+    /**
+     * @brief 构造函数
+     */
+    TimeSeries();
+
+    /**
+     * @brief 析构函数，写入端会先flush()再解除映射
+     */
+    ~TimeSeries();
+
+    /**
+     * @brief 打开(必要时创建)时序文件
+     * @param path 文件路径
+     * @param capacity 环形缓冲区可保存的采样数(只在创建文件时使用)
+     * @param readOnly 是否只读打开，只读时文件不存在则失败
+     * @return 打开成功返回true
+     */
+    bool open(const QString &path, int capacity, bool readOnly = false);
+
+    /**
+     * @brief 关闭文件
+     */
+    void close();
+
+    /**
+     * @brief 是否已打开
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief 追加一个采样
+     * @param time 采样时间，单位ms，早于最后一个采样(时钟回拨)时开始新块
+     * @param value 采样值
+     * @return 写入成功返回true
+     */
+    bool append(qint64 time, float value);
+
+    /**
+     * @brief 把修改过的块的校验和更新并同步到存储器
+     */
+    void flush();
+
+    /**
+     * @brief 查询时间范围内的原始数据
+     * @param from 起始时间(含)，单位ms
+     * @param to 结束时间(含)，单位ms
+     * @return 按时间排序的数据点
+     */
+    QVector<TsPoint> range(qint64 from, qint64 to) const;
+
+    /**
+     * @brief 按固定时间段聚合
+     * @param from 起始时间(含)，单位ms
+     * @param to 结束时间(含)，单位ms
+     * @param bucketMs 时间段长度，例如60000表示每分钟，3600000表示每小时
+     * @return 每个有数据的时间段的最小值、最大值和平均值
+     */
+    QVector<TsAggregate> aggregate(qint64 from, qint64 to, qint64 bucketMs) const;
+
+private:
+    Q_DISABLE_COPY(TimeSeries)
+
+    struct FileHeader;
+    struct BlockHeader;
+    struct Delta;
+
+    BlockHeader *block(int index) const;        ///< 第index个块的块头
+    Delta *deltas(BlockHeader *header) const;   ///< 块的增量数组
+    quint32 checksum(BlockHeader *header) const;    ///< 计算块的校验和
+    void recover();                             ///< 打开时校验并恢复各块，找到当前写入块
+    void startBlock(qint64 time, qint32 value); ///< 在下一个块中开始新的基准点
+    QVector<int> orderedBlocks() const;         ///< 按写入顺序排列的有效块序号
+
+    template <typename Visitor>
+    void visit(qint64 from, qint64 to, Visitor visitor) const;  ///< 按写入顺序遍历范围内的采样
+
+    int fd;                 ///< 文件描述符
+    bool readOnly;          ///< 是否只读
+    char *map;              ///< 文件映射地址
+    size_t mapSize;         ///< 映射长度
+    int blockSamples;       ///< 每块增量槽数
+    int blockCount;         ///< 块数
+    int current;            ///< 当前写入块序号，-1表示还没有数据
+    bool dirty;             ///< 当前块自上次flush()后是否被修改
+};
+
+/**
+ * @class TimeSeriesStore
+ * @brief 本地时序数据存储
+ * @details 一个目录下每个指标一个TimeSeries文件(<目录>/<指标名>.ts)。
+ *          默认目录为/var/lib/smarthome，可通过环境变量SMARTHOME_DATA_DIR修改
+ */
+class TimeSeriesStore
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param readOnly 是否只读(Qt面板使用只读方式查询)
+     * @param dir 数据目录，为空时使用默认目录
+     */
+    explicit TimeSeriesStore(bool readOnly = false, const QString &dir = QString());
+
+    /**
+     * @brief 析构函数，关闭并同步所有指标文件
+     */
+    ~TimeSeriesStore();
+
+    /**
+     * @brief 注册指标并打开其时序文件
+     * @param metric 指标名，例如"temperature"
+     * @param capacity 可保存的采样数
+     * @return 打开成功返回true
+     */
+    bool addMetric(const QString &metric, int capacity);
+
+    /**
+     * @brief 追加一个采样
+     */
+    bool append(const QString &metric, qint64 time, float value);
+
+    /**
+     * @brief 同步所有指标文件
+     */
+    void flush();
+
+    /**
+     * @brief 查询时间范围内的原始数据
+     */
+    QVector<TsPoint> range(const QString &metric, qint64 from, qint64 to) const;
+
+    /**
+     * @brief 按固定时间段聚合
+     */
+    QVector<TsAggregate> aggregate(const QString &metric, qint64 from, qint64 to, qint64 bucketMs) const;
+
+    /**
+     * @brief 数据目录
+     */
+    QString directory() const;
+
+private:
+    Q_DISABLE_COPY(TimeSeriesStore)
+
+    bool readOnly;                          ///< 是否只读
+    QString dir;                            ///< 数据目录
+    QHash<QString, TimeSeries *> series;    ///< 指标名到时序文件
+};
+
+#endif // TIMESERIESSTORE_H
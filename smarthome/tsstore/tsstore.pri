@@ -0,0 +1,5 @@
+SOURCES += \
+    ../tsstore/timeseriesstore.cpp
+
+HEADERS += \
+    ../tsstore/timeseriesstore.h